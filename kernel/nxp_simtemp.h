@@ -18,52 +18,291 @@
 #include <linux/mutex.h>
 #include <linux/wait.h>
 #include <linux/platform_device.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
+#include <linux/workqueue.h>
+#include <linux/xarray.h>
+#include <linux/prandom.h>
+#include <linux/kref.h>
+#include <linux/cpumask.h>
 
 #include "nxp_simtemp_ioctl.h"
 
+struct thermal_cooling_device;
+struct vm_area_struct;
+struct iov_iter;
+struct dentry;
+struct hrtimer;
+struct simtemp_relay;
+struct simtemp_history;
+struct simtemp_scenario;
+
 /* Driver name and version */
 #define DRIVER_NAME		"nxp_simtemp"
 #define DRIVER_VERSION		"1.0"
 #define DRIVER_DESC		"NXP Virtual Temperature Sensor"
 
+/* Instances created by the module when there is no Device Tree node */
+#define DEFAULT_NR_INSTANCES	1
+#define NR_INSTANCES_MAX	4096
+
 /* Default configuration values */
 #define DEFAULT_SAMPLING_MS	100
 #define DEFAULT_THRESHOLD_MC	45000	/* 45.0°C in milli-Celsius */
 #define DEFAULT_MODE		SIMTEMP_MODE_NORMAL
 
-/* Ring buffer size (must be power of 2 for efficiency) */
-#define RING_BUFFER_SIZE	64
-#define RING_BUFFER_MASK	(RING_BUFFER_SIZE - 1)
+/* Ring buffer size in records (must be power of 2 for efficiency) */
+#define DEFAULT_RING_SIZE	1024
+#define RING_SIZE_MIN		64
+#define RING_SIZE_MAX		65536
+
+/* With large frames the ring loses records to stay within this size */
+#define RING_BYTES_MAX		(16 * 1024 * 1024)
+#define RING_FRAMES_MIN		16
+
+/*
+ * Payload generated by one simtemp_flush() call in frame mode, at least
+ * one frame; bounds the time spent under ringbuf.lock with interrupts off
+ */
+#define FLUSH_PAYLOAD_MAX	(64 * 1024)
+
+/* Samples moved by one simtemp_flush() call without a payload */
+#define FLUSH_SAMPLES_MAX	1024
+
+/* Torn copies tolerated in one frame read() before giving up */
+#define FRAME_READ_RETRIES	4
+
+/*
+ * Per-CPU staging ring size (must be power of 2)
+ * Producers append here without taking the shared ring lock; the
+ * staged samples are merged into the main ring by simtemp_flush().
+ */
+#define STAGING_SIZE		256
+#define STAGING_MASK		(STAGING_SIZE - 1)
+
+/* Time without open files or mappings before the sample buffers are freed */
+#define DEFAULT_IDLE_TIMEOUT_MS	5000
+
+/* Pending samples on one CPU that make write() flush on its own */
+#define STAGING_FLUSH_BATCH	32
+
+/* Samples copied from user space per write() chunk */
+#define INJECT_BATCH		16
+
+/* Relay channel geometry (sub-buffers per CPU, bytes per sub-buffer) */
+#define DEFAULT_RELAY_SUBBUFS	8
+#define RELAY_SUBBUFS_MAX	256
+#define DEFAULT_RELAY_SUBBUF_SIZE	(64 * 1024)
+#define RELAY_SUBBUF_SIZE_MAX	(4 * 1024 * 1024)
+
+/*
+ * Compact sample history (sysfs history_kb): fixed-size blocks of
+ * encoded samples, the oldest block is evicted whole
+ */
+#define HISTORY_BLOCK_SIZE	4096
+#define HISTORY_BLOCKS_MIN	2
+#define HISTORY_KB_MAX		(64 * 1024)
+
+/* Samples copied to user space per read() chunk */
+#define READ_BATCH		16
+
+/* Tagged records buffered per open file of /dev/simtemp-all (power of 2) */
+#define MUX_FIFO_SIZE		4096
+#define MUX_FIFO_MASK		(MUX_FIFO_SIZE - 1)
+
+/* Delivery shaping limits (sysfs 'shaping') */
+#define SHAPING_JITTER_US_MAX	1000000
+#define SHAPING_BURST_MAX	STAGING_SIZE
+#define SHAPING_STALL_MS_MAX	60000
+#define SHAPING_PERIOD_MIN_NS	(10 * NSEC_PER_USEC)
+
+/*
+ * Thermal plant model (mode "plant"): first-order lag towards
+ * ambient + heat * R, where the fan divides R by up to 1 + PLANT_FAN_GAIN
+ */
+#define PLANT_AMBIENT_MC	25000
+#define PLANT_R_MC_PER_W	10000	/* 10 °C per W of heat load */
+#define PLANT_FAN_GAIN		3
+#define PLANT_TAU_MS		5000
+
+/* Thermal cooling device states (mapped onto 0..SIMTEMP_COOLING_MAX) */
+#define PLANT_COOLING_STATES	10
 
 /* Temperature generation modes */
 enum simtemp_mode {
 	SIMTEMP_MODE_NORMAL = 0,	/* Stable with small variations */
 	SIMTEMP_MODE_NOISY,		/* Large random variations */
 	SIMTEMP_MODE_RAMP,		/* Linear ramp up/down */
+	SIMTEMP_MODE_PLANT,		/* Thermal plant driven by the actuator */
+	SIMTEMP_MODE_REPLAY,		/* Only write()-injected samples */
+	SIMTEMP_MODE_SCENARIO,		/* Uploaded segment list (SIMTEMP_IOC_SET_SCENARIO) */
 };
 
-/* Statistics counters */
+/*
+ * Statistics counters
+ * Per-CPU (dev->stats): bumped with this_cpu_*() from any context and
+ * summed by simtemp_stats_read() without taking any lock.
+ */
 struct simtemp_stats {
 	u64 total_samples;		/* Total samples generated */
 	u64 threshold_alerts;		/* Times threshold was crossed */
 	u64 read_count;			/* Number of read() calls */
 	u64 poll_count;			/* Number of poll() calls */
-	u32 last_error;			/* Last error code */
+	u64 reader_overruns;		/* Records overwritten before a reader got them */
+	u64 injected_samples;		/* Samples injected via write() */
+	u64 staging_drops;		/* Samples dropped, staging full */
+	u64 jittered_ticks;		/* Ticks whose period was shaped */
+	u64 bursts;			/* Held bursts released at once */
+	u64 stalls;			/* Delivery stalls started */
+	u64 held_samples;		/* Samples delivered late by shaping */
+};
+
+/*
+ * Delivery shaping (sysfs 'shaping'), all zero = regular delivery
+ * Configuration and the PRNG are (re)set under config_lock with the timer
+ * stopped; otherwise everything here belongs to the timer callback.
+ */
+struct simtemp_shaping {
+	u32 jitter_us;			/* Tick period varies by up to +- this */
+	u32 burst;			/* Hold samples until this many are staged */
+	u32 stall_ms;			/* Length of a delivery stall */
+	u32 stall_permille;		/* Chance per tick that a stall starts */
+	u64 seed;			/* Same seed, same delivery pattern */
+
+	struct rnd_state rnd;
+	unsigned int held;		/* Samples staged but not delivered */
+	u64 stall_until_ns;		/* Delivery paused until then, 0 = none */
+	bool holding;			/* Burst or stall on, write() must not flush */
+};
+
+/*
+ * Per-CPU staging ring
+ * Single producer (the owning CPU, with local interrupts disabled) and
+ * single consumer (simtemp_flush(), serialized by ringbuf.lock).
+ */
+struct simtemp_staging {
+	struct simtemp_sample buffer[STAGING_SIZE];
+	unsigned int head;		/* Written by owning CPU only */
+	unsigned int tail;		/* Written by simtemp_flush() only */
+	unsigned int limit;		/* Head snapshot of the flush in progress */
 };
 
-/* Ring buffer for storing samples */
+/*
+ * Ring buffer for storing samples
+ * Overwrite ring with a single writer (simtemp_flush()) and per-reader
+ * cursors. hdr->head is the sequence number of the next record. Records
+ * are a sample, followed by payload_bytes of generated data in frame mode.
+ */
 struct simtemp_ringbuf {
-	struct simtemp_sample buffer[RING_BUFFER_SIZE];
-	unsigned int head;		/* Write position */
-	unsigned int tail;		/* Read position */
-	spinlock_t lock;		/* Protects buffer access */
+	struct simtemp_ring_header *hdr;	/* Header page, start of the mapping */
+	void *records;				/* Records, right after the header page */
+	unsigned int size;			/* Number of records (power of 2) */
+	unsigned int mask;			/* size - 1 */
+	unsigned int record_size;		/* Sample plus payload, in bytes */
+	unsigned int payload_bytes;		/* 0 = plain 16-byte samples */
+	unsigned int flush_max;			/* Records per simtemp_flush() */
+	size_t bytes;				/* Total allocation, mmap limit */
+	spinlock_t lock;			/* Serializes writer and kernel readers */
+};
+
+struct simtemp_device;
+
+/*
+ * Sample buffers of one instance
+ * Allocated on first open and unpublished after idle_timeout_ms without
+ * open files or mappings, so an idle instance only costs its
+ * simtemp_device. The device, every open file and every mapping hold a
+ * reference, so buffers unpublished by remove stay valid for files and
+ * mappings that outlive the instance. The readers' wait queue lives here
+ * for the same reason: poll registrations may outlive the instance.
+ */
+struct simtemp_buffers {
+	struct simtemp_ringbuf ringbuf;
+	struct simtemp_staging __percpu *staging;
+	cpumask_var_t flush_cpus;	/* Staging rings left to merge (ringbuf.lock) */
+	struct kref ref;
+
+	/* Blocking reads and poll() of the files holding these buffers */
+	wait_queue_head_t wait;
+
+	/*
+	 * Owning instance, NULL once it is removed; written under
+	 * simtemp_bufs_owner_lock, read by file operations under
+	 * simtemp_files_srcu (see simtemp_file_enter())
+	 */
+	struct simtemp_device *dev;
+};
+struct simtemp_listener;
+
+/*
+ * Listener callback: one merged sample of the listener's instance
+ * Called from simtemp_flush() with the instance's ring lock held and
+ * interrupts disabled, in timestamp order. Must not sleep.
+ */
+typedef void (*simtemp_deliver_fn)(struct simtemp_listener *listener,
+				   const struct simtemp_sample *sample);
+
+/*
+ * Optional listener callback: the simtemp_flush() that just delivered
+ * samples is done (same context and lock as deliver), so a listener can
+ * hand over what it batched
+ */
+typedef void (*simtemp_flushed_fn)(struct simtemp_listener *listener);
+
+/*
+ * Optional listener callback: the instance is going away and has just
+ * detached the listener (@dev is already NULL), so its owner can wake
+ * whoever waits for samples. Process context, called with
+ * simtemp_listener_lock held: must not attach or detach listeners.
+ */
+typedef void (*simtemp_removed_fn)(struct simtemp_listener *listener);
+
+/*
+ * In-kernel consumer of an instance's samples (the /dev/simtemp-all
+ * multiplexer subscriptions, for one)
+ * Attached with simtemp_listener_attach(); detached either by its owner
+ * or when the instance goes away, after which @dev is NULL.
+ */
+struct simtemp_listener {
+	struct list_head node;		/* dev->listeners, RCU */
+	struct simtemp_device *dev;	/* Under simtemp_listener_lock */
+	simtemp_deliver_fn deliver;
+	simtemp_flushed_fn flushed;	/* May be NULL */
+	simtemp_removed_fn removed;	/* May be NULL */
 };
 
+/*
+ * Producer variant: builds one sample for a fixed configuration
+ * combination (see simtemp_select_producer()); NULL in "replay" mode,
+ * where the timer only delivers what writers staged
+ */
+typedef void (*simtemp_produce_fn)(struct simtemp_device *dev,
+				   struct simtemp_sample *sample);
+
+/*
+ * Forward variant: programs the timer's next tick, chosen together with
+ * the producer so the timer callback never tests the mode
+ */
+typedef void (*simtemp_forward_fn)(struct simtemp_device *dev,
+				   struct hrtimer *timer);
+
+/*
+ * Stage variant: stages the tick's sample and flushes it, through the
+ * burst/stall logic only when delivery shaping asks for it
+ */
+typedef void (*simtemp_stage_fn)(struct simtemp_device *dev,
+				 struct simtemp_buffers *bufs,
+				 const struct simtemp_sample *sample);
+
 /* Main device structure */
 struct simtemp_device {
 	/* Platform device */
 	struct platform_device *pdev;
 
+	/* Instance number: 0 is /dev/simtemp, N is /dev/simtempN */
+	u32 id;
+	char name[16];
+
 	/* Character device */
 	struct miscdevice miscdev;
 
@@ -71,11 +310,22 @@ struct simtemp_device {
 	struct hrtimer timer;
 	ktime_t sampling_period;
 
-	/* Ring buffer */
-	struct simtemp_ringbuf ringbuf;
+	/*
+	 * Ring buffer and per-CPU staging rings, NULL while idle
+	 * Published with RCU for the timer; users (open files and mappings)
+	 * are counted under bufs_lock and keep them alive.
+	 */
+	struct simtemp_buffers __rcu *bufs;
+	struct mutex bufs_lock;
+	unsigned int users;
+	struct delayed_work idle_work;
 
-	/* Wait queue for blocking reads */
-	wait_queue_head_t wait_queue;
+	/*
+	 * Listeners fed at the publish point in simtemp_flush(); RCU list,
+	 * modified under simtemp_listener_lock. Each one is a buffers user.
+	 */
+	struct list_head listeners;
+	bool removing;			/* No new listeners, under simtemp_listener_lock */
 
 	/* Configuration (protected by config_lock) */
 	struct mutex config_lock;
@@ -83,30 +333,166 @@ struct simtemp_device {
 	s32 threshold_mC;
 	enum simtemp_mode mode;
 
+	/* Frame payload of buffers allocated from now on (under bufs_lock) */
+	u32 payload_bytes;
+
+	/* Delivery shaping for consumer stress tests */
+	struct simtemp_shaping shaping;
+
+	/* Active producer, stage and forward variants (under config_lock) */
+	simtemp_produce_fn producer;
+	simtemp_stage_fn stage;
+	simtemp_forward_fn forward;
+
 	/* Temperature generation state */
 	s32 current_temp_mC;
 	bool ramp_direction;		/* true = up, false = down */
+	s64 plant_uC;			/* Plant temperature, micro-Celsius */
+
+	/* Loaded scenario, replaced under config_lock, RCU for the timer */
+	struct simtemp_scenario __rcu *scenario;
 
-	/* Statistics */
-	struct simtemp_stats stats;
+	/*
+	 * Actuator page, allocated on first use under config_lock and
+	 * published with release semantics for the timer; freed on remove
+	 */
+	struct simtemp_control *ctrl;
+	struct thermal_cooling_device *cdev;	/* Optional cooling device */
+
+	/* Optional debugfs relay channel (nxp_simtemp_relay.c) */
+	struct simtemp_relay *relay;
+
+	/* Compact sample history (nxp_simtemp_history.c) */
+	struct simtemp_history *history;
+
+	/* Statistics (per-CPU, allocated before the instance is visible) */
+	struct simtemp_stats __percpu *stats;
 
 	/* Flags */
 	bool threshold_crossed;
-	bool device_open;
 };
 
+/*
+ * Per-open-file reader state (filp->private_data)
+ * The counters are only reported through /proc/<pid>/fdinfo/<fd>, so
+ * they are plain counters updated by the file's own callers. The file
+ * may outlive its instance, so it only keeps the buffers and finds the
+ * instance through bufs->dev.
+ */
+struct simtemp_reader {
+	struct simtemp_buffers *bufs;	/* Held for the lifetime of the file */
+	u32 cursor;			/* Sequence number of next record to read */
+	u32 watermark;			/* Records pending before EPOLLIN / wakeup */
+	u64 dropped;			/* Records overwritten before they were read */
+	u64 samples_read;		/* Records copied out by read() */
+	u64 bytes_read;			/* Bytes copied out by read() */
+	u64 read_count;			/* Number of read() calls */
+	u64 poll_count;			/* Number of poll() calls */
+	u64 wakeups;			/* Blocking read() woken up */
+
+	/* Busy polling (SIMTEMP_IOC_SET_BUSY_POLL) */
+	u32 busy_poll_us;		/* Spin budget, 0 = sleep at once */
+	u64 last_ts_ns;			/* Timestamp of the newest record read */
+	u64 interval_ns;		/* EWMA of the inter-sample interval */
+	u64 busy_hits;			/* Spins that found data */
+	u64 busy_misses;		/* Spins that ran out of budget */
+	u64 busy_skips;			/* Next sample too far away to spin for */
+
+	/* Frames are copied without ringbuf.lock, one reader at a time */
+	struct mutex read_lock;
+};
+
+/* Probed instances, indexed by instance number (nxp_simtemp_main.c) */
+extern struct xarray simtemp_instances;
+
 /* Function declarations */
 
-/* Core functions (nxp_simtemp.c) - all static, no external declarations needed */
+/* Core functions (nxp_simtemp_main.c) - all static, no external declarations needed */
 
 /* Temperature generation - all static in .c file */
 
-/* Ring buffer operations */
-void simtemp_ringbuf_init(struct simtemp_ringbuf *rb);
-int simtemp_ringbuf_put(struct simtemp_ringbuf *rb, struct simtemp_sample *sample);
-int simtemp_ringbuf_get(struct simtemp_ringbuf *rb, struct simtemp_sample *sample);
-bool simtemp_ringbuf_empty(struct simtemp_ringbuf *rb);
-unsigned int simtemp_ringbuf_count(struct simtemp_ringbuf *rb);
+/* Ring buffer operations (nxp_simtemp_ring.c) */
+int simtemp_ringbuf_init(struct simtemp_ringbuf *rb, unsigned int size,
+			 unsigned int payload_bytes);
+void simtemp_ringbuf_free(struct simtemp_ringbuf *rb);
+u32 simtemp_ringbuf_pending(struct simtemp_ringbuf *rb, u32 cursor);
+void simtemp_ringbuf_put(struct simtemp_ringbuf *rb, const struct simtemp_sample *sample);
+unsigned int simtemp_ringbuf_read(struct simtemp_ringbuf *rb, u32 *cursor,
+				  struct simtemp_sample *batch, unsigned int max,
+				  u64 *dropped);
+int simtemp_ringbuf_read_frames(struct simtemp_ringbuf *rb, u32 *cursor,
+				struct iov_iter *to, unsigned int max,
+				u64 *dropped, u64 *newest_ns);
+int simtemp_ringbuf_peek(struct simtemp_ringbuf *rb, struct simtemp_sample *sample);
+int simtemp_ringbuf_aggregate(struct simtemp_ringbuf *rb, unsigned int window,
+			      struct simtemp_aggregate *agg);
+
+/* Per-CPU staging operations (nxp_simtemp_ring.c) */
+unsigned int simtemp_stage(struct simtemp_buffers *bufs,
+			   const struct simtemp_sample *samples, unsigned int n,
+			   unsigned int *dropped);
+unsigned int simtemp_flush(struct simtemp_device *dev, struct simtemp_buffers *bufs);
+unsigned int simtemp_flush_all(struct simtemp_device *dev, struct simtemp_buffers *bufs);
+
+/* Sample buffer allocation (nxp_simtemp_ring.c) */
+struct simtemp_buffers *simtemp_buffers_alloc(unsigned int ring_size,
+					      unsigned int payload_bytes);
+void simtemp_buffers_unref(struct simtemp_buffers *bufs);
+size_t simtemp_buffers_bytes(struct simtemp_buffers *bufs);
+
+/* Listeners (nxp_simtemp_main.c) */
+int simtemp_listener_attach(u32 instance, struct simtemp_listener *listener);
+bool simtemp_listener_detach(struct simtemp_listener *listener);
+
+/* Closed-loop plant and actuator input (nxp_simtemp_plant.c) */
+s32 simtemp_plant_step(struct simtemp_device *dev);
+long simtemp_actuator_ioctl(struct simtemp_device *dev, struct simtemp_actuator __user *uact);
+int simtemp_control_mmap(struct simtemp_device *dev, struct vm_area_struct *vma);
+void simtemp_plant_init(struct simtemp_device *dev, bool cooling_device);
+void simtemp_plant_exit(struct simtemp_device *dev);
+
+/* Scenario mode (nxp_simtemp_scenario.c) */
+s32 simtemp_scenario_step(struct simtemp_device *dev);
+void simtemp_scenario_forward(struct simtemp_device *dev, struct hrtimer *timer);
+struct simtemp_scenario *simtemp_scenario_load(struct simtemp_scenario_req __user *ureq);
+void simtemp_scenario_set(struct simtemp_device *dev, struct simtemp_scenario *sc);
+int simtemp_scenario_restart(struct simtemp_device *dev);
+ssize_t simtemp_scenario_show(struct simtemp_device *dev, char *buf);
+void simtemp_scenario_exit(struct simtemp_device *dev);
+
+/* In-kernel subscribers: see nxp_simtemp_subscriber.h (nxp_simtemp_subscriber.c) */
+
+/* BPF kfuncs for tracing programs (nxp_simtemp_bpf.c) */
+int simtemp_bpf_init(void);
+
+/* Relay channel in debugfs (nxp_simtemp_relay.c) */
+void simtemp_relay_init(struct simtemp_device *dev, unsigned int n_subbufs,
+			unsigned int subbuf_size);
+void simtemp_relay_exit(struct simtemp_device *dev);
+
+/* Compact sample history (nxp_simtemp_history.c) */
+int simtemp_history_init(struct simtemp_device *dev);
+int simtemp_history_resize(struct simtemp_device *dev, unsigned int budget_kb);
+long simtemp_history_ioctl(struct simtemp_device *dev, struct simtemp_history_req __user *ureq);
+unsigned int simtemp_history_budget(struct simtemp_device *dev);
+size_t simtemp_history_bytes(struct simtemp_device *dev);
+ssize_t simtemp_history_show(struct simtemp_device *dev, char *buf);
+void simtemp_history_exit(struct simtemp_device *dev);
+
+/* Per-view stream fds (nxp_simtemp_view.c) */
+long simtemp_view_open(struct simtemp_device *dev, struct simtemp_view_req __user *ureq);
+
+/* Multiplexer device /dev/simtemp-all (nxp_simtemp_mux.c) */
+int simtemp_mux_init(void);
+void simtemp_mux_exit(void);
+
+/* Statistics (nxp_simtemp_main.c, nxp_simtemp_stats.c) */
+void simtemp_stats_read(struct simtemp_device *dev, struct simtemp_stats *sum);
+void simtemp_stats_record(struct simtemp_device *dev, struct simtemp_stats_record *rec);
+long simtemp_stats_ioctl(struct simtemp_stats_query __user *uquery);
+extern struct dentry *simtemp_debugfs_dir;
+void simtemp_debugfs_init(void);
+void simtemp_debugfs_exit(void);
 
 /* File operations - all static, no external declarations needed */
 
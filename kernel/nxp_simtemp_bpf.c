@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * BPF kfuncs for tracing programs
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * Lets tracing BPF programs (fentry/fexit, tp_btf, ...) read an instance's
+ * newest sample, counters and a min/max/mean over its newest samples, so
+ * temperatures can be correlated with scheduler or power events in the
+ * kernel at event rate. A program declares them as
+ *
+ *	extern int bpf_simtemp_latest(u32 instance, void *sample,
+ *				      u32 sample__sz) __ksym;
+ *	extern int bpf_simtemp_stats(u32 instance, void *rec, u32 rec__sz) __ksym;
+ *	extern int bpf_simtemp_aggregate(u32 instance, u32 window, void *agg,
+ *					 u32 agg__sz) __ksym;
+ *
+ * and passes an initialized struct simtemp_sample, simtemp_stats_record
+ * or simtemp_aggregate together with its sizeof().
+ *
+ * Tracing programs may run in any context, NMI included, so nothing here
+ * takes a lock or sleeps: the instance is looked up with xa_load() under
+ * RCU (remove unpublishes it before a grace period, see simtemp_remove()),
+ * its sample buffers are RCU-protected already, and the ring is read with
+ * the lockless validation of the mmap readers. Reading never allocates
+ * the buffers: an idle instance returns -ENODATA.
+ */
+
+#include <linux/kernel.h>
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/rcupdate.h>
+#include <linux/xarray.h>
+
+#include "nxp_simtemp.h"
+
+/* Largest window of bpf_simtemp_aggregate(), bounds its cost per call */
+#define BPF_AGGREGATE_MAX	4096
+
+/*
+ * Sample buffers of @instance, NULL if there are none
+ * Caller holds rcu_read_lock(); *@ret is set to the error to return.
+ */
+static struct simtemp_buffers *simtemp_bpf_buffers(u32 instance, int *ret)
+{
+	struct simtemp_device *dev;
+	struct simtemp_buffers *bufs;
+
+	dev = xa_load(&simtemp_instances, instance);
+	if (!dev) {
+		*ret = -ENODEV;
+		return NULL;
+	}
+
+	bufs = rcu_dereference(dev->bufs);
+	if (!bufs)
+		*ret = -ENODATA;
+
+	return bufs;
+}
+
+__bpf_kfunc_start_defs();
+
+/*
+ * Copy the newest sample of @instance
+ * Returns 0, -EINVAL (wrong size), -ENODEV, -ENODATA (idle or no sample
+ * yet) or -EAGAIN.
+ */
+__bpf_kfunc int bpf_simtemp_latest(u32 instance, void *sample, u32 sample__sz)
+{
+	struct simtemp_buffers *bufs;
+	int ret;
+
+	if (sample__sz != sizeof(struct simtemp_sample))
+		return -EINVAL;
+
+	rcu_read_lock();
+	bufs = simtemp_bpf_buffers(instance, &ret);
+	if (bufs)
+		ret = simtemp_ringbuf_peek(&bufs->ringbuf, sample);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+/*
+ * Copy the counters of @instance, as SIMTEMP_IOC_GET_STATS returns them
+ * Works on idle instances too. Returns 0, -EINVAL or -ENODEV.
+ */
+__bpf_kfunc int bpf_simtemp_stats(u32 instance, void *rec, u32 rec__sz)
+{
+	struct simtemp_device *dev;
+	int ret = 0;
+
+	if (rec__sz != sizeof(struct simtemp_stats_record))
+		return -EINVAL;
+
+	rcu_read_lock();
+	dev = xa_load(&simtemp_instances, instance);
+	if (dev)
+		simtemp_stats_record(dev, rec);
+	else
+		ret = -ENODEV;
+	rcu_read_unlock();
+
+	return ret;
+}
+
+/*
+ * min/max/mean of the @window newest samples of @instance (at most
+ * BPF_AGGREGATE_MAX and half the ring)
+ * Returns the number of samples aggregated, or -EINVAL, -ENODEV,
+ * -ENODATA, -EAGAIN.
+ */
+__bpf_kfunc int bpf_simtemp_aggregate(u32 instance, u32 window, void *agg, u32 agg__sz)
+{
+	struct simtemp_buffers *bufs;
+	int ret;
+
+	if (agg__sz != sizeof(struct simtemp_aggregate) || !window)
+		return -EINVAL;
+
+	rcu_read_lock();
+	bufs = simtemp_bpf_buffers(instance, &ret);
+	if (bufs)
+		ret = simtemp_ringbuf_aggregate(&bufs->ringbuf,
+						min_t(u32, window, BPF_AGGREGATE_MAX), agg);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+__bpf_kfunc_end_defs();
+
+BTF_KFUNCS_START(simtemp_kfunc_ids)
+BTF_ID_FLAGS(func, bpf_simtemp_latest)
+BTF_ID_FLAGS(func, bpf_simtemp_stats)
+BTF_ID_FLAGS(func, bpf_simtemp_aggregate)
+BTF_KFUNCS_END(simtemp_kfunc_ids)
+
+static const struct btf_kfunc_id_set simtemp_kfunc_set = {
+	.owner	= THIS_MODULE,
+	.set	= &simtemp_kfunc_ids,
+};
+
+/*
+ * Make the kfuncs callable from tracing programs
+ * Without BPF or module BTF in the kernel this does nothing.
+ */
+int simtemp_bpf_init(void)
+{
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_TRACING, &simtemp_kfunc_set);
+}
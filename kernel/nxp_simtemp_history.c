@@ -0,0 +1,627 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Compact sample history
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * The sample ring keeps whole 16-byte records, because readers map it and
+ * copy records out in place. For retention that is wasteful: timestamps
+ * advance by an almost constant period, temperatures move by a few mC and
+ * the flags rarely change. The history keeps a second, encoded copy of an
+ * instance's samples within a fixed budget (sysfs history_kb), and
+ * SIMTEMP_IOC_READ_HISTORY decodes it into the record type the reader asks
+ * for.
+ *
+ * The budget is split into HISTORY_BLOCK_SIZE blocks, used as a ring: a
+ * full history evicts its oldest block whole. A block stores its first
+ * sample whole in the header; every following sample is
+ *
+ *	tag		bit 7: flags changed, bits 6-0: zigzag temperature
+ *			delta of -63..63 mC, or 0x7f: temperature follows
+ *	[temp_mC]	4 bytes, little endian, only with 0x7f
+ *	dt		varint, zigzag change of the interval to the
+ *			previous sample (0 for a regular period)
+ *	[flags]		varint, only with bit 7
+ *
+ * so a periodic sample usually takes 2 to 4 bytes. Blocks decode on their
+ * own, from their header.
+ *
+ * While enabled the history is a listener of the instance, so the
+ * instance keeps sampling; the encoder runs at the publish point and
+ * takes wlock inside the ring lock. Readers copy one block at a time
+ * under wlock and decode the copy without it.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/overflow.h>
+#include <linux/uaccess.h>
+#include <linux/math64.h>
+#include <linux/sysfs.h>
+#include <linux/unaligned.h>
+
+#include "nxp_simtemp.h"
+
+/* Tag byte */
+#define HISTORY_TAG_FLAGS	0x80	/* Flags changed, varint follows */
+#define HISTORY_TAG_ESCAPE	0x7f	/* Temperature stored whole */
+#define HISTORY_DELTA_MAX	63
+
+/* Longest encoded sample: tag, temperature, 64-bit and 32-bit varints */
+#define HISTORY_SAMPLE_MAX	(1 + 4 + 10 + 5)
+
+/* Decoded records copied to user space per chunk */
+#define HISTORY_OUT_BYTES	4096
+
+struct simtemp_history_block {
+	u64 first_seq;			/* Sequence number of the first sample */
+	u64 first_ns;			/* First sample, stored whole */
+	u64 last_ns;			/* Timestamp of the last sample */
+	s32 first_mC;
+	u32 first_flags;
+	u32 count;			/* Samples, the first one included */
+	u32 bytes;			/* Encoded bytes in data[] */
+	u8 data[];
+};
+
+#define HISTORY_BLOCK_DATA	(HISTORY_BLOCK_SIZE - sizeof(struct simtemp_history_block))
+
+struct simtemp_history {
+	struct simtemp_listener listener;
+
+	/* Budget changes and readers */
+	struct mutex lock;
+	unsigned int budget_kb;		/* 0 = disabled */
+	void *scratch;			/* Reader's copy of one block */
+	void *out;			/* Decoded records on their way out */
+
+	/* Blocks, under wlock (taken by the encoder inside ringbuf.lock) */
+	spinlock_t wlock;
+	void *blocks;
+	unsigned int nblocks;
+	unsigned int first;		/* Oldest block */
+	unsigned int used;		/* Blocks holding samples */
+	u64 next_seq;			/* Sequence number of the next sample */
+
+	/* Encoder state, previous sample */
+	u64 prev_ns;
+	s64 prev_dt;
+	s32 prev_mC;
+	u32 prev_flags;
+};
+
+/* Decoding position in a block */
+struct simtemp_history_decoder {
+	const u8 *p;
+	u32 left;			/* Samples after the current one */
+	s64 dt;				/* Interval before the current sample */
+	struct simtemp_sample sample;	/* Current sample */
+};
+
+/* State of one SIMTEMP_IOC_READ_HISTORY call */
+struct simtemp_history_out {
+	struct simtemp_history_req req;
+	void *buf;			/* hist->out */
+	unsigned int batched;		/* Records in buf */
+	u64 committed;			/* Cursor after the last record emitted */
+	struct simtemp_aggregate agg;	/* AGGREGATES: window in progress */
+	s64 agg_sum;
+};
+
+static inline u64 simtemp_zigzag(s64 val)
+{
+	return ((u64)val << 1) ^ (u64)(val >> 63);
+}
+
+static inline s64 simtemp_unzigzag(u64 val)
+{
+	return (s64)(val >> 1) ^ -(s64)(val & 1);
+}
+
+static inline u8 *simtemp_put_varint(u8 *p, u64 val)
+{
+	while (val >= 0x80) {
+		*p++ = (u8)val | 0x80;
+		val >>= 7;
+	}
+	*p++ = val;
+
+	return p;
+}
+
+static inline const u8 *simtemp_get_varint(const u8 *p, u64 *val)
+{
+	unsigned int shift = 0;
+	u64 v = 0;
+
+	do {
+		v |= (u64)(*p & 0x7f) << shift;
+		shift += 7;
+	} while (*p++ & 0x80);
+
+	*val = v;
+	return p;
+}
+
+static inline struct simtemp_history_block *simtemp_history_block(struct simtemp_history *hist,
+								   unsigned int index)
+{
+	return hist->blocks + (size_t)(index % hist->nblocks) * HISTORY_BLOCK_SIZE;
+}
+
+/*
+ * Start a block for the next sample, evicting the oldest one when the
+ * budget is used up (under wlock)
+ */
+static struct simtemp_history_block *simtemp_history_new_block(struct simtemp_history *hist)
+{
+	if (hist->used < hist->nblocks)
+		hist->used++;
+	else
+		hist->first = (hist->first + 1) % hist->nblocks;
+
+	return simtemp_history_block(hist, hist->first + hist->used - 1);
+}
+
+/*
+ * Listener callback: encode one sample (under ringbuf.lock, interrupts
+ * disabled)
+ */
+static void simtemp_history_deliver(struct simtemp_listener *listener,
+				    const struct simtemp_sample *sample)
+{
+	struct simtemp_history *hist = container_of(listener, struct simtemp_history, listener);
+	struct simtemp_history_block *blk = NULL;
+	s64 dt, delta;
+	u8 *p, tag;
+
+	spin_lock(&hist->wlock);
+
+	if (hist->used)
+		blk = simtemp_history_block(hist, hist->first + hist->used - 1);
+
+	if (!blk || blk->bytes > HISTORY_BLOCK_DATA - HISTORY_SAMPLE_MAX) {
+		blk = simtemp_history_new_block(hist);
+		blk->first_seq = hist->next_seq;
+		blk->first_ns = sample->timestamp_ns;
+		blk->first_mC = sample->temp_mC;
+		blk->first_flags = sample->flags;
+		blk->count = 0;
+		blk->bytes = 0;
+		hist->prev_dt = 0;
+	} else {
+		dt = sample->timestamp_ns - hist->prev_ns;
+		delta = (s64)sample->temp_mC - hist->prev_mC;
+		p = blk->data + blk->bytes;
+
+		tag = sample->flags != hist->prev_flags ? HISTORY_TAG_FLAGS : 0;
+		if (delta >= -HISTORY_DELTA_MAX && delta <= HISTORY_DELTA_MAX)
+			tag |= simtemp_zigzag(delta);
+		else
+			tag |= HISTORY_TAG_ESCAPE;
+
+		*p++ = tag;
+		if ((tag & HISTORY_TAG_ESCAPE) == HISTORY_TAG_ESCAPE) {
+			put_unaligned_le32(sample->temp_mC, p);
+			p += 4;
+		}
+		p = simtemp_put_varint(p, simtemp_zigzag(dt - hist->prev_dt));
+		if (tag & HISTORY_TAG_FLAGS)
+			p = simtemp_put_varint(p, sample->flags);
+
+		blk->bytes = p - blk->data;
+		hist->prev_dt = dt;
+	}
+
+	blk->count++;
+	blk->last_ns = sample->timestamp_ns;
+
+	hist->prev_ns = sample->timestamp_ns;
+	hist->prev_mC = sample->temp_mC;
+	hist->prev_flags = sample->flags;
+	hist->next_seq++;
+
+	spin_unlock(&hist->wlock);
+}
+
+static void simtemp_history_decode_first(struct simtemp_history_decoder *dec,
+					 const struct simtemp_history_block *blk)
+{
+	dec->p = blk->data;
+	dec->left = blk->count - 1;
+	dec->dt = 0;
+	dec->sample.timestamp_ns = blk->first_ns;
+	dec->sample.temp_mC = blk->first_mC;
+	dec->sample.flags = blk->first_flags;
+}
+
+/* Caller checks dec->left */
+static void simtemp_history_decode_next(struct simtemp_history_decoder *dec)
+{
+	u8 tag = *dec->p++;
+	u64 val;
+
+	if ((tag & HISTORY_TAG_ESCAPE) == HISTORY_TAG_ESCAPE) {
+		dec->sample.temp_mC = get_unaligned_le32(dec->p);
+		dec->p += 4;
+	} else {
+		dec->sample.temp_mC += simtemp_unzigzag(tag & HISTORY_TAG_ESCAPE);
+	}
+
+	dec->p = simtemp_get_varint(dec->p, &val);
+	dec->dt += simtemp_unzigzag(val);
+	dec->sample.timestamp_ns += dec->dt;
+
+	if (tag & HISTORY_TAG_FLAGS) {
+		dec->p = simtemp_get_varint(dec->p, &val);
+		dec->sample.flags = val;
+	}
+
+	dec->left--;
+}
+
+/*
+ * Record builders, one per output type
+ * Return true when @sample completed a record in out->buf.
+ */
+typedef bool (*simtemp_history_emit_fn)(struct simtemp_history_out *out,
+					const struct simtemp_sample *sample);
+
+static bool simtemp_history_emit_raw(struct simtemp_history_out *out,
+				     const struct simtemp_sample *sample)
+{
+	memcpy(out->buf + out->batched * sizeof(*sample), sample, sizeof(*sample));
+	return true;
+}
+
+static bool simtemp_history_emit_aggregates(struct simtemp_history_out *out,
+					    const struct simtemp_sample *sample)
+{
+	struct simtemp_aggregate *agg = &out->agg;
+
+	if (!agg->count) {
+		agg->first_ns = sample->timestamp_ns;
+		agg->min_mC = sample->temp_mC;
+		agg->max_mC = sample->temp_mC;
+		out->agg_sum = 0;
+	}
+
+	agg->last_ns = sample->timestamp_ns;
+	agg->min_mC = min(agg->min_mC, sample->temp_mC);
+	agg->max_mC = max(agg->max_mC, sample->temp_mC);
+	out->agg_sum += sample->temp_mC;
+
+	if (++agg->count < out->req.window)
+		return false;
+
+	agg->mean_mC = div_s64(out->agg_sum, agg->count);
+	memcpy(out->buf + out->batched * sizeof(*agg), agg, sizeof(*agg));
+	agg->count = 0;
+	return true;
+}
+
+static const simtemp_history_emit_fn simtemp_history_emit[] = {
+	[SIMTEMP_VIEW_RAW]		= simtemp_history_emit_raw,
+	[SIMTEMP_VIEW_AGGREGATES]	= simtemp_history_emit_aggregates,
+};
+
+static const unsigned int simtemp_history_rsize[] = {
+	[SIMTEMP_VIEW_RAW]		= sizeof(struct simtemp_sample),
+	[SIMTEMP_VIEW_AGGREGATES]	= sizeof(struct simtemp_aggregate),
+};
+
+/*
+ * Copy the batched records to the caller's array
+ */
+static int simtemp_history_flush(struct simtemp_history_out *out)
+{
+	unsigned int rsize = simtemp_history_rsize[out->req.type];
+	void __user *urecords = u64_to_user_ptr(out->req.records);
+
+	if (!out->batched)
+		return 0;
+
+	if (copy_to_user(urecords + (size_t)out->req.count * rsize, out->buf,
+			 (size_t)out->batched * rsize))
+		return -EFAULT;
+
+	out->req.count += out->batched;
+	out->batched = 0;
+	return 0;
+}
+
+/*
+ * SIMTEMP_IOC_READ_HISTORY: decode the history from the caller's cursor
+ * into up to capacity records
+ */
+long simtemp_history_ioctl(struct simtemp_device *dev, struct simtemp_history_req __user *ureq)
+{
+	struct simtemp_history *hist = dev->history;
+	struct simtemp_history_out out = {};
+	struct simtemp_history_decoder dec;
+	struct simtemp_history_block *blk;
+	simtemp_history_emit_fn emit;
+	unsigned int batch, i;
+	unsigned long flags;
+	u64 pos, seq;
+	long ret = 0;
+
+	if (copy_from_user(&out.req, ureq, sizeof(out.req)))
+		return -EFAULT;
+
+	switch (out.req.type) {
+	case SIMTEMP_VIEW_RAW:
+		if (out.req.window)
+			return -EINVAL;
+		break;
+	case SIMTEMP_VIEW_AGGREGATES:
+		if (!out.req.window || out.req.window > SIMTEMP_VIEW_WINDOW_MAX)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (!hist)
+		return -ENODATA;
+
+	emit = simtemp_history_emit[out.req.type];
+	batch = HISTORY_OUT_BYTES / simtemp_history_rsize[out.req.type];
+	out.req.count = 0;
+
+	mutex_lock(&hist->lock);
+
+	if (!hist->nblocks) {
+		ret = -ENODATA;
+		goto out;
+	}
+
+	out.buf = hist->out;
+	pos = out.committed = out.req.cursor;
+
+	for (;;) {
+		spin_lock_irqsave(&hist->wlock, flags);
+
+		out.req.oldest = hist->used ?
+				 simtemp_history_block(hist, hist->first)->first_seq :
+				 hist->next_seq;
+		out.req.next = hist->next_seq;
+
+		/* Evicted since the cursor: a partial window starts over */
+		if (pos < out.req.oldest) {
+			pos = out.committed = out.req.oldest;
+			out.agg.count = 0;
+		}
+
+		if (pos >= out.req.next || out.req.count + out.batched >= out.req.capacity) {
+			spin_unlock_irqrestore(&hist->wlock, flags);
+			break;
+		}
+
+		/* Blocks hold consecutive sequence numbers, oldest first */
+		for (i = 0; i < hist->used; i++) {
+			blk = simtemp_history_block(hist, hist->first + i);
+			if (pos - blk->first_seq < blk->count)
+				break;
+		}
+		memcpy(hist->scratch, blk, sizeof(*blk) + blk->bytes);
+
+		spin_unlock_irqrestore(&hist->wlock, flags);
+
+		blk = hist->scratch;
+		simtemp_history_decode_first(&dec, blk);
+
+		for (seq = blk->first_seq; ; seq++) {
+			if (seq >= pos && emit(&out, &dec.sample)) {
+				out.committed = seq + 1;
+				if (++out.batched == batch) {
+					ret = simtemp_history_flush(&out);
+					if (ret)
+						goto out;
+				}
+				if (out.req.count + out.batched == out.req.capacity)
+					break;
+			}
+
+			if (!dec.left)
+				break;
+			simtemp_history_decode_next(&dec);
+		}
+		pos = seq + 1;
+	}
+
+	ret = simtemp_history_flush(&out);
+	if (ret)
+		goto out;
+
+	out.req.cursor = out.committed;
+	if (copy_to_user(ureq, &out.req, sizeof(out.req)))
+		ret = -EFAULT;
+out:
+	mutex_unlock(&hist->lock);
+	return ret;
+}
+
+static void simtemp_history_free(struct simtemp_history *hist)
+{
+	vfree(hist->blocks);
+	kfree(hist->scratch);
+	kfree(hist->out);
+	hist->blocks = NULL;
+	hist->scratch = NULL;
+	hist->out = NULL;
+	hist->nblocks = 0;
+}
+
+/*
+ * Allocate an empty history of @nblocks blocks
+ * Caller holds hist->lock; the listener is not attached.
+ */
+static int simtemp_history_alloc(struct simtemp_history *hist, unsigned int nblocks)
+{
+	hist->blocks = vmalloc(array_size(nblocks, HISTORY_BLOCK_SIZE));
+	hist->scratch = kmalloc(HISTORY_BLOCK_SIZE, GFP_KERNEL);
+	hist->out = kmalloc(HISTORY_OUT_BYTES, GFP_KERNEL);
+	if (!hist->blocks || !hist->scratch || !hist->out) {
+		simtemp_history_free(hist);
+		return -ENOMEM;
+	}
+
+	hist->nblocks = nblocks;
+	hist->first = 0;
+	hist->used = 0;
+	hist->next_seq = 0;
+	return 0;
+}
+
+/*
+ * Set the history budget, discarding what was recorded (0 disables it)
+ * The budget is rounded down to whole blocks, at least HISTORY_BLOCKS_MIN.
+ */
+int simtemp_history_resize(struct simtemp_device *dev, unsigned int budget_kb)
+{
+	struct simtemp_history *hist = dev->history;
+	unsigned int nblocks = 0;
+	int ret = 0;
+
+	if (!hist)
+		return -ENODEV;
+
+	if (budget_kb > HISTORY_KB_MAX)
+		return -EINVAL;
+
+	if (budget_kb)
+		nblocks = max_t(unsigned int, budget_kb * 1024 / HISTORY_BLOCK_SIZE,
+				HISTORY_BLOCKS_MIN);
+
+	mutex_lock(&hist->lock);
+
+	/* The encoder may run until a grace period passed */
+	if (hist->nblocks) {
+		simtemp_listener_detach(&hist->listener);
+		synchronize_rcu();
+		simtemp_history_free(hist);
+	}
+
+	if (nblocks) {
+		ret = simtemp_history_alloc(hist, nblocks);
+		if (!ret) {
+			ret = simtemp_listener_attach(dev->id, &hist->listener);
+			if (ret)
+				simtemp_history_free(hist);
+		}
+	}
+
+	WRITE_ONCE(hist->budget_kb, ret ? 0 : budget_kb);
+	mutex_unlock(&hist->lock);
+
+	return ret;
+}
+
+unsigned int simtemp_history_budget(struct simtemp_device *dev)
+{
+	return dev->history ? READ_ONCE(dev->history->budget_kb) : 0;
+}
+
+/*
+ * Memory held by the history (sysfs 'memory')
+ */
+size_t simtemp_history_bytes(struct simtemp_device *dev)
+{
+	struct simtemp_history *hist = dev->history;
+	size_t bytes = 0;
+
+	if (!hist)
+		return 0;
+
+	mutex_lock(&hist->lock);
+	if (hist->nblocks)
+		bytes = (size_t)hist->nblocks * HISTORY_BLOCK_SIZE +
+			HISTORY_BLOCK_SIZE + HISTORY_OUT_BYTES;
+	mutex_unlock(&hist->lock);
+
+	return bytes;
+}
+
+/*
+ * sysfs 'history': what the history currently retains
+ */
+ssize_t simtemp_history_show(struct simtemp_device *dev, char *buf)
+{
+	struct simtemp_history *hist = dev->history;
+	struct simtemp_history_block *oldest, *newest;
+	unsigned int nblocks = 0, used = 0;
+	u64 samples = 0, span_ns = 0;
+	size_t bytes = 0;
+	unsigned long flags;
+
+	if (!hist)
+		return -ENODEV;
+
+	mutex_lock(&hist->lock);
+	if (hist->nblocks) {
+		spin_lock_irqsave(&hist->wlock, flags);
+		nblocks = hist->nblocks;
+		used = hist->used;
+		if (used) {
+			oldest = simtemp_history_block(hist, hist->first);
+			newest = simtemp_history_block(hist, hist->first + used - 1);
+			samples = hist->next_seq - oldest->first_seq;
+			span_ns = newest->last_ns - oldest->first_ns;
+			/* Full blocks waste less than HISTORY_SAMPLE_MAX bytes */
+			bytes = (size_t)(used - 1) * HISTORY_BLOCK_SIZE +
+				sizeof(*newest) + newest->bytes;
+		}
+		spin_unlock_irqrestore(&hist->wlock, flags);
+	}
+	mutex_unlock(&hist->lock);
+
+	return sysfs_emit(buf,
+		"budget_kb: %u\n"
+		"blocks: %u/%u\n"
+		"samples: %llu\n"
+		"bytes: %zu\n"
+		"span_ms: %llu\n",
+		READ_ONCE(hist->budget_kb), used, nblocks, samples, bytes,
+		div_u64(span_ns, NSEC_PER_MSEC));
+}
+
+/*
+ * Set up the (disabled) history of an instance
+ * devm-allocated, so a failing probe needs no cleanup.
+ */
+int simtemp_history_init(struct simtemp_device *dev)
+{
+	struct simtemp_history *hist;
+
+	hist = devm_kzalloc(&dev->pdev->dev, sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	hist->listener.deliver = simtemp_history_deliver;
+	mutex_init(&hist->lock);
+	spin_lock_init(&hist->wlock);
+
+	dev->history = hist;
+	return 0;
+}
+
+/*
+ * Free the blocks
+ * Called from remove after simtemp_listeners_release(), so the encoder
+ * no longer runs.
+ */
+void simtemp_history_exit(struct simtemp_device *dev)
+{
+	struct simtemp_history *hist = dev->history;
+
+	if (!hist)
+		return;
+
+	mutex_lock(&hist->lock);
+	simtemp_history_free(hist);
+	WRITE_ONCE(hist->budget_kb, 0);
+	mutex_unlock(&hist->lock);
+}
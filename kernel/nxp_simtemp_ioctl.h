@@ -12,6 +12,7 @@
 #define _UAPI_NXP_SIMTEMP_H
 
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /**
  * struct simtemp_sample - Binary sample structure returned by read()
@@ -33,11 +34,457 @@ struct simtemp_sample {
  */
 #define SIMTEMP_FLAG_NEW_SAMPLE		(1 << 0)  /* New sample available */
 #define SIMTEMP_FLAG_THRESHOLD_CROSSED	(1 << 1)  /* Temperature exceeded threshold */
+#define SIMTEMP_FLAG_INJECTED		(1 << 2)  /* Sample injected via write() */
+
+/**
+ * struct simtemp_ring_header - First page of the mmap'd sample ring
+ * @magic: SIMTEMP_RING_MAGIC
+ * @version: Layout version (SIMTEMP_RING_VERSION)
+ * @record_size: Size of one record: sizeof(struct simtemp_sample), or the
+ *	frame size (sample plus payload) when a payload is configured
+ * @data_offset: Byte offset of record 0 from the start of the mapping
+ * @size: Number of records in the ring (power of 2)
+ * @head: Sequence number of the next record to be written
+ *
+ * mmap() of /dev/simtemp (offset 0, read-only) maps this header followed
+ * by @size records. Record seq is stored at index (seq & (size - 1)).
+ * @head is free-running and written with release semantics after the
+ * record, so a reader loads it with acquire semantics, consumes records
+ * from its own cursor up to @head, and re-reads @head afterwards: records
+ * older than (new head - size) may have been overwritten meanwhile.
+ *
+ * The geometry (@record_size, @size) is fixed for the lifetime of the
+ * mapping: a mapping keeps the instance busy, so changing payload_bytes
+ * fails with EBUSY until every mapping and open file is gone, and a new
+ * mapping then sees the new header.
+ */
+struct simtemp_ring_header {
+	__u32 magic;
+	__u32 version;
+	__u32 record_size;
+	__u32 data_offset;
+	__u32 size;
+	__u32 head;
+};
+
+#define SIMTEMP_RING_MAGIC		0x53545252	/* "STRR" */
+#define SIMTEMP_RING_VERSION		1
+
+/*
+ * Frames: with a payload configured (sysfs payload_bytes), every record
+ * read(), spliced or mapped is a struct simtemp_sample followed by
+ * payload_bytes of generated data, and record_size in the ring header is
+ * sizeof(struct simtemp_sample) + payload_bytes. The payload is an array
+ * of __u64 words where word i holds the frame's timestamp_ns + i, so a
+ * consumer can check that a frame arrived whole.
+ */
+#define SIMTEMP_PAYLOAD_MIN		64
+#define SIMTEMP_PAYLOAD_MAX		65536
+#define SIMTEMP_PAYLOAD_ALIGN		16
+
+/**
+ * struct simtemp_control - Actuator page for closed-loop ("plant") mode
+ * @magic: SIMTEMP_CTRL_MAGIC
+ * @version: Layout version (SIMTEMP_CTRL_VERSION)
+ * @heat_mW: Heat load into the simulated plant in mW, written by user
+ *	space (negative values pump heat out, like a Peltier element)
+ * @cooling: Cooling command, 0 (off) to SIMTEMP_COOLING_MAX (full fan)
+ * @seq: Optional command sequence number, bumped by the writer after
+ *	updating @heat_mW / @cooling
+ * @applied_seq: @seq seen by the last tick that consumed the commands
+ * @applied_ns: Timestamp of that tick (same clock as sample timestamps)
+ *
+ * mmap() of /dev/simtemp at SIMTEMP_CTRL_MMAP_OFFSET (one page, shared,
+ * read-write) maps this page; SIMTEMP_IOC_SET_ACTUATOR and the thermal
+ * cooling device write the same fields. The next sampling tick consumes
+ * the commands, so a controller closes the loop with a store to memory.
+ */
+struct simtemp_control {
+	__u32 magic;
+	__u32 version;
+	__s32 heat_mW;
+	__u32 cooling;
+	__u32 seq;
+	__u32 applied_seq;
+	__u64 applied_ns;
+};
+
+#define SIMTEMP_CTRL_MAGIC		0x53544354	/* "STCT" */
+#define SIMTEMP_CTRL_VERSION		1
+#define SIMTEMP_CTRL_MMAP_OFFSET	0x40000000	/* mmap() offset of the page */
+#define SIMTEMP_COOLING_MAX		1000
+#define SIMTEMP_HEAT_MW_MAX		10000
+
+/**
+ * struct simtemp_actuator - Argument of SIMTEMP_IOC_SET_ACTUATOR
+ * @heat_mW: See struct simtemp_control
+ * @cooling: See struct simtemp_control
+ */
+struct simtemp_actuator {
+	__s32 heat_mW;
+	__u32 cooling;
+};
+
+/**
+ * struct simtemp_stats_record - Counters of one instance
+ * @instance: Instance number (0 is /dev/simtemp, N is /dev/simtempN)
+ * @flags: SIMTEMP_STATS_* flags
+ * @total_samples: Samples generated
+ * @threshold_alerts: Threshold crossings
+ * @read_count: read() calls
+ * @poll_count: poll() calls
+ * @reader_overruns: Records overwritten before a reader got them
+ * @injected_samples: Samples injected via write()
+ * @staging_drops: Samples dropped because a staging ring was full
+ * @jittered_ticks: Ticks whose period was shaped
+ * @bursts: Held bursts released at once
+ * @stalls: Delivery stalls started
+ * @held_samples: Samples delivered late by shaping
+ *
+ * Same counters as the 'stats' attribute, 96 bytes per instance. Version 1
+ * records (64 bytes) ended at @staging_drops.
+ */
+struct simtemp_stats_record {
+	__u32 instance;
+	__u32 flags;
+	__u64 total_samples;
+	__u64 threshold_alerts;
+	__u64 read_count;
+	__u64 poll_count;
+	__u64 reader_overruns;
+	__u64 injected_samples;
+	__u64 staging_drops;
+	__u64 jittered_ticks;
+	__u64 bursts;
+	__u64 stalls;
+	__u64 held_samples;
+};
+
+#define SIMTEMP_STATS_ACTIVE		(1 << 0)  /* Sample buffers allocated */
+
+/**
+ * struct simtemp_stats_header - Start of the debugfs 'stats' file
+ * @magic: SIMTEMP_STATS_MAGIC
+ * @version: SIMTEMP_STATS_VERSION
+ * @record_size: sizeof(struct simtemp_stats_record)
+ * @count: Number of records following the header
+ *
+ * /sys/kernel/debug/nxp_simtemp/stats holds this header followed by one
+ * record per instance, snapshotted at open(), so one read() of a large
+ * enough buffer returns all instances.
+ */
+struct simtemp_stats_header {
+	__u32 magic;
+	__u32 version;
+	__u32 record_size;
+	__u32 count;
+};
+
+#define SIMTEMP_STATS_MAGIC		0x53545354	/* "STST" */
+#define SIMTEMP_STATS_VERSION		2
+
+/**
+ * struct simtemp_relay_subbuf - Start of every relay sub-buffer
+ * @magic: SIMTEMP_RELAY_MAGIC
+ * @cpu: CPU whose channel buffer this is
+ * @sequence: Sub-buffers started on this CPU before this one
+ * @dropped: Samples lost on this CPU so far because every sub-buffer
+ *	     was full (not yet consumed)
+ * @padding: Unused bytes at the end of the sub-buffer, set when the
+ *	     sub-buffer is finished (0 while it is being filled)
+ * @record_size: sizeof(struct simtemp_sample)
+ *
+ * The per-CPU files of /sys/kernel/debug/nxp_simtemp/<instance>/ relay
+ * channel are sequences of sub-buffers, each this header followed by
+ * samples. A jump in @dropped between two sub-buffers tells a capture
+ * tool how many samples are missing in between.
+ */
+struct simtemp_relay_subbuf {
+	__u32 magic;
+	__u32 cpu;
+	__u64 sequence;
+	__u64 dropped;
+	__u32 padding;
+	__u32 record_size;
+};
+
+#define SIMTEMP_RELAY_MAGIC		0x5354524c	/* "STRL" */
+
+/**
+ * struct simtemp_stats_query - Argument of SIMTEMP_IOC_GET_STATS
+ * @records: User pointer to an array of struct simtemp_stats_record
+ * @capacity: Number of records the array holds
+ * @count: Out: records written
+ * @total: Out: instances in the system (may exceed @capacity)
+ */
+struct simtemp_stats_query {
+	__u64 records;
+	__u32 capacity;
+	__u32 count;
+	__u32 total;
+	__u32 reserved;
+};
+
+/**
+ * struct simtemp_tagged_sample - Record returned by read() on /dev/simtemp-all
+ * @instance: Instance the sample comes from (0 is /dev/simtemp)
+ * @reserved: Zero
+ * @sample: The sample, as read() on the instance would return it
+ *
+ * Size: 24 bytes. Records are in arrival order across instances and in
+ * timestamp order per instance.
+ */
+struct simtemp_tagged_sample {
+	__u32 instance;
+	__u32 reserved;
+	struct simtemp_sample sample;
+} __attribute__((packed));
+
+/**
+ * struct simtemp_mux_set - Argument of SIMTEMP_IOC_MUX_(UN)SUBSCRIBE
+ * @instances: User pointer to @count instance numbers (__u32)
+ * @count: Number of entries in @instances
+ * @flags: SIMTEMP_MUX_ALL to ignore @instances and use every instance
+ *         that currently exists
+ */
+struct simtemp_mux_set {
+	__u64 instances;
+	__u32 count;
+	__u32 flags;
+};
+
+#define SIMTEMP_MUX_ALL			(1 << 0)
+
+/**
+ * struct simtemp_view_req - Argument of SIMTEMP_IOC_OPEN_VIEW
+ * @type: SIMTEMP_VIEW_* (what the new fd delivers)
+ * @flags: SIMTEMP_VIEW_NONBLOCK, SIMTEMP_VIEW_CLOEXEC
+ * @depth: Records in the view's ring (power of 2, 0 = SIMTEMP_VIEW_DEPTH)
+ * @decimate: RAW, FILTERED: deliver every Nth sample (0 or 1 = all)
+ * @filter_shift: FILTERED: low-pass weight of a new sample, 1/2^shift
+ *	(1 to SIMTEMP_VIEW_FILTER_SHIFT_MAX)
+ * @threshold_mC: EVENTS: rising edge when a sample goes above this
+ * @hysteresis_mC: EVENTS: falling edge at threshold_mC - hysteresis_mC
+ * @jump_mC: EVENTS: step between two samples reported as an anomaly
+ *	(0 = off)
+ * @window: AGGREGATES: samples per record (1 to SIMTEMP_VIEW_WINDOW_MAX)
+ * @reserved: Must be 0
+ *
+ * Fields that do not apply to @type must be 0.
+ */
+struct simtemp_view_req {
+	__u32 type;
+	__u32 flags;
+	__u32 depth;
+	__u32 decimate;
+	__u32 filter_shift;
+	__s32 threshold_mC;
+	__u32 hysteresis_mC;
+	__u32 jump_mC;
+	__u32 window;
+	__u32 reserved;
+};
+
+#define SIMTEMP_VIEW_RAW		0	/* struct simtemp_sample */
+#define SIMTEMP_VIEW_FILTERED		1	/* struct simtemp_sample, temp low-pass filtered */
+#define SIMTEMP_VIEW_EVENTS		2	/* struct simtemp_event */
+#define SIMTEMP_VIEW_AGGREGATES		3	/* struct simtemp_aggregate */
+
+#define SIMTEMP_VIEW_NONBLOCK		(1 << 0)
+#define SIMTEMP_VIEW_CLOEXEC		(1 << 1)
+
+#define SIMTEMP_VIEW_DEPTH		1024
+#define SIMTEMP_VIEW_DEPTH_MAX		65536
+#define SIMTEMP_VIEW_FILTER_SHIFT_MAX	8
+#define SIMTEMP_VIEW_WINDOW_MAX		1000000
+
+/**
+ * struct simtemp_event - Record of a SIMTEMP_VIEW_EVENTS fd
+ * @timestamp_ns: Timestamp of the sample that caused the event
+ * @temp_mC: Its temperature
+ * @type: SIMTEMP_EVENT_*
+ */
+struct simtemp_event {
+	__u64 timestamp_ns;
+	__s32 temp_mC;
+	__u32 type;
+};
+
+#define SIMTEMP_EVENT_RISING		1	/* Went above threshold_mC */
+#define SIMTEMP_EVENT_FALLING		2	/* Went back below threshold - hysteresis */
+#define SIMTEMP_EVENT_JUMP		3	/* Changed by at least jump_mC */
+
+/**
+ * struct simtemp_aggregate - Record of a SIMTEMP_VIEW_AGGREGATES fd
+ * @first_ns: Timestamp of the first sample in the window
+ * @last_ns: Timestamp of the last sample in the window
+ * @count: Samples in the window
+ * @min_mC: Lowest temperature
+ * @max_mC: Highest temperature
+ * @mean_mC: Mean temperature
+ */
+struct simtemp_aggregate {
+	__u64 first_ns;
+	__u64 last_ns;
+	__u32 count;
+	__s32 min_mC;
+	__s32 max_mC;
+	__s32 mean_mC;
+};
+
+/**
+ * struct simtemp_segment - One phase of a scenario
+ * @duration_ms: Length of the phase (1 - SIMTEMP_SEGMENT_MS_MAX)
+ * @sampling_ms: Sampling period during the phase, 0 keeps sampling_ms
+ * @start_mC: Temperature at the start of the phase, unless
+ *	      SIMTEMP_SEGMENT_FROM_PREV is set
+ * @end_mC: Temperature at the end; the phase ramps linearly to it
+ * @noise_mC: Uniform noise of +- @noise_mC added to every sample
+ * @flags: SIMTEMP_SEGMENT_*
+ *
+ * "Ramp to 80 C over 30 s, hold 60 s with noise, drop to 40 C for 30 s"
+ * is { 30000, 0, 0, 80000, 0, FROM_PREV }, { 60000, 0, 80000, 80000,
+ * 1500, 0 }, { 30000, 0, 40000, 40000, 0, 0 }.
+ */
+struct simtemp_segment {
+	__u32 duration_ms;
+	__u32 sampling_ms;
+	__s32 start_mC;
+	__s32 end_mC;
+	__u32 noise_mC;
+	__u32 flags;
+};
+
+#define SIMTEMP_SEGMENT_FROM_PREV	(1 << 0)  /* Start where the previous phase ended */
+
+#define SIMTEMP_SEGMENT_MS_MAX		86400000	/* One day */
+#define SIMTEMP_SEGMENT_NOISE_MAX	50000
+#define SIMTEMP_SCENARIO_SEGMENTS_MAX	256
+
+/**
+ * struct simtemp_scenario_req - Argument of SIMTEMP_IOC_SET_SCENARIO
+ * @segments: User pointer to an array of struct simtemp_segment
+ * @count: Number of segments (1 - SIMTEMP_SCENARIO_SEGMENTS_MAX)
+ * @loops: Passes through the segments, 0 = repeat forever
+ * @flags: Zero
+ * @reserved: Zero
+ */
+struct simtemp_scenario_req {
+	__u64 segments;
+	__u32 count;
+	__u32 loops;
+	__u32 flags;
+	__u32 reserved;
+};
+
+/**
+ * struct simtemp_history_req - Argument of SIMTEMP_IOC_READ_HISTORY
+ * @records: User pointer to an array of @capacity records of @type
+ * @cursor: In: history sequence number of the first sample wanted (0 =
+ *	    the oldest retained). Out: where the next call continues
+ * @oldest: Out: sequence number of the oldest retained sample
+ * @next: Out: sequence number the next stored sample will get
+ * @type: SIMTEMP_VIEW_RAW (struct simtemp_sample) or
+ *	  SIMTEMP_VIEW_AGGREGATES (struct simtemp_aggregate)
+ * @capacity: Records @records holds
+ * @window: AGGREGATES: samples per record (1 - SIMTEMP_VIEW_WINDOW_MAX),
+ *	    otherwise 0
+ * @count: Out: records written
+ *
+ * Samples are numbered from 0 when the history is enabled or resized. A
+ * @cursor below @oldest skips the samples that were evicted in between
+ * (@oldest - @cursor of them).
+ */
+struct simtemp_history_req {
+	__u64 records;
+	__u64 cursor;
+	__u64 oldest;
+	__u64 next;
+	__u32 type;
+	__u32 capacity;
+	__u32 window;
+	__u32 count;
+};
+
+/**
+ * ioctl commands for /dev/simtemp
+ *
+ * SIMTEMP_IOC_SET_CURSOR: Set this file's read cursor (ring sequence
+ * number). mmap consumers use it to tell the driver what they consumed,
+ * so poll() only reports EPOLLIN for records they have not seen.
+ *
+ * SIMTEMP_IOC_SET_WATERMARK: Number of unread records (1 to ring size)
+ * this file needs before poll() reports EPOLLIN and a blocking read()
+ * wakes up. Default 1. Lets batch consumers sleep through single samples.
+ *
+ * SIMTEMP_IOC_GET_STATS: Counters of every instance in one call, issued
+ * on any instance. Same data as the debugfs 'stats' file, without
+ * needing debugfs.
+ *
+ * SIMTEMP_IOC_MUX_SUBSCRIBE / SIMTEMP_IOC_MUX_UNSUBSCRIBE: /dev/simtemp-all
+ * only. Add or remove instances from this file's subscription set.
+ * Returns the number of instances added/removed; instances that do not
+ * exist (or are already in the set) are skipped. A subscription whose
+ * instance was removed stays in the set, detached, until it is removed or
+ * subscribed again. Once every subscription is detached, read() returns 0
+ * after the queued records and poll() reports EPOLLHUP.
+ * SIMTEMP_IOC_SET_WATERMARK also applies to /dev/simtemp-all, in records.
+ *
+ * SIMTEMP_IOC_SET_BUSY_POLL: Busy-poll budget of this file in microseconds
+ * (0 disables, the default; at most SIMTEMP_BUSY_POLL_MAX_US). A blocking
+ * read() that finds no data spins on the ring head for up to this long
+ * before sleeping, like SO_BUSY_POLL. The driver only spins when the next
+ * sample is due within the budget (from the observed sample interval) and
+ * never for more than half that interval; otherwise it sleeps at once.
+ *
+ * SIMTEMP_IOC_SET_ACTUATOR: Set the plant's heat load and cooling command
+ * (struct simtemp_control) without mapping the control page. Like the
+ * shared writable mapping of that page, needs a file opened for writing
+ * (EBADF otherwise).
+ *
+ * SIMTEMP_IOC_OPEN_VIEW: Returns a new fd streaming one view of this
+ * instance (struct simtemp_view_req): raw or filtered samples, threshold
+ * and anomaly events, or periodic aggregates. Each view fd has its own
+ * ring (the oldest record is overwritten when it is full), read cursor,
+ * SIMTEMP_IOC_SET_WATERMARK and poll(); it only wakes up when its view
+ * produces a record. The view keeps sampling alive like an open file.
+ * Once the instance is removed, read() returns 0 after the queued records
+ * and poll() reports EPOLLHUP.
+ *
+ * SIMTEMP_IOC_SET_SCENARIO: Load a scenario (struct simtemp_scenario_req)
+ * and switch the instance to "scenario" mode. The sampling timer walks
+ * the segments on its own timeline, starting at its next tick: every
+ * segment boundary gets a tick of its own at the exact boundary time, and
+ * per-segment sampling periods take effect without restarting the timer.
+ * After the last pass the last segment's end temperature is held.
+ * Writing "scenario" to the mode attribute restarts the loaded scenario.
+ * Needs a file opened for writing (EBADF otherwise).
+ *
+ * SIMTEMP_IOC_READ_HISTORY: Read back the instance's compact sample
+ * history (sysfs history_kb), decoded into the requested record type
+ * (struct simtemp_history_req). Aggregates only cover whole windows; the
+ * returned cursor points at the first sample of the unfinished one.
+ * Fails with ENODATA while the history is disabled.
+ */
+#define SIMTEMP_IOC_MAGIC		'S'
+#define SIMTEMP_IOC_SET_CURSOR		_IOW(SIMTEMP_IOC_MAGIC, 1, __u32)
+#define SIMTEMP_IOC_SET_WATERMARK	_IOW(SIMTEMP_IOC_MAGIC, 2, __u32)
+#define SIMTEMP_IOC_GET_STATS		_IOWR(SIMTEMP_IOC_MAGIC, 3, struct simtemp_stats_query)
+#define SIMTEMP_IOC_MUX_SUBSCRIBE	_IOW(SIMTEMP_IOC_MAGIC, 4, struct simtemp_mux_set)
+#define SIMTEMP_IOC_MUX_UNSUBSCRIBE	_IOW(SIMTEMP_IOC_MAGIC, 5, struct simtemp_mux_set)
+#define SIMTEMP_IOC_SET_BUSY_POLL	_IOW(SIMTEMP_IOC_MAGIC, 6, __u32)
+#define SIMTEMP_IOC_SET_ACTUATOR	_IOW(SIMTEMP_IOC_MAGIC, 7, struct simtemp_actuator)
+#define SIMTEMP_IOC_OPEN_VIEW		_IOW(SIMTEMP_IOC_MAGIC, 8, struct simtemp_view_req)
+#define SIMTEMP_IOC_SET_SCENARIO	_IOW(SIMTEMP_IOC_MAGIC, 9, struct simtemp_scenario_req)
+#define SIMTEMP_IOC_READ_HISTORY	_IOWR(SIMTEMP_IOC_MAGIC, 10, struct simtemp_history_req)
+
+#define SIMTEMP_BUSY_POLL_MAX_US	10000
 
 /**
  * Device path
  */
 #define SIMTEMP_DEVICE_PATH	"/dev/simtemp"
+#define SIMTEMP_MUX_PATH	"/dev/simtemp-all"
 
 /**
  * Sysfs attributes paths (relative to /sys/class/misc/simtemp/)
@@ -53,6 +500,9 @@ struct simtemp_sample {
 #define SIMTEMP_MODE_STR_NORMAL		"normal"
 #define SIMTEMP_MODE_STR_NOISY		"noisy"
 #define SIMTEMP_MODE_STR_RAMP		"ramp"
+#define SIMTEMP_MODE_STR_PLANT		"plant"
+#define SIMTEMP_MODE_STR_REPLAY		"replay"
+#define SIMTEMP_MODE_STR_SCENARIO	"scenario"
 
 /**
  * Configuration limits
@@ -0,0 +1,2307 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Main implementation file
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ * Author: NXP Candidate
+ *
+ * This driver simulates a hardware temperature sensor for demonstration
+ * and testing purposes. It generates periodic temperature samples and
+ * exposes them to user space via character device and sysfs interfaces.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/of.h>
+#include <linux/of_device.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/poll.h>
+#include <linux/fs.h>
+#include <linux/random.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/xarray.h>
+#include <linux/sched/signal.h>
+#include <linux/timekeeping.h>
+#include <linux/uio.h>
+#include <linux/splice.h>
+#include <linux/srcu.h>
+
+#include "nxp_simtemp.h"
+
+/* Module metadata */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ulises Mauricio Gomez Villa");
+MODULE_DESCRIPTION(DRIVER_DESC);
+MODULE_VERSION(DRIVER_VERSION);
+
+/* Probed instances, indexed by instance number */
+DEFINE_XARRAY_ALLOC(simtemp_instances);
+
+/* Platform devices for testing (when no Device Tree) */
+static struct platform_device **g_pdevs;
+static unsigned int g_nr_pdevs;
+
+/* Number of platform devices created at module load */
+static unsigned int nr_instances = DEFAULT_NR_INSTANCES;
+module_param(nr_instances, uint, 0444);
+MODULE_PARM_DESC(nr_instances, "Instances to create without Device Tree (1-4096)");
+
+/* Ring buffer size in records (rounded up to a power of 2) */
+static unsigned int ring_size = DEFAULT_RING_SIZE;
+module_param(ring_size, uint, 0444);
+MODULE_PARM_DESC(ring_size, "Ring buffer size in samples (64-65536, power of 2)");
+
+/* Idle time before an instance's sample buffers are freed */
+static unsigned int idle_timeout_ms = DEFAULT_IDLE_TIMEOUT_MS;
+module_param(idle_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(idle_timeout_ms, "Free sample buffers after this many ms without users");
+
+/* Register every instance as a thermal cooling device */
+static bool cooling_device;
+module_param(cooling_device, bool, 0444);
+MODULE_PARM_DESC(cooling_device, "Register instances as thermal cooling devices (plant mode)");
+
+/* Relay channel geometry of every instance (0 sub-buffers: no channel) */
+static unsigned int relay_subbufs = DEFAULT_RELAY_SUBBUFS;
+module_param(relay_subbufs, uint, 0444);
+MODULE_PARM_DESC(relay_subbufs, "Relay sub-buffers per CPU in debugfs (0 = no relay channel)");
+
+static unsigned int relay_subbuf_size = DEFAULT_RELAY_SUBBUF_SIZE;
+module_param(relay_subbuf_size, uint, 0444);
+MODULE_PARM_DESC(relay_subbuf_size, "Relay sub-buffer size in bytes");
+
+/* Compact sample history of every instance (0: disabled until set in sysfs) */
+static unsigned int history_kb;
+module_param(history_kb, uint, 0444);
+MODULE_PARM_DESC(history_kb, "Compact sample history per instance in KiB (0 = disabled)");
+
+/* Forward declarations */
+static int simtemp_probe(struct platform_device *pdev);
+static void simtemp_remove(struct platform_device *pdev);
+static enum hrtimer_restart simtemp_timer_callback(struct hrtimer *timer);
+static void simtemp_select_producer(struct simtemp_device *dev);
+static void simtemp_shape_reset(struct simtemp_device *dev);
+
+/*
+ * Protects simtemp_buffers.dev: remove clears it, and files and mappings
+ * that outlive the instance look it up before touching the instance.
+ * Taken before bufs_lock.
+ */
+static DEFINE_MUTEX(simtemp_bufs_owner_lock);
+
+/*
+ * File operations that use the instance run inside this SRCU read section
+ * (they may sleep); remove clears bufs->dev and waits for them before the
+ * instance is freed
+ */
+DEFINE_STATIC_SRCU(simtemp_files_srcu);
+
+/*
+ * Become a user of the sample buffers, allocating them on first use
+ *
+ * Every open file, mapping and listener is a user. The buffers are
+ * unpublished by simtemp_idle_work() once there were no users for
+ * idle_timeout_ms. Callers that keep the pointer (files, mappings) also
+ * take a reference on it.
+ *
+ * Returns the buffers or an ERR_PTR()
+ */
+static struct simtemp_buffers *simtemp_buffers_get(struct simtemp_device *dev)
+{
+	struct simtemp_buffers *bufs;
+
+	mutex_lock(&dev->bufs_lock);
+
+	bufs = rcu_dereference_protected(dev->bufs, lockdep_is_held(&dev->bufs_lock));
+	if (!bufs) {
+		bufs = simtemp_buffers_alloc(roundup_pow_of_two(clamp_t(unsigned int, ring_size,
+									RING_SIZE_MIN,
+									RING_SIZE_MAX)),
+					     dev->payload_bytes);
+		if (IS_ERR(bufs)) {
+			pr_err("%s: Failed to allocate sample buffers: %ld\n",
+			       DRIVER_NAME, PTR_ERR(bufs));
+			goto out;
+		}
+
+		/* Timer starts staging samples on its next tick */
+		bufs->dev = dev;
+		rcu_assign_pointer(dev->bufs, bufs);
+	}
+
+	/* A pending idle free re-checks users under bufs_lock */
+	dev->users++;
+	cancel_delayed_work(&dev->idle_work);
+out:
+	mutex_unlock(&dev->bufs_lock);
+	return bufs;
+}
+
+/*
+ * Stop being a user of the sample buffers
+ * The last user arms the idle timeout instead of freeing right away, so
+ * short-lived opens (CLI invocations) do not churn allocations.
+ */
+static void simtemp_buffers_put(struct simtemp_device *dev)
+{
+	mutex_lock(&dev->bufs_lock);
+	if (!--dev->users)
+		mod_delayed_work(system_wq, &dev->idle_work,
+				 msecs_to_jiffies(READ_ONCE(idle_timeout_ms)));
+	mutex_unlock(&dev->bufs_lock);
+}
+
+/*
+ * Unpublish the sample buffers and drop the device's reference
+ * Called with bufs_lock held and no users left, or from remove. Counters
+ * live in dev->stats, not in the buffers, so none are lost here.
+ */
+static void simtemp_buffers_release(struct simtemp_device *dev)
+{
+	struct simtemp_buffers *bufs;
+
+	bufs = rcu_dereference_protected(dev->bufs, lockdep_is_held(&dev->bufs_lock));
+	if (!bufs)
+		return;
+
+	RCU_INIT_POINTER(dev->bufs, NULL);
+
+	/* Wait for a timer tick that may still be staging into them */
+	synchronize_rcu();
+
+	simtemp_buffers_unref(bufs);
+	pr_debug("%s: %s idle, sample buffers released\n", DRIVER_NAME, dev->name);
+}
+
+/*
+ * Idle timeout: free the sample buffers unless a user came back
+ */
+static void simtemp_idle_work(struct work_struct *work)
+{
+	struct simtemp_device *dev = container_of(to_delayed_work(work),
+						  struct simtemp_device, idle_work);
+
+	mutex_lock(&dev->bufs_lock);
+	if (!dev->users)
+		simtemp_buffers_release(dev);
+	mutex_unlock(&dev->bufs_lock);
+}
+
+/*
+ * A file or mapping holding @bufs comes or goes
+ * Counts it as a user of the owning instance while there is one; after
+ * remove only the reference on the buffers themselves is left.
+ */
+static void simtemp_buffers_hold(struct simtemp_buffers *bufs)
+{
+	struct simtemp_device *dev;
+
+	mutex_lock(&simtemp_bufs_owner_lock);
+	dev = bufs->dev;
+	if (dev) {
+		mutex_lock(&dev->bufs_lock);
+		dev->users++;
+		mutex_unlock(&dev->bufs_lock);
+	}
+	mutex_unlock(&simtemp_bufs_owner_lock);
+
+	kref_get(&bufs->ref);
+}
+
+static void simtemp_buffers_drop(struct simtemp_buffers *bufs)
+{
+	mutex_lock(&simtemp_bufs_owner_lock);
+	if (bufs->dev)
+		simtemp_buffers_put(bufs->dev);
+	mutex_unlock(&simtemp_bufs_owner_lock);
+
+	simtemp_buffers_unref(bufs);
+}
+
+/*
+ * Instance behind an open file, NULL once it was removed
+ * Valid until the matching simtemp_file_leave().
+ */
+static struct simtemp_device *simtemp_file_enter(struct simtemp_reader *reader, int *idx)
+{
+	*idx = srcu_read_lock(&simtemp_files_srcu);
+	return READ_ONCE(reader->bufs->dev);
+}
+
+static void simtemp_file_leave(int idx)
+{
+	srcu_read_unlock(&simtemp_files_srcu, idx);
+}
+
+/* Serializes listener attach/detach across all instances */
+static DEFINE_MUTEX(simtemp_listener_lock);
+
+/*
+ * Attach @listener to instance @instance
+ * The listener is a user of the instance's sample buffers, so samples
+ * flow while it is attached even if nobody has the device open.
+ * Returns 0, -ENODEV if there is no such instance, or -ENOMEM.
+ */
+int simtemp_listener_attach(u32 instance, struct simtemp_listener *listener)
+{
+	struct simtemp_device *dev;
+	struct simtemp_buffers *bufs;
+	int ret = 0;
+
+	mutex_lock(&simtemp_listener_lock);
+
+	dev = xa_load(&simtemp_instances, instance);
+	if (!dev || dev->removing) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	bufs = simtemp_buffers_get(dev);
+	if (IS_ERR(bufs)) {
+		ret = PTR_ERR(bufs);
+		goto out;
+	}
+
+	listener->dev = dev;
+	list_add_tail_rcu(&listener->node, &dev->listeners);
+out:
+	mutex_unlock(&simtemp_listener_lock);
+	return ret;
+}
+
+/*
+ * Detach @listener from its instance (no-op if the instance is gone)
+ * The listener may still be called until an RCU grace period has
+ * passed; callers free it after synchronize_rcu().
+ * Returns true if this detached it, false if the instance already had.
+ */
+bool simtemp_listener_detach(struct simtemp_listener *listener)
+{
+	struct simtemp_device *dev;
+
+	mutex_lock(&simtemp_listener_lock);
+
+	dev = listener->dev;
+	if (dev) {
+		list_del_rcu(&listener->node);
+		listener->dev = NULL;
+		simtemp_buffers_put(dev);
+	}
+
+	mutex_unlock(&simtemp_listener_lock);
+
+	return dev;
+}
+
+/*
+ * Detach every listener of an instance that is going away
+ * Called from remove after the timer is stopped. Listener owners find
+ * listener->dev NULL and no longer touch the instance; their removed
+ * callback lets them wake their waiters.
+ */
+static void simtemp_listeners_release(struct simtemp_device *dev)
+{
+	struct simtemp_listener *listener, *tmp;
+
+	mutex_lock(&simtemp_listener_lock);
+
+	dev->removing = true;
+	list_for_each_entry_safe(listener, tmp, &dev->listeners, node) {
+		list_del_rcu(&listener->node);
+		WRITE_ONCE(listener->dev, NULL);
+		if (listener->removed)
+			listener->removed(listener);
+	}
+
+	mutex_unlock(&simtemp_listener_lock);
+
+	/* A flush that started before may still be delivering to them */
+	synchronize_rcu();
+}
+
+/*
+ * File operations: open()
+ * Each open file gets its own reader cursor, starting at the newest record
+ */
+static int simtemp_open(struct inode *inode, struct file *filp)
+{
+	struct simtemp_device *dev;
+	struct simtemp_reader *reader;
+	struct simtemp_buffers *bufs;
+
+	/* Get device from miscdevice */
+	dev = container_of(filp->private_data, struct simtemp_device, miscdev);
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+
+	bufs = simtemp_buffers_get(dev);
+	if (IS_ERR(bufs)) {
+		kfree(reader);
+		return PTR_ERR(bufs);
+	}
+
+	/* simtemp_buffers_get() made the file a user, this keeps the pointer */
+	kref_get(&bufs->ref);
+
+	reader->bufs = bufs;
+	reader->cursor = smp_load_acquire(&bufs->ringbuf.hdr->head);
+	reader->watermark = 1;
+	mutex_init(&reader->read_lock);
+	filp->private_data = reader;
+
+	pr_debug("%s: Device opened\n", DRIVER_NAME);
+	return 0;
+}
+
+/*
+ * File operations: release()
+ */
+static int simtemp_release(struct inode *inode, struct file *filp)
+{
+	struct simtemp_reader *reader = filp->private_data;
+	struct simtemp_buffers *bufs = reader->bufs;
+
+	kfree(reader);
+	simtemp_buffers_drop(bufs);
+
+	pr_debug("%s: Device closed\n", DRIVER_NAME);
+	return 0;
+}
+
+/*
+ * Move up to @max samples from this reader's cursor into @batch
+ * Returns the number of samples copied out
+ */
+static unsigned int simtemp_take(struct simtemp_device *dev, struct simtemp_reader *reader,
+				 struct simtemp_sample *batch, unsigned int max)
+{
+	unsigned long flags;
+	unsigned int n;
+	u64 dropped = 0;
+
+	spin_lock_irqsave(&reader->bufs->ringbuf.lock, flags);
+	n = simtemp_ringbuf_read(&reader->bufs->ringbuf, &reader->cursor, batch, max, &dropped);
+	reader->dropped += dropped;
+	this_cpu_add(dev->stats->reader_overruns, dropped);
+	spin_unlock_irqrestore(&reader->bufs->ringbuf.lock, flags);
+
+	return n;
+}
+
+/*
+ * Check whether this reader has at least watermark unread records (lockless)
+ */
+static bool simtemp_reader_pending(struct simtemp_reader *reader)
+{
+	return simtemp_ringbuf_pending(&reader->bufs->ringbuf, READ_ONCE(reader->cursor)) >=
+	       READ_ONCE(reader->watermark);
+}
+
+/*
+ * Track the inter-sample interval seen by this reader
+ * @ts_ns is the timestamp of the newest record of a read() that returned
+ * @n records. Samples are produced at a fixed period, so the EWMA (1/8
+ * weight) converges on sampling_ms plus injection bursts.
+ */
+static void simtemp_note_interval(struct simtemp_reader *reader, u64 ts_ns, size_t n)
+{
+	u64 delta;
+
+	if (reader->last_ts_ns && ts_ns > reader->last_ts_ns) {
+		delta = div_u64(ts_ns - reader->last_ts_ns, n);
+		if (reader->interval_ns)
+			reader->interval_ns = reader->interval_ns - (reader->interval_ns >> 3) +
+					      (delta >> 3);
+		else
+			reader->interval_ns = delta;
+	}
+
+	reader->last_ts_ns = ts_ns;
+}
+
+/*
+ * Spin on the ring head before a blocking read() sleeps
+ *
+ * The effective budget is the per-file busy_poll_us capped at half the
+ * observed sample interval. Spinning only starts when the next sample is
+ * due within that budget, so slow instances and idle periods go straight
+ * to sleep instead of burning CPU.
+ *
+ * Returns true if data arrived while spinning.
+ */
+static bool simtemp_busy_poll(struct simtemp_reader *reader)
+{
+	u64 budget = (u64)READ_ONCE(reader->busy_poll_us) * NSEC_PER_USEC;
+	u64 now, deadline;
+
+	if (!budget || !reader->interval_ns)
+		return false;
+
+	budget = min(budget, reader->interval_ns >> 1);
+	now = ktime_get_ns();
+
+	/* Next sample not due within the budget: sleeping is cheaper */
+	if (reader->last_ts_ns + reader->interval_ns > now + budget) {
+		reader->busy_skips++;
+		return false;
+	}
+
+	deadline = now + budget;
+	do {
+		if (simtemp_reader_pending(reader)) {
+			reader->busy_hits++;
+			return true;
+		}
+
+		if (signal_pending(current) || need_resched())
+			break;
+
+		cpu_relax();
+	} while (ktime_get_ns() < deadline);
+
+	reader->busy_misses++;
+	return false;
+}
+
+/*
+ * Wait until this reader has data, before retrying a take
+ * Returns 0 or a negative error code (-EAGAIN for non-blocking files,
+ * -ENODEV once the instance was removed)
+ */
+static int simtemp_wait_data(struct simtemp_reader *reader, bool nonblock)
+{
+	int ret;
+
+	/* Non-blocking mode: return immediately if no data */
+	if (nonblock) {
+		pr_debug("%s: Non-blocking read, no data available\n", DRIVER_NAME);
+		return -EAGAIN;
+	}
+
+	/* Latency-critical consumers spin briefly before sleeping */
+	if (simtemp_busy_poll(reader))
+		return 0;
+
+	/*
+	 * Blocking mode: wait for data to become available
+	 * Another thread on the same file may still win the race,
+	 * so the caller retries the take
+	 */
+	ret = wait_event_interruptible(reader->bufs->wait,
+				       simtemp_reader_pending(reader) ||
+				       !READ_ONCE(reader->bufs->dev));
+	if (ret) {
+		/* Interrupted by signal */
+		pr_debug("%s: Read interrupted by signal\n", DRIVER_NAME);
+		return -ERESTARTSYS;
+	}
+	reader->wakeups++;
+
+	if (!READ_ONCE(reader->bufs->dev))
+		return -ENODEV;
+
+	return 0;
+}
+
+/*
+ * read() in frame mode (payload_bytes set)
+ * Returns as many whole frames as fit, copied straight from the ring; see
+ * simtemp_ringbuf_read_frames()
+ */
+static ssize_t simtemp_read_frames(struct simtemp_device *dev, struct simtemp_reader *reader,
+				   struct iov_iter *to, bool nonblock)
+{
+	struct simtemp_ringbuf *rb = &reader->bufs->ringbuf;
+	unsigned int max = min_t(size_t, iov_iter_count(to) / rb->record_size, UINT_MAX);
+	u64 dropped = 0, newest_ns = 0;
+	u32 cursor;
+	int n, ret;
+
+	if (!max) {
+		pr_debug("%s: read() called with less than one frame\n", DRIVER_NAME);
+		return -EINVAL;
+	}
+
+	if (mutex_lock_interruptible(&reader->read_lock))
+		return -ERESTARTSYS;
+
+	for (;;) {
+		cursor = READ_ONCE(reader->cursor);
+		n = simtemp_ringbuf_read_frames(rb, &cursor, to, max, &dropped, &newest_ns);
+		WRITE_ONCE(reader->cursor, cursor);
+		if (n)
+			break;
+
+		ret = simtemp_wait_data(reader, nonblock);
+		if (ret) {
+			n = ret;
+			break;
+		}
+	}
+
+	mutex_unlock(&reader->read_lock);
+
+	reader->dropped += dropped;
+	this_cpu_add(dev->stats->reader_overruns, dropped);
+	if (n < 0)
+		return n;
+
+	simtemp_note_interval(reader, newest_ns, n);
+
+	/* Update statistics */
+	this_cpu_inc(dev->stats->read_count);
+	reader->read_count++;
+	reader->samples_read += n;
+	reader->bytes_read += (u64)n * rb->record_size;
+
+	return (ssize_t)n * rb->record_size;
+}
+
+/*
+ * read() of plain samples
+ * Blocks (unless @nonblock) until at least one sample is available, then
+ * drains the ring buffer in READ_BATCH chunks without sleeping again.
+ */
+static ssize_t simtemp_read_samples(struct simtemp_device *dev, struct simtemp_reader *reader,
+				    struct iov_iter *to, bool nonblock)
+{
+	struct simtemp_sample batch[READ_BATCH];
+	size_t max = iov_iter_count(to) / sizeof(struct simtemp_sample);
+	size_t done = 0;
+	unsigned int want, n;
+	u64 newest_ns;
+	int ret;
+
+	/* Validate buffer size */
+	if (!max) {
+		pr_debug("%s: read() called with insufficient buffer size\n", DRIVER_NAME);
+		return -EINVAL;
+	}
+
+	for (;;) {
+		want = min_t(size_t, max, READ_BATCH);
+		n = simtemp_take(dev, reader, batch, want);
+		if (n)
+			break;
+
+		ret = simtemp_wait_data(reader, nonblock);
+		if (ret)
+			return ret;
+	}
+
+	for (;;) {
+		/* Copy samples to userspace */
+		if (copy_to_iter(batch, n * sizeof(batch[0]), to) != n * sizeof(batch[0])) {
+			pr_err("%s: copy_to_iter failed\n", DRIVER_NAME);
+			return -EFAULT;
+		}
+		done += n;
+		newest_ns = batch[n - 1].timestamp_ns;
+
+		/* Stop on a short chunk (ring drained) or a full user buffer */
+		if (n < want || done == max)
+			break;
+
+		want = min_t(size_t, max - done, READ_BATCH);
+		n = simtemp_take(dev, reader, batch, want);
+		if (!n)
+			break;
+	}
+
+	simtemp_note_interval(reader, newest_ns, done);
+
+	/* Update statistics */
+	this_cpu_inc(dev->stats->read_count);
+	reader->read_count++;
+	reader->samples_read += done;
+	reader->bytes_read += done * sizeof(struct simtemp_sample);
+
+	pr_debug("%s: Returned %zu samples\n", DRIVER_NAME, done);
+
+	return done * sizeof(struct simtemp_sample);
+}
+
+/*
+ * File operations: read_iter()
+ * Returns as many whole binary sample structures (or frames, see
+ * simtemp_read_frames()) as fit in the buffer, or -ENODEV once the
+ * instance was removed. Also backs splice() through copy_splice_read().
+ */
+static ssize_t simtemp_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct file *filp = iocb->ki_filp;
+	struct simtemp_reader *reader = filp->private_data;
+	bool nonblock = (filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
+	struct simtemp_device *dev;
+	ssize_t ret;
+	int idx;
+
+	dev = simtemp_file_enter(reader, &idx);
+	if (!dev)
+		ret = -ENODEV;
+	else if (reader->bufs->ringbuf.payload_bytes)
+		ret = simtemp_read_frames(dev, reader, to, nonblock);
+	else
+		ret = simtemp_read_samples(dev, reader, to, nonblock);
+	simtemp_file_leave(idx);
+
+	return ret;
+}
+
+/*
+ * File operations: write()
+ * Injects whole binary samples into the local CPU's staging ring
+ *
+ * A zero timestamp_ns is replaced with the injection time. Only the
+ * threshold flag is taken from user space; NEW_SAMPLE and INJECTED are
+ * always set. Samples that do not fit in the staging ring are dropped
+ * and counted, like a lossy sensor.
+ *
+ * On an O_DSYNC (or O_SYNC) file every write() is published before it
+ * returns, so a paced writer controls exactly when readers see each
+ * sample; otherwise small writes wait for a batch or the next tick.
+ * A burst or stall of delivery shaping holds injected samples as well.
+ *
+ * Injected samples reach every consumer of the instance, so this needs a
+ * file opened for writing (the node is only writable by root). Once the
+ * instance was removed this fails with -ENODEV.
+ */
+static ssize_t simtemp_write(struct file *filp, const char __user *buf,
+			      size_t count, loff_t *f_pos)
+{
+	struct simtemp_reader *reader = filp->private_data;
+	struct simtemp_sample batch[INJECT_BATCH];
+	size_t total = count / sizeof(struct simtemp_sample);
+	unsigned int flush_at = (filp->f_flags & O_DSYNC) ? 1 : STAGING_FLUSH_BATCH;
+	struct simtemp_device *dev;
+	size_t done = 0;
+	unsigned int n, i, pending, dropped;
+	ssize_t ret = 0;
+	u64 now;
+	int idx;
+
+	if (!(filp->f_mode & FMODE_WRITE))
+		return -EBADF;
+
+	/* Validate buffer size */
+	if (!total) {
+		pr_debug("%s: write() called with less than one sample\n", DRIVER_NAME);
+		return -EINVAL;
+	}
+
+	dev = simtemp_file_enter(reader, &idx);
+	if (!dev) {
+		simtemp_file_leave(idx);
+		return -ENODEV;
+	}
+
+	while (done < total) {
+		n = min_t(size_t, total - done, INJECT_BATCH);
+
+		if (copy_from_user(batch, buf + done * sizeof(batch[0]),
+				   n * sizeof(batch[0]))) {
+			if (!done) {
+				pr_err("%s: copy_from_user failed\n", DRIVER_NAME);
+				ret = -EFAULT;
+			}
+			break;
+		}
+
+		now = ktime_get_ns();
+		for (i = 0; i < n; i++) {
+			if (!batch[i].timestamp_ns)
+				batch[i].timestamp_ns = now;
+			batch[i].flags = (batch[i].flags & SIMTEMP_FLAG_THRESHOLD_CROSSED) |
+					 SIMTEMP_FLAG_NEW_SAMPLE | SIMTEMP_FLAG_INJECTED;
+		}
+
+		pending = simtemp_stage(reader->bufs, batch, n, &dropped);
+		this_cpu_add(dev->stats->injected_samples, n);
+		this_cpu_add(dev->stats->staging_drops, dropped);
+		done += n;
+
+		/*
+		 * Only touch the shared ring once a batch has built up on this
+		 * CPU (or on every write for O_DSYNC); smaller amounts are
+		 * merged by the next timer tick. While delivery shaping holds
+		 * a burst or stall, injected samples wait for its release too.
+		 */
+		if (pending >= flush_at && !READ_ONCE(dev->shaping.holding) &&
+		    simtemp_flush_all(dev, reader->bufs))
+			wake_up_interruptible(&reader->bufs->wait);
+	}
+
+	simtemp_file_leave(idx);
+
+	if (ret)
+		return ret;
+
+	pr_debug("%s: Injected %zu samples\n", DRIVER_NAME, done);
+
+	return done * sizeof(struct simtemp_sample);
+}
+
+/*
+ * File operations: poll() - Wait for readable data or threshold events
+ *
+ * Returns event mask indicating:
+ * - EPOLLIN | EPOLLRDNORM: New data available for reading
+ * - EPOLLPRI: Threshold crossed (urgent notification)
+ * - EPOLLHUP | EPOLLERR: The instance was removed
+ */
+static __poll_t simtemp_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct simtemp_reader *reader = filp->private_data;
+	struct simtemp_device *dev;
+	__poll_t mask = 0;
+	int idx;
+
+	/*
+	 * Add file to wait queue - kernel will wake us when data arrives.
+	 * The queue belongs to the buffers, which the file keeps.
+	 */
+	poll_wait(filp, &reader->bufs->wait, wait);
+
+	dev = simtemp_file_enter(reader, &idx);
+	if (!dev) {
+		simtemp_file_leave(idx);
+		return EPOLLHUP | EPOLLERR;
+	}
+
+	/* Update statistics */
+	this_cpu_inc(dev->stats->poll_count);
+	reader->poll_count++;
+
+	/* Check if data is available for this reader */
+	if (simtemp_reader_pending(reader)) {
+		mask |= EPOLLIN | EPOLLRDNORM;
+		pr_debug("%s: poll() - data available\n", DRIVER_NAME);
+	}
+
+	/* Check for threshold crossing event (urgent notification) */
+	if (dev->threshold_crossed) {
+		mask |= EPOLLPRI;
+		pr_debug("%s: poll() - threshold crossed\n", DRIVER_NAME);
+	}
+
+	simtemp_file_leave(idx);
+
+	/*
+	 * If no events, the process will sleep on the wait queue
+	 * and be woken by the timer when new data arrives
+	 */
+	if (!mask)
+		pr_debug("%s: poll() - no events, will sleep\n", DRIVER_NAME);
+
+	return mask;
+}
+
+/*
+ * ioctl() commands, with the file's instance
+ */
+static long simtemp_file_ioctl(struct simtemp_device *dev, struct file *filp,
+			       unsigned int cmd, unsigned long arg)
+{
+	struct simtemp_reader *reader = filp->private_data;
+	struct simtemp_scenario *sc;
+	void __user *uarg = (void __user *)arg;
+	unsigned long flags;
+	long ret;
+	u32 val;
+
+	switch (cmd) {
+	case SIMTEMP_IOC_SET_CURSOR:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+
+		spin_lock_irqsave(&reader->bufs->ringbuf.lock, flags);
+		reader->cursor = val;
+		spin_unlock_irqrestore(&reader->bufs->ringbuf.lock, flags);
+		return 0;
+
+	case SIMTEMP_IOC_SET_WATERMARK:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+
+		if (!val || val > reader->bufs->ringbuf.size)
+			return -EINVAL;
+
+		WRITE_ONCE(reader->watermark, val);
+		wake_up_interruptible(&reader->bufs->wait);
+		return 0;
+
+	case SIMTEMP_IOC_GET_STATS:
+		return simtemp_stats_ioctl(uarg);
+
+	case SIMTEMP_IOC_SET_BUSY_POLL:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+
+		if (val > SIMTEMP_BUSY_POLL_MAX_US)
+			return -EINVAL;
+
+		WRITE_ONCE(reader->busy_poll_us, val);
+		return 0;
+
+	case SIMTEMP_IOC_SET_ACTUATOR:
+		/* Drives the plant every reader sees, like writing the control page */
+		if (!(filp->f_mode & FMODE_WRITE))
+			return -EBADF;
+
+		return simtemp_actuator_ioctl(dev, uarg);
+
+	case SIMTEMP_IOC_OPEN_VIEW:
+		return simtemp_view_open(dev, uarg);
+
+	case SIMTEMP_IOC_SET_SCENARIO:
+		/* Switches the mode, which sysfs only lets root do */
+		if (!(filp->f_mode & FMODE_WRITE))
+			return -EBADF;
+
+		sc = simtemp_scenario_load(uarg);
+		if (IS_ERR(sc))
+			return PTR_ERR(sc);
+
+		/* One section, so no mode change can come in between */
+		mutex_lock(&dev->config_lock);
+		simtemp_scenario_set(dev, sc);
+		dev->mode = SIMTEMP_MODE_SCENARIO;
+		simtemp_select_producer(dev);
+		mutex_unlock(&dev->config_lock);
+		return 0;
+
+	case SIMTEMP_IOC_READ_HISTORY:
+		return simtemp_history_ioctl(dev, uarg);
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+/*
+ * File operations: unlocked_ioctl()
+ * Every command fails with -ENODEV once the instance was removed.
+ */
+static long simtemp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct simtemp_device *dev;
+	long ret;
+	int idx;
+
+	dev = simtemp_file_enter(filp->private_data, &idx);
+	ret = dev ? simtemp_file_ioctl(dev, filp, cmd, arg) : -ENODEV;
+	simtemp_file_leave(idx);
+
+	return ret;
+}
+
+/*
+ * Ring mappings outlive the file they were created from, and possibly the
+ * instance, so every mapping (including copies made by fork() or VMA
+ * splits) holds the sample buffers in vm_private_data
+ */
+static void simtemp_vma_open(struct vm_area_struct *vma)
+{
+	simtemp_buffers_hold(vma->vm_private_data);
+}
+
+static void simtemp_vma_close(struct vm_area_struct *vma)
+{
+	simtemp_buffers_drop(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct simtemp_vm_ops = {
+	.open	= simtemp_vma_open,
+	.close	= simtemp_vma_close,
+};
+
+/*
+ * File operations: mmap()
+ * Maps the ring buffer (header page + records) read-only at offset 0
+ */
+static int simtemp_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct simtemp_reader *reader = filp->private_data;
+	struct simtemp_ringbuf *rb = &reader->bufs->ringbuf;
+	struct simtemp_device *dev;
+	int idx, ret;
+
+	/* Actuator page: shared and writable */
+	if (vma->vm_pgoff == SIMTEMP_CTRL_MMAP_OFFSET >> PAGE_SHIFT) {
+		dev = simtemp_file_enter(reader, &idx);
+		ret = dev ? simtemp_control_mmap(dev, vma) : -ENODEV;
+		simtemp_file_leave(idx);
+		return ret;
+	}
+
+	/* The ring is written by the driver only */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > rb->bytes) {
+		pr_debug("%s: mmap() outside of ring buffer\n", DRIVER_NAME);
+		return -EINVAL;
+	}
+
+	vm_flags_clear(vma, VM_MAYWRITE);
+
+	ret = remap_vmalloc_range(vma, rb->hdr, 0);
+	if (ret)
+		return ret;
+
+	/* The file holds a reference, so the buffers cannot be freed here */
+	vma->vm_private_data = reader->bufs;
+	vma->vm_ops = &simtemp_vm_ops;
+	simtemp_vma_open(vma);
+
+	return 0;
+}
+
+/*
+ * File operations: show_fdinfo()
+ * Per-consumer counters for /proc/<pid>/fdinfo/<fd>
+ *
+ * lag is the number of records between this file's cursor and the ring
+ * head; a lag above ring_size means the reader is being overrun.
+ */
+static void simtemp_show_fdinfo(struct seq_file *m, struct file *filp)
+{
+	struct simtemp_reader *reader = filp->private_data;
+	struct simtemp_ringbuf *rb = &reader->bufs->ringbuf;
+	u32 cursor = READ_ONCE(reader->cursor);
+
+	if (rb->payload_bytes)
+		seq_printf(m, "simtemp-format:\tframe (%u B, payload %u B)\n",
+			   rb->record_size, rb->payload_bytes);
+	else
+		seq_printf(m, "simtemp-format:\tsample (%zu B)\n", sizeof(struct simtemp_sample));
+	seq_printf(m, "simtemp-watermark:\t%u\n", READ_ONCE(reader->watermark));
+	seq_printf(m, "simtemp-cursor:\t%u\n", cursor);
+	seq_printf(m, "simtemp-lag:\t%u\n", simtemp_ringbuf_pending(rb, cursor));
+	seq_printf(m, "simtemp-dropped:\t%llu\n", reader->dropped);
+	seq_printf(m, "simtemp-samples-read:\t%llu\n", reader->samples_read);
+	seq_printf(m, "simtemp-bytes-read:\t%llu\n", reader->bytes_read);
+	seq_printf(m, "simtemp-reads:\t%llu\n", reader->read_count);
+	seq_printf(m, "simtemp-polls:\t%llu\n", reader->poll_count);
+	seq_printf(m, "simtemp-wakeups:\t%llu\n", reader->wakeups);
+	seq_printf(m, "simtemp-busy-poll-us:\t%u\n", READ_ONCE(reader->busy_poll_us));
+	seq_printf(m, "simtemp-interval-ns:\t%llu\n", reader->interval_ns);
+	seq_printf(m, "simtemp-busy-hits:\t%llu\n", reader->busy_hits);
+	seq_printf(m, "simtemp-busy-misses:\t%llu\n", reader->busy_misses);
+	seq_printf(m, "simtemp-busy-skips:\t%llu\n", reader->busy_skips);
+}
+
+/*
+ * File operations structure
+ */
+static const struct file_operations simtemp_fops = {
+	.owner		= THIS_MODULE,
+	.open		= simtemp_open,
+	.release	= simtemp_release,
+	.read_iter	= simtemp_read_iter,
+	.splice_read	= copy_splice_read,
+	.write		= simtemp_write,
+	.poll		= simtemp_poll,
+	.unlocked_ioctl	= simtemp_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
+	.mmap		= simtemp_mmap,
+	.show_fdinfo	= simtemp_show_fdinfo,
+	.llseek		= noop_llseek,
+};
+
+/*
+ * Device of a sysfs attribute
+ * misc_register() points the class device's drvdata at the miscdevice,
+ * and the attributes exist from that moment on, so go through it.
+ */
+static struct simtemp_device *simtemp_from_dev(struct device *dev)
+{
+	struct miscdevice *misc = dev_get_drvdata(dev);
+
+	return container_of(misc, struct simtemp_device, miscdev);
+}
+
+/*
+ * Sysfs attribute: sampling_ms (RW)
+ * Show current sampling period in milliseconds
+ */
+static ssize_t sampling_ms_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+
+	return sysfs_emit(buf, "%u\n", sdev->sampling_ms);
+}
+
+/*
+ * Sysfs attribute: sampling_ms (RW)
+ * Update sampling period and restart timer with new period
+ */
+static ssize_t sampling_ms_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret) {
+		pr_warn("%s: Invalid sampling_ms value: %s\n", DRIVER_NAME, buf);
+		return ret;
+	}
+
+	/* Validate range */
+	if (val < SIMTEMP_SAMPLING_MS_MIN || val > SIMTEMP_SAMPLING_MS_MAX) {
+		pr_warn("%s: sampling_ms out of range (%u-%u): %u\n",
+			DRIVER_NAME, SIMTEMP_SAMPLING_MS_MIN, SIMTEMP_SAMPLING_MS_MAX, val);
+		return -EINVAL;
+	}
+
+	mutex_lock(&sdev->config_lock);
+
+	/* Update sampling period */
+	sdev->sampling_ms = val;
+	sdev->sampling_period = ms_to_ktime(val);
+
+	/*
+	 * Restart timer with new period. A scenario keeps the ticks on its
+	 * own timeline, so there the timer is left alone and its forward
+	 * picks up the new period with the next tick.
+	 */
+	if (sdev->mode != SIMTEMP_MODE_SCENARIO) {
+		hrtimer_cancel(&sdev->timer);
+		hrtimer_start(&sdev->timer, sdev->sampling_period, HRTIMER_MODE_REL);
+	}
+
+	mutex_unlock(&sdev->config_lock);
+
+	pr_info("%s: Sampling period changed to %u ms\n", DRIVER_NAME, val);
+	return count;
+}
+static DEVICE_ATTR_RW(sampling_ms);
+
+/*
+ * Sysfs attribute: threshold_mC (RW)
+ * Show current threshold in milli-Celsius
+ */
+static ssize_t threshold_mC_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", sdev->threshold_mC);
+}
+
+/*
+ * Sysfs attribute: threshold_mC (RW)
+ * Update alert threshold
+ */
+static ssize_t threshold_mC_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	int val;
+	int ret;
+
+	ret = kstrtoint(buf, 10, &val);
+	if (ret) {
+		pr_warn("%s: Invalid threshold_mC value: %s\n", DRIVER_NAME, buf);
+		return ret;
+	}
+
+	/* Validate range */
+	if (val < SIMTEMP_THRESHOLD_MC_MIN || val > SIMTEMP_THRESHOLD_MC_MAX) {
+		pr_warn("%s: threshold_mC out of range (%d-%d): %d\n",
+			DRIVER_NAME, SIMTEMP_THRESHOLD_MC_MIN, SIMTEMP_THRESHOLD_MC_MAX, val);
+		return -EINVAL;
+	}
+
+	mutex_lock(&sdev->config_lock);
+	sdev->threshold_mC = val;
+	mutex_unlock(&sdev->config_lock);
+
+	pr_info("%s: Threshold changed to %d mC\n", DRIVER_NAME, val);
+	return count;
+}
+static DEVICE_ATTR_RW(threshold_mC);
+
+/*
+ * Sysfs attribute: mode (RW)
+ * Show current temperature generation mode
+ */
+static ssize_t mode_show(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	const char *mode_str;
+
+	switch (sdev->mode) {
+	case SIMTEMP_MODE_NORMAL:
+		mode_str = "normal";
+		break;
+	case SIMTEMP_MODE_NOISY:
+		mode_str = "noisy";
+		break;
+	case SIMTEMP_MODE_RAMP:
+		mode_str = "ramp";
+		break;
+	case SIMTEMP_MODE_PLANT:
+		mode_str = "plant";
+		break;
+	case SIMTEMP_MODE_REPLAY:
+		mode_str = "replay";
+		break;
+	case SIMTEMP_MODE_SCENARIO:
+		mode_str = "scenario";
+		break;
+	default:
+		mode_str = "unknown";
+		break;
+	}
+
+	return sysfs_emit(buf, "%s\n", mode_str);
+}
+
+/*
+ * Sysfs attribute: mode (RW)
+ * Update temperature generation mode
+ */
+static ssize_t mode_store(struct device *dev,
+			   struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	enum simtemp_mode new_mode;
+	int ret = 0;
+
+	/* Parse mode string */
+	if (sysfs_streq(buf, "normal")) {
+		new_mode = SIMTEMP_MODE_NORMAL;
+	} else if (sysfs_streq(buf, "noisy")) {
+		new_mode = SIMTEMP_MODE_NOISY;
+	} else if (sysfs_streq(buf, "ramp")) {
+		new_mode = SIMTEMP_MODE_RAMP;
+	} else if (sysfs_streq(buf, "plant")) {
+		new_mode = SIMTEMP_MODE_PLANT;
+	} else if (sysfs_streq(buf, "replay")) {
+		new_mode = SIMTEMP_MODE_REPLAY;
+	} else if (sysfs_streq(buf, "scenario")) {
+		new_mode = SIMTEMP_MODE_SCENARIO;
+	} else {
+		pr_warn("%s: Invalid mode: %s (use: normal, noisy, ramp, plant, replay, scenario)\n",
+			DRIVER_NAME, buf);
+		return -EINVAL;
+	}
+
+	mutex_lock(&sdev->config_lock);
+
+	/* "scenario" (re)starts the scenario loaded with SIMTEMP_IOC_SET_SCENARIO */
+	if (new_mode == SIMTEMP_MODE_SCENARIO)
+		ret = simtemp_scenario_restart(sdev);
+
+	if (!ret) {
+		sdev->mode = new_mode;
+		simtemp_select_producer(sdev);
+	}
+
+	mutex_unlock(&sdev->config_lock);
+
+	if (ret) {
+		pr_warn("%s: No scenario loaded\n", DRIVER_NAME);
+		return ret;
+	}
+
+	pr_info("%s: Mode changed to %s\n", DRIVER_NAME, buf);
+	return count;
+}
+static DEVICE_ATTR_RW(mode);
+
+/*
+ * Sysfs attribute: shaping (RW)
+ * Show delivery shaping configuration
+ */
+static ssize_t shaping_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	struct simtemp_shaping *sh = &sdev->shaping;
+	ssize_t len;
+
+	mutex_lock(&sdev->config_lock);
+	len = sysfs_emit(buf, "jitter_us=%u burst=%u stall_ms=%u stall_permille=%u seed=%llu\n",
+			 sh->jitter_us, sh->burst, sh->stall_ms, sh->stall_permille, sh->seed);
+	mutex_unlock(&sdev->config_lock);
+
+	return len;
+}
+
+/*
+ * Sysfs attribute: shaping (RW)
+ * Update delivery shaping: "key=value ..." (unnamed keys keep their
+ * value) or "off". Every write reseeds the PRNG, so writing the same
+ * settings replays the same delivery pattern.
+ */
+static ssize_t shaping_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	struct simtemp_shaping *sh = &sdev->shaping;
+	struct simtemp_shaping new;
+	char *opts, *cur, *tok, *val;
+	int ret = 0;
+
+	opts = kstrndup(buf, count, GFP_KERNEL);
+	if (!opts)
+		return -ENOMEM;
+
+	mutex_lock(&sdev->config_lock);
+	new = *sh;
+
+	cur = opts;
+	while ((tok = strsep(&cur, " \t\n")) != NULL) {
+		if (!*tok)
+			continue;
+
+		if (!strcmp(tok, "off")) {
+			new.jitter_us = 0;
+			new.burst = 0;
+			new.stall_ms = 0;
+			new.stall_permille = 0;
+			continue;
+		}
+
+		val = strchr(tok, '=');
+		if (!val) {
+			ret = -EINVAL;
+			break;
+		}
+		*val++ = '\0';
+
+		if (!strcmp(tok, "jitter_us"))
+			ret = kstrtou32(val, 10, &new.jitter_us);
+		else if (!strcmp(tok, "burst"))
+			ret = kstrtou32(val, 10, &new.burst);
+		else if (!strcmp(tok, "stall_ms"))
+			ret = kstrtou32(val, 10, &new.stall_ms);
+		else if (!strcmp(tok, "stall_permille"))
+			ret = kstrtou32(val, 10, &new.stall_permille);
+		else if (!strcmp(tok, "seed"))
+			ret = kstrtou64(val, 10, &new.seed);
+		else
+			ret = -EINVAL;
+		if (ret)
+			break;
+	}
+
+	if (!ret && (new.jitter_us > SHAPING_JITTER_US_MAX || new.burst > SHAPING_BURST_MAX ||
+		     new.stall_ms > SHAPING_STALL_MS_MAX || new.stall_permille > 1000))
+		ret = -EINVAL;
+
+	if (ret) {
+		mutex_unlock(&sdev->config_lock);
+		pr_warn("%s: Invalid shaping: %s\n", DRIVER_NAME, buf);
+		kfree(opts);
+		return ret;
+	}
+
+	/* The timer owns the shaping state while it runs */
+	hrtimer_cancel(&sdev->timer);
+
+	sh->jitter_us = new.jitter_us;
+	sh->burst = new.burst;
+	sh->stall_ms = new.stall_ms;
+	sh->stall_permille = new.stall_permille;
+	sh->seed = new.seed;
+	prandom_seed_state(&sh->rnd, sh->seed);
+
+	/* Anything still held goes out with the next tick */
+	simtemp_shape_reset(sdev);
+	simtemp_select_producer(sdev);
+
+	hrtimer_start(&sdev->timer, sdev->sampling_period, HRTIMER_MODE_REL);
+
+	mutex_unlock(&sdev->config_lock);
+	kfree(opts);
+
+	pr_info("%s: %s shaping: jitter %u us, burst %u, stall %u ms (%u/1000), seed %llu\n",
+		DRIVER_NAME, sdev->name, sh->jitter_us, sh->burst, sh->stall_ms,
+		sh->stall_permille, sh->seed);
+	return count;
+}
+static DEVICE_ATTR_RW(shaping);
+
+/*
+ * Sysfs attribute: payload_bytes (RW)
+ * Generated payload carried by every record, 0 for plain samples
+ */
+static ssize_t payload_bytes_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(sdev->payload_bytes));
+}
+
+/*
+ * Sysfs attribute: payload_bytes (RW)
+ * Switch between samples and frames
+ *
+ * The record size is fixed for the lifetime of the sample buffers, so
+ * this fails with -EBUSY while the instance has users (open files,
+ * mappings or multiplexer subscriptions). Idle buffers are freed right
+ * away and reallocated with the new size on the next open.
+ */
+static ssize_t payload_bytes_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 10, &val);
+	if (ret) {
+		pr_warn("%s: Invalid payload_bytes value: %s\n", DRIVER_NAME, buf);
+		return ret;
+	}
+
+	/* Validate range */
+	if (val && (val < SIMTEMP_PAYLOAD_MIN || val > SIMTEMP_PAYLOAD_MAX ||
+		    !IS_ALIGNED(val, SIMTEMP_PAYLOAD_ALIGN))) {
+		pr_warn("%s: payload_bytes must be 0 or %d-%d in steps of %d: %u\n",
+			DRIVER_NAME, SIMTEMP_PAYLOAD_MIN, SIMTEMP_PAYLOAD_MAX,
+			SIMTEMP_PAYLOAD_ALIGN, val);
+		return -EINVAL;
+	}
+
+	mutex_lock(&sdev->bufs_lock);
+	if (sdev->users) {
+		mutex_unlock(&sdev->bufs_lock);
+		return -EBUSY;
+	}
+
+	simtemp_buffers_release(sdev);
+	WRITE_ONCE(sdev->payload_bytes, val);
+	mutex_unlock(&sdev->bufs_lock);
+
+	pr_info("%s: %s payload changed to %u bytes\n", DRIVER_NAME, sdev->name, val);
+	return count;
+}
+static DEVICE_ATTR_RW(payload_bytes);
+
+/*
+ * Sum the per-CPU statistics counters of an instance
+ * Lockless; counters may move while they are being summed.
+ */
+void simtemp_stats_read(struct simtemp_device *dev, struct simtemp_stats *sum)
+{
+	struct simtemp_stats *st;
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(dev->stats, cpu);
+		sum->total_samples += READ_ONCE(st->total_samples);
+		sum->threshold_alerts += READ_ONCE(st->threshold_alerts);
+		sum->read_count += READ_ONCE(st->read_count);
+		sum->poll_count += READ_ONCE(st->poll_count);
+		sum->reader_overruns += READ_ONCE(st->reader_overruns);
+		sum->injected_samples += READ_ONCE(st->injected_samples);
+		sum->staging_drops += READ_ONCE(st->staging_drops);
+		sum->jittered_ticks += READ_ONCE(st->jittered_ticks);
+		sum->bursts += READ_ONCE(st->bursts);
+		sum->stalls += READ_ONCE(st->stalls);
+		sum->held_samples += READ_ONCE(st->held_samples);
+	}
+}
+
+/*
+ * Sysfs attribute: stats (RO)
+ * Display statistics counters
+ */
+static ssize_t stats_show(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	struct simtemp_stats stats;
+
+	simtemp_stats_read(sdev, &stats);
+
+	return sysfs_emit(buf,
+		"total_samples: %llu\n"
+		"threshold_alerts: %llu\n"
+		"read_count: %llu\n"
+		"poll_count: %llu\n"
+		"reader_overruns: %llu\n"
+		"injected_samples: %llu\n"
+		"staging_drops: %llu\n"
+		"jittered_ticks: %llu\n"
+		"bursts: %llu\n"
+		"stalls: %llu\n"
+		"held_samples: %llu\n",
+		stats.total_samples,
+		stats.threshold_alerts,
+		stats.read_count,
+		stats.poll_count,
+		stats.reader_overruns,
+		stats.injected_samples,
+		stats.staging_drops,
+		stats.jittered_ticks,
+		stats.bursts,
+		stats.stalls,
+		stats.held_samples);
+}
+static DEVICE_ATTR_RO(stats);
+
+/*
+ * Sysfs attribute: memory (RO)
+ * Memory held by this instance, in bytes
+ * buffers is 0 while the instance is idle (no open files or mappings
+ * for idle_timeout_ms).
+ */
+static ssize_t memory_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	struct simtemp_buffers *bufs;
+	size_t state = sizeof(*sdev);
+	size_t buffers = 0;
+	size_t history;
+	unsigned int users;
+
+	mutex_lock(&sdev->bufs_lock);
+	bufs = rcu_dereference_protected(sdev->bufs, lockdep_is_held(&sdev->bufs_lock));
+	if (bufs)
+		buffers = simtemp_buffers_bytes(bufs);
+	users = sdev->users;
+	mutex_unlock(&sdev->bufs_lock);
+
+	history = simtemp_history_bytes(sdev);
+
+	return sysfs_emit(buf,
+		"state: %zu\n"
+		"buffers: %zu\n"
+		"history: %zu\n"
+		"total: %zu\n"
+		"users: %u\n",
+		state, buffers, history, state + buffers + history, users);
+}
+static DEVICE_ATTR_RO(memory);
+
+/*
+ * Sysfs attribute: scenario (RO)
+ * Position of the scenario loaded with SIMTEMP_IOC_SET_SCENARIO
+ */
+static ssize_t scenario_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	return simtemp_scenario_show(simtemp_from_dev(dev), buf);
+}
+static DEVICE_ATTR_RO(scenario);
+
+/*
+ * Sysfs attribute: history_kb (RW)
+ * Memory budget of the compact sample history, 0 = disabled
+ */
+static ssize_t history_kb_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", simtemp_history_budget(simtemp_from_dev(dev)));
+}
+
+/*
+ * Sysfs attribute: history_kb (RW)
+ * Every write starts a new, empty history. While enabled the history
+ * keeps the instance sampling, like an open file.
+ */
+static ssize_t history_kb_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct simtemp_device *sdev = simtemp_from_dev(dev);
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 10, &val);
+	if (ret) {
+		pr_warn("%s: Invalid history_kb value: %s\n", DRIVER_NAME, buf);
+		return ret;
+	}
+
+	if (val > HISTORY_KB_MAX) {
+		pr_warn("%s: history_kb out of range (0-%d): %u\n",
+			DRIVER_NAME, HISTORY_KB_MAX, val);
+		return -EINVAL;
+	}
+
+	ret = simtemp_history_resize(sdev, val);
+	if (ret)
+		return ret;
+
+	pr_info("%s: %s history budget changed to %u KiB\n", DRIVER_NAME, sdev->name, val);
+	return count;
+}
+static DEVICE_ATTR_RW(history_kb);
+
+/*
+ * Sysfs attribute: history (RO)
+ * Samples, encoded bytes and time span the history currently holds
+ */
+static ssize_t history_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	return simtemp_history_show(simtemp_from_dev(dev), buf);
+}
+static DEVICE_ATTR_RO(history);
+
+/*
+ * Sysfs attribute group
+ */
+static struct attribute *simtemp_attrs[] = {
+	&dev_attr_sampling_ms.attr,
+	&dev_attr_threshold_mC.attr,
+	&dev_attr_mode.attr,
+	&dev_attr_shaping.attr,
+	&dev_attr_payload_bytes.attr,
+	&dev_attr_stats.attr,
+	&dev_attr_memory.attr,
+	&dev_attr_scenario.attr,
+	&dev_attr_history_kb.attr,
+	&dev_attr_history.attr,
+	NULL
+};
+
+ATTRIBUTE_GROUPS(simtemp);
+
+/*
+ * Claim an instance number
+ * Platform devices created by this module carry their number as pdev->id;
+ * Device Tree instances (or a taken number) get the lowest free one.
+ */
+static int simtemp_claim_id(struct simtemp_device *dev)
+{
+	int ret = -EBUSY;
+
+	if (dev->pdev->id >= 0) {
+		dev->id = dev->pdev->id;
+		ret = xa_insert(&simtemp_instances, dev->id, dev, GFP_KERNEL);
+	}
+
+	if (ret == -EBUSY)
+		ret = xa_alloc(&simtemp_instances, &dev->id, dev,
+			       XA_LIMIT(0, NR_INSTANCES_MAX - 1), GFP_KERNEL);
+
+	return ret;
+}
+
+/*
+ * devm action: release the instance number
+ */
+static void simtemp_release_id(void *data)
+{
+	struct simtemp_device *dev = data;
+
+	/* remove already did it, and the number may belong to a new instance */
+	xa_cmpxchg(&simtemp_instances, dev->id, dev, NULL, GFP_KERNEL);
+}
+
+/*
+ * Platform driver probe function
+ * Called when device tree node matches our compatible string
+ *
+ * Probes run asynchronously and in parallel, so everything here is per
+ * instance. The device is registered last, with its attributes, so it
+ * appears to user space fully formed.
+ */
+static int simtemp_probe(struct platform_device *pdev)
+{
+	struct simtemp_device *dev;
+	struct device_node *np = pdev->dev.of_node;
+	int ret;
+	u32 val;
+
+	/* Allocate device structure */
+	dev = devm_kzalloc(&pdev->dev, sizeof(*dev), GFP_KERNEL);
+	if (!dev)
+		return -ENOMEM;
+
+	dev->pdev = pdev;
+	platform_set_drvdata(pdev, dev);
+
+	/*
+	 * Allocate statistics before the instance number: devm releases in
+	 * reverse order, so the instance leaves simtemp_instances (where the
+	 * stats snapshot finds it) before its counters are freed
+	 */
+	dev->stats = devm_alloc_percpu(&pdev->dev, struct simtemp_stats);
+	if (!dev->stats)
+		return -ENOMEM;
+
+	ret = simtemp_claim_id(dev);
+	if (ret) {
+		pr_err("%s: No free instance number: %d\n", DRIVER_NAME, ret);
+		return ret;
+	}
+
+	ret = devm_add_action_or_reset(&pdev->dev, simtemp_release_id, dev);
+	if (ret)
+		return ret;
+
+	if (dev->id)
+		snprintf(dev->name, sizeof(dev->name), "simtemp%u", dev->id);
+	else
+		snprintf(dev->name, sizeof(dev->name), "simtemp");
+
+	/* Parse Device Tree properties with defaults */
+	dev->sampling_ms = DEFAULT_SAMPLING_MS;
+	if (np && of_property_read_u32(np, "sampling-ms", &val) == 0) {
+		if (val >= SIMTEMP_SAMPLING_MS_MIN && val <= SIMTEMP_SAMPLING_MS_MAX) {
+			dev->sampling_ms = val;
+			pr_info("%s: DT sampling-ms = %u\n", DRIVER_NAME, val);
+		} else {
+			pr_warn("%s: DT sampling-ms out of range, using default\n", DRIVER_NAME);
+		}
+	}
+
+	dev->threshold_mC = DEFAULT_THRESHOLD_MC;
+	if (np && of_property_read_u32(np, "threshold-mC", &val) == 0) {
+		dev->threshold_mC = (s32)val;
+		pr_info("%s: DT threshold-mC = %d\n", DRIVER_NAME, dev->threshold_mC);
+	}
+
+	dev->mode = DEFAULT_MODE;
+	dev->current_temp_mC = 40000; /* Start at 40°C */
+	dev->ramp_direction = true;   /* Ramp up initially */
+	simtemp_select_producer(dev);
+	prandom_seed_state(&dev->shaping.rnd, dev->shaping.seed);
+
+	/* Initialize synchronization primitives */
+	mutex_init(&dev->config_lock);
+
+	/* Sample buffers are allocated on first open (simtemp_buffers_get()) */
+	mutex_init(&dev->bufs_lock);
+	INIT_LIST_HEAD(&dev->listeners);
+	INIT_DELAYED_WORK(&dev->idle_work, simtemp_idle_work);
+
+	/* Compact sample history, enabled below or through sysfs */
+	ret = simtemp_history_init(dev);
+	if (ret)
+		return ret;
+
+	/* Initialize timer (will be started after char device registration) */
+	hrtimer_init(&dev->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->timer.function = simtemp_timer_callback;
+	dev->sampling_period = ms_to_ktime(dev->sampling_ms);
+
+	/*
+	 * Register misc character device together with its sysfs attributes,
+	 * so udev never sees the device without them
+	 */
+	dev->miscdev.minor = MISC_DYNAMIC_MINOR;
+	dev->miscdev.name = dev->name;
+	dev->miscdev.fops = &simtemp_fops;
+	dev->miscdev.parent = &pdev->dev;
+	dev->miscdev.groups = simtemp_groups;
+	dev->miscdev.mode = 0644;  /* Everyone reads, root injects and configures */
+
+	ret = misc_register(&dev->miscdev);
+	if (ret) {
+		pr_err("%s: Failed to register misc device %s: %d\n",
+		       DRIVER_NAME, dev->name, ret);
+		return ret;
+	}
+
+	/* Plant state and the optional thermal cooling device */
+	simtemp_plant_init(dev, cooling_device);
+
+	/* Optional relay channel in debugfs */
+	simtemp_relay_init(dev, relay_subbufs, relay_subbuf_size);
+
+	/* Optional compact sample history */
+	if (history_kb && simtemp_history_resize(dev, min_t(unsigned int, history_kb,
+							     HISTORY_KB_MAX)))
+		pr_warn("%s: %s: No memory for a %u KiB history\n", DRIVER_NAME, dev->name,
+			history_kb);
+
+	/* Start the periodic timer */
+	hrtimer_start(&dev->timer, dev->sampling_period, HRTIMER_MODE_REL);
+
+	/*
+	 * One line per instance: with hundreds of instances the console
+	 * output would otherwise dominate module load time
+	 */
+	pr_info("%s: /dev/%s ready (sampling=%ums, threshold=%dmC, mode=%d)\n",
+		DRIVER_NAME, dev->name, dev->sampling_ms, dev->threshold_mC, dev->mode);
+
+	return 0;
+}
+
+/*
+ * Platform driver remove function
+ * Called when module is unloaded
+ */
+static void simtemp_remove(struct platform_device *pdev)
+{
+	struct simtemp_device *dev = platform_get_drvdata(pdev);
+	struct simtemp_buffers *bufs;
+	struct simtemp_stats stats;
+
+	/*
+	 * Unregister character device (and its attributes) first, so no
+	 * sampling_ms store can restart the timer after it is cancelled
+	 */
+	misc_deregister(&dev->miscdev);
+
+	/*
+	 * Disconnect the files that are still open: from now on they find
+	 * bufs->dev NULL and fail with -ENODEV. Sleeping readers are woken,
+	 * and every file operation that still uses the instance is waited
+	 * for. Files keep their reference on the buffers.
+	 */
+	mutex_lock(&simtemp_bufs_owner_lock);
+	mutex_lock(&dev->bufs_lock);
+	bufs = rcu_dereference_protected(dev->bufs, lockdep_is_held(&dev->bufs_lock));
+	if (bufs)
+		WRITE_ONCE(bufs->dev, NULL);
+	mutex_unlock(&dev->bufs_lock);
+	mutex_unlock(&simtemp_bufs_owner_lock);
+
+	/* The device's reference keeps bufs until simtemp_buffers_release() */
+	if (bufs)
+		wake_up_interruptible(&bufs->wait);
+	synchronize_srcu(&simtemp_files_srcu);
+
+	/*
+	 * Cancel timer - hrtimer_cancel() waits for callback to complete
+	 * if running
+	 */
+	if (hrtimer_cancel(&dev->timer))
+		pr_debug("%s: Timer was active, cancelled successfully\n", DRIVER_NAME);
+
+	/* The timer no longer reads the actuator page or the scenario */
+	simtemp_plant_exit(dev);
+	simtemp_scenario_exit(dev);
+
+	/*
+	 * Unpublish the instance: the grace period in
+	 * simtemp_listeners_release() also covers lockless lookups (BPF
+	 * kfuncs), which must be done before devm frees the instance
+	 */
+	xa_erase(&simtemp_instances, dev->id);
+
+	/* Stop feeding multiplexer subscriptions and other listeners */
+	simtemp_listeners_release(dev);
+
+	/* The relay channel and the history lost their writer with the listeners */
+	simtemp_relay_exit(dev);
+	simtemp_history_exit(dev);
+
+	/*
+	 * Release the sample buffers now rather than after the idle timeout.
+	 * Files and mappings that are still around keep their own reference.
+	 */
+	mutex_lock(&dev->bufs_lock);
+	simtemp_buffers_release(dev);
+	mutex_unlock(&dev->bufs_lock);
+
+	/* Nothing can arm the idle timeout any more */
+	cancel_delayed_work_sync(&dev->idle_work);
+
+	/* Log statistics before exit */
+	simtemp_stats_read(dev, &stats);
+	pr_info("%s: /dev/%s removed: samples=%llu, alerts=%llu, reads=%llu\n",
+		DRIVER_NAME, dev->name, stats.total_samples,
+		stats.threshold_alerts, stats.read_count);
+}
+
+/*
+ * Generate temperature for the given mode
+ * Returns temperature in milli-Celsius
+ *
+ * Always inlined with a compile-time constant mode, so every producer
+ * variant below only contains the code of its own mode.
+ */
+static __always_inline s32 simtemp_generate_temperature(struct simtemp_device *dev,
+							 const enum simtemp_mode mode)
+{
+	s32 temp_mC;
+	u32 random;
+
+	switch (mode) {
+	case SIMTEMP_MODE_NORMAL:
+		/* Normal mode: 40-50°C with small variations (±2°C) */
+		get_random_bytes(&random, sizeof(random));
+		temp_mC = 45000 + ((s32)(random % 4000) - 2000);
+		break;
+
+	case SIMTEMP_MODE_NOISY:
+		/* Noisy mode: 30-60°C with large random variations */
+		get_random_bytes(&random, sizeof(random));
+		temp_mC = 45000 + ((s32)(random % 30000) - 15000);
+		if (temp_mC < 30000)
+			temp_mC = 30000;
+		if (temp_mC > 60000)
+			temp_mC = 60000;
+		break;
+
+	case SIMTEMP_MODE_RAMP:
+		/* Ramp mode: linear ramp between 30-70°C */
+		if (dev->ramp_direction) {
+			/* Ramping up */
+			dev->current_temp_mC += 500; /* +0.5°C per sample */
+			if (dev->current_temp_mC >= 70000) {
+				dev->current_temp_mC = 70000;
+				dev->ramp_direction = false; /* Start ramping down */
+			}
+		} else {
+			/* Ramping down */
+			dev->current_temp_mC -= 500; /* -0.5°C per sample */
+			if (dev->current_temp_mC <= 30000) {
+				dev->current_temp_mC = 30000;
+				dev->ramp_direction = true; /* Start ramping up */
+			}
+		}
+		temp_mC = dev->current_temp_mC;
+		break;
+
+	case SIMTEMP_MODE_PLANT:
+		/* Plant mode: thermal model driven by the actuator commands */
+		temp_mC = simtemp_plant_step(dev);
+		break;
+
+	case SIMTEMP_MODE_SCENARIO:
+		/* Scenario mode: position on the uploaded segment list */
+		temp_mC = simtemp_scenario_step(dev);
+		break;
+
+	default:
+		/* Fallback to normal mode */
+		temp_mC = 45000;
+		break;
+	}
+
+	return temp_mC;
+}
+
+/*
+ * Produce one sample for the given mode
+ *
+ * Template body for the producer variants. The threshold edge detection
+ * is computed arithmetically instead of with nested branches, so the
+ * per-sample path stays flat.
+ */
+static __always_inline void simtemp_produce(struct simtemp_device *dev,
+					    struct simtemp_sample *sample,
+					    const enum simtemp_mode mode)
+{
+	s32 temp_mC = simtemp_generate_temperature(dev, mode);
+	bool above = temp_mC > dev->threshold_mC;
+	bool rising = above && !dev->threshold_crossed;
+
+	sample->timestamp_ns = ktime_get_ns();
+	sample->temp_mC = temp_mC;
+	sample->flags = SIMTEMP_FLAG_NEW_SAMPLE |
+			(rising ? SIMTEMP_FLAG_THRESHOLD_CROSSED : 0);
+
+	this_cpu_add(dev->stats->threshold_alerts, rising);
+	dev->threshold_crossed = above;
+}
+
+/*
+ * Specialized producer variants, one per configuration combination
+ * Add a dimension here (and to simtemp_select_producer()) rather than a
+ * runtime check in simtemp_produce().
+ */
+#define SIMTEMP_DEFINE_PRODUCER(name, mode)				\
+static void simtemp_produce_##name(struct simtemp_device *dev,		\
+				   struct simtemp_sample *sample)	\
+{									\
+	simtemp_produce(dev, sample, mode);				\
+}
+
+SIMTEMP_DEFINE_PRODUCER(normal, SIMTEMP_MODE_NORMAL)
+SIMTEMP_DEFINE_PRODUCER(noisy, SIMTEMP_MODE_NOISY)
+SIMTEMP_DEFINE_PRODUCER(ramp, SIMTEMP_MODE_RAMP)
+SIMTEMP_DEFINE_PRODUCER(plant, SIMTEMP_MODE_PLANT)
+SIMTEMP_DEFINE_PRODUCER(scenario, SIMTEMP_MODE_SCENARIO)
+
+/*
+ * Delivery shaping
+ */
+
+/*
+ * Decide whether this tick delivers the staged samples
+ * Called by the shaped stage variant after staging the tick's sample
+ * (@staged is false when staging was full and the sample was dropped;
+ * @pending is what this CPU's staging ring now holds).
+ *
+ * A stall starts with probability stall_permille/1000 per tick and holds
+ * everything in staging for stall_ms; a burst holds samples until burst of
+ * them are staged. Held samples are released by a single flush. A hold
+ * also ends as soon as staging is full, so a stall longer than
+ * STAGING_SIZE ticks is cut short instead of dropping samples.
+ *
+ * While a hold is on, sh->holding keeps write() from flushing.
+ *
+ * Returns true if the staged samples should be flushed now.
+ */
+static bool simtemp_shape_deliver(struct simtemp_device *dev, u64 now_ns,
+				  bool staged, unsigned int pending)
+{
+	struct simtemp_shaping *sh = &dev->shaping;
+	bool room = pending < STAGING_SIZE;
+
+	if (sh->stall_until_ns) {
+		if (now_ns < sh->stall_until_ns && room)
+			goto hold;
+
+		/* Stall over (or staging full), release everything at once */
+		sh->stall_until_ns = 0;
+		goto release;
+	}
+
+	if (sh->stall_ms && prandom_u32_state(&sh->rnd) % 1000 < sh->stall_permille) {
+		sh->stall_until_ns = now_ns + (u64)sh->stall_ms * NSEC_PER_MSEC;
+		this_cpu_inc(dev->stats->stalls);
+		goto hold;
+	}
+
+	if (sh->burst > 1) {
+		if (sh->held + 1 < sh->burst && room)
+			goto hold;
+		this_cpu_inc(dev->stats->bursts);
+	}
+
+release:
+	if (sh->held) {
+		this_cpu_add(dev->stats->held_samples, sh->held);
+		sh->held = 0;
+	}
+	WRITE_ONCE(sh->holding, false);
+	return true;
+
+hold:
+	sh->held += staged;
+	WRITE_ONCE(sh->holding, true);
+	return false;
+}
+
+/*
+ * Forget any hold, so the next flush delivers everything
+ * Only from the timer callback, or while the timer is stopped.
+ */
+static void simtemp_shape_reset(struct simtemp_device *dev)
+{
+	struct simtemp_shaping *sh = &dev->shaping;
+
+	sh->held = 0;
+	sh->stall_until_ns = 0;
+	WRITE_ONCE(sh->holding, false);
+}
+
+/*
+ * Stage variants: put the tick's sample into staging and flush it
+ * Called from the timer callback under rcu_read_lock() with the
+ * instance's buffers.
+ */
+static void simtemp_stage_direct(struct simtemp_device *dev,
+				 struct simtemp_buffers *bufs,
+				 const struct simtemp_sample *sample)
+{
+	unsigned int dropped;
+
+	/* Merge it together with anything injected since the last tick */
+	simtemp_stage(bufs, sample, 1, &dropped);
+	this_cpu_add(dev->stats->staging_drops, dropped);
+
+	simtemp_flush(dev, bufs);
+
+	/* Wake any sleeping readers */
+	wake_up_interruptible(&bufs->wait);
+}
+
+/* With bursts or stalls configured: shaping may hold the sample back */
+static void simtemp_stage_shaped(struct simtemp_device *dev,
+				 struct simtemp_buffers *bufs,
+				 const struct simtemp_sample *sample)
+{
+	unsigned int pending, dropped;
+
+	pending = simtemp_stage(bufs, sample, 1, &dropped);
+	this_cpu_add(dev->stats->staging_drops, dropped);
+
+	if (simtemp_shape_deliver(dev, sample->timestamp_ns, !dropped, pending)) {
+		simtemp_flush(dev, bufs);
+		wake_up_interruptible(&bufs->wait);
+	}
+}
+
+/* Forward variants: one period later, or a uniform pick within +- jitter_us */
+static void simtemp_forward_periodic(struct simtemp_device *dev,
+				     struct hrtimer *timer)
+{
+	hrtimer_forward_now(timer, dev->sampling_period);
+}
+
+static void simtemp_forward_jittered(struct simtemp_device *dev,
+				     struct hrtimer *timer)
+{
+	struct simtemp_shaping *sh = &dev->shaping;
+	s64 period, jitter;
+
+	/* 2 * SHAPING_JITTER_US_MAX in ns still fits the u32 range */
+	jitter = (s64)sh->jitter_us * NSEC_PER_USEC;
+	period = ktime_to_ns(dev->sampling_period) - jitter +
+		 prandom_u32_state(&sh->rnd) % (u32)(2 * jitter + 1);
+
+	this_cpu_inc(dev->stats->jittered_ticks);
+
+	hrtimer_forward_now(timer, ns_to_ktime(max_t(s64, period, SHAPING_PERIOD_MIN_NS)));
+}
+
+/*
+ * Variants per mode; the forward used with jitter configured is
+ * forward_jittered. A scenario places a tick at every segment boundary,
+ * so jitter does not apply to it, and in "replay" mode writers are the
+ * only source and own the timing.
+ */
+static const struct {
+	simtemp_produce_fn produce;
+	simtemp_forward_fn forward;
+	simtemp_forward_fn forward_jittered;
+} simtemp_variants[] = {
+	[SIMTEMP_MODE_NORMAL]	= { simtemp_produce_normal, simtemp_forward_periodic,
+				    simtemp_forward_jittered },
+	[SIMTEMP_MODE_NOISY]	= { simtemp_produce_noisy, simtemp_forward_periodic,
+				    simtemp_forward_jittered },
+	[SIMTEMP_MODE_RAMP]	= { simtemp_produce_ramp, simtemp_forward_periodic,
+				    simtemp_forward_jittered },
+	[SIMTEMP_MODE_PLANT]	= { simtemp_produce_plant, simtemp_forward_periodic,
+				    simtemp_forward_jittered },
+	[SIMTEMP_MODE_REPLAY]	= { NULL, simtemp_forward_periodic,
+				    simtemp_forward_periodic },
+	[SIMTEMP_MODE_SCENARIO]	= { simtemp_produce_scenario, simtemp_scenario_forward,
+				    simtemp_scenario_forward },
+};
+
+/*
+ * Pick the producer, stage and forward variants for the current
+ * configuration
+ * Called with config_lock held (or before the timer is started). The
+ * timer picks up the new variants on its next tick; a mode change may
+ * let one tick pair the new producer with the old forward (or the
+ * reverse), which only gives it one period of the other kind. Shaping
+ * changes stop the timer around this.
+ */
+static void simtemp_select_producer(struct simtemp_device *dev)
+{
+	const struct simtemp_shaping *sh = &dev->shaping;
+	unsigned int mode = SIMTEMP_MODE_NORMAL;
+	bool shaped = sh->burst > 1 || (sh->stall_ms && sh->stall_permille);
+
+	if (dev->mode < ARRAY_SIZE(simtemp_variants))
+		mode = dev->mode;
+
+	WRITE_ONCE(dev->producer, simtemp_variants[mode].produce);
+	WRITE_ONCE(dev->stage, shaped ? simtemp_stage_shaped : simtemp_stage_direct);
+	WRITE_ONCE(dev->forward, sh->jitter_us ? simtemp_variants[mode].forward_jittered :
+						 simtemp_variants[mode].forward);
+}
+
+/*
+ * Timer tick in "replay" mode: nothing is generated, the tick only
+ * delivers samples that writers left in staging. Shaping is not applied,
+ * the writer owns the timing.
+ */
+static void simtemp_replay_tick(struct simtemp_device *dev)
+{
+	struct simtemp_buffers *bufs;
+
+	/* A hold left over from the previous mode must not block writers */
+	if (unlikely(dev->shaping.holding))
+		simtemp_shape_reset(dev);
+
+	rcu_read_lock();
+	bufs = rcu_dereference(dev->bufs);
+	if (bufs && simtemp_flush(dev, bufs))
+		wake_up_interruptible(&bufs->wait);
+	rcu_read_unlock();
+}
+
+/*
+ * Timer callback - Called periodically to generate temperature samples
+ * This runs in interrupt context, so must be fast and atomic
+ */
+static enum hrtimer_restart simtemp_timer_callback(struct hrtimer *timer)
+{
+	struct simtemp_device *dev = container_of(timer, struct simtemp_device, timer);
+	simtemp_produce_fn produce = READ_ONCE(dev->producer);
+	simtemp_forward_fn forward = READ_ONCE(dev->forward);
+	struct simtemp_buffers *bufs;
+	struct simtemp_sample sample;
+
+	if (unlikely(!produce)) {
+		simtemp_replay_tick(dev);
+		forward(dev, timer);
+		return HRTIMER_RESTART;
+	}
+
+	/* Generate sample with the variant selected for this configuration */
+	produce(dev, &sample);
+
+	/* Update statistics */
+	this_cpu_inc(dev->stats->total_samples);
+
+	/*
+	 * Stage sample on this CPU and deliver it with the stage variant.
+	 * While the instance is idle there are no buffers and nobody to
+	 * deliver to.
+	 */
+	rcu_read_lock();
+	bufs = rcu_dereference(dev->bufs);
+	if (bufs)
+		READ_ONCE(dev->stage)(dev, bufs, &sample);
+	rcu_read_unlock();
+
+	/* Restart timer for next sample with the variant's forward */
+	forward(dev, timer);
+	return HRTIMER_RESTART;
+}
+
+/*
+ * Device Tree match table
+ */
+static const struct of_device_id simtemp_of_match[] = {
+	{ .compatible = "nxp,simtemp", },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, simtemp_of_match);
+
+/*
+ * Platform driver structure
+ */
+static struct platform_driver simtemp_platform_driver = {
+	.probe = simtemp_probe,
+	.remove = simtemp_remove,
+	.driver = {
+		.name = DRIVER_NAME,
+		.of_match_table = simtemp_of_match,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+	},
+};
+
+/*
+ * Unregister the platform devices created at module load
+ */
+static void simtemp_unregister_pdevs(void)
+{
+	while (g_nr_pdevs)
+		platform_device_unregister(g_pdevs[--g_nr_pdevs]);
+
+	kfree(g_pdevs);
+	g_pdevs = NULL;
+}
+
+/*
+ * Module initialization
+ */
+static int __init simtemp_init(void)
+{
+	unsigned int count = clamp_t(unsigned int, nr_instances, 1, NR_INSTANCES_MAX);
+	struct platform_device *pdev;
+	int ret;
+
+	pr_info("%s: Initializing NXP SimTemp driver v%s\n", DRIVER_NAME, DRIVER_VERSION);
+
+	/* Driver-wide debugfs files (optional, failures are not fatal) */
+	simtemp_debugfs_init();
+
+	/* kfuncs for tracing BPF programs (optional as well) */
+	ret = simtemp_bpf_init();
+	if (ret)
+		pr_warn("%s: BPF kfuncs not registered: %d\n", DRIVER_NAME, ret);
+
+	/* Multiplexer device, /dev/simtemp-all */
+	ret = simtemp_mux_init();
+	if (ret) {
+		pr_err("%s: Failed to register multiplexer device: %d\n", DRIVER_NAME, ret);
+		simtemp_debugfs_exit();
+		return ret;
+	}
+
+	/* Register platform driver */
+	ret = platform_driver_register(&simtemp_platform_driver);
+	if (ret) {
+		pr_err("%s: Failed to register platform driver: %d\n", DRIVER_NAME, ret);
+		simtemp_mux_exit();
+		simtemp_debugfs_exit();
+		return ret;
+	}
+
+	g_pdevs = kcalloc(count, sizeof(*g_pdevs), GFP_KERNEL);
+	if (!g_pdevs) {
+		platform_driver_unregister(&simtemp_platform_driver);
+		simtemp_mux_exit();
+		simtemp_debugfs_exit();
+		return -ENOMEM;
+	}
+
+	/*
+	 * Create platform devices for testing
+	 * In production, these would come from Device Tree. Each one is
+	 * probed asynchronously, so this loop only queues the probes.
+	 */
+	while (g_nr_pdevs < count) {
+		pdev = platform_device_register_simple(DRIVER_NAME, g_nr_pdevs, NULL, 0);
+		if (IS_ERR(pdev)) {
+			ret = PTR_ERR(pdev);
+			pr_err("%s: Failed to register platform device %u: %d\n",
+			       DRIVER_NAME, g_nr_pdevs, ret);
+			simtemp_unregister_pdevs();
+			platform_driver_unregister(&simtemp_platform_driver);
+			simtemp_mux_exit();
+			simtemp_debugfs_exit();
+			return ret;
+		}
+		g_pdevs[g_nr_pdevs++] = pdev;
+	}
+
+	pr_info("%s: Driver registered successfully (%u instances)\n", DRIVER_NAME, count);
+	return 0;
+}
+
+/*
+ * Module cleanup
+ */
+static void __exit simtemp_exit(void)
+{
+	pr_info("%s: Exiting driver\n", DRIVER_NAME);
+
+	/* Unregister platform devices */
+	simtemp_unregister_pdevs();
+
+	/* Unregister platform driver */
+	platform_driver_unregister(&simtemp_platform_driver);
+
+	simtemp_mux_exit();
+	simtemp_debugfs_exit();
+
+	pr_info("%s: Driver unregistered\n", DRIVER_NAME);
+}
+
+module_init(simtemp_init);
+module_exit(simtemp_exit);
@@ -0,0 +1,534 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Multiplexer device /dev/simtemp-all
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * Following N instances through their own devices costs N fds, N poll
+ * registrations and N reads per wakeup. Every open file of
+ * /dev/simtemp-all instead subscribes to a set of instances (ioctl) and
+ * reads struct simtemp_tagged_sample records from all of them, merged in
+ * arrival order, from a single fifo.
+ *
+ * Each subscription is a listener on its instance, fed at the publish
+ * point in simtemp_flush(). Producers (listeners, any context) and
+ * consumers (read()) share the fifo under fifo_lock; samples arriving
+ * while the fifo is full are dropped and counted.
+ *
+ * A subscription whose instance is removed stays in the set, detached,
+ * until it is unsubscribed or subscribed again (a re-probed instance with
+ * the same number). Once every subscribed instance is gone, read()
+ * returns 0 with the fifo drained and poll() reports EPOLLHUP.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/xarray.h>
+#include <linux/seq_file.h>
+
+#include "nxp_simtemp.h"
+
+/* One open file of /dev/simtemp-all */
+struct simtemp_mux {
+	/* Subscriptions by instance number, changed under lock */
+	struct mutex lock;
+	struct xarray subs;
+	unsigned int nr_subs;
+	atomic_t live;			/* Subscriptions still attached */
+
+	/* Tagged sample fifo (MUX_FIFO_SIZE records, free-running indices) */
+	spinlock_t fifo_lock;
+	struct simtemp_tagged_sample *fifo;
+	unsigned int head;
+	unsigned int tail;
+	u32 watermark;			/* Records pending before EPOLLIN / wakeup */
+	wait_queue_head_t wait;
+
+	/* Counters for fdinfo */
+	u64 delivered;			/* Records queued, under fifo_lock */
+	u64 dropped;			/* Records lost to a full fifo, under fifo_lock */
+	u64 samples_read;
+	u64 read_count;
+	u64 poll_count;
+};
+
+/* Subscription of a multiplexer file to one instance */
+struct simtemp_mux_sub {
+	struct simtemp_listener listener;
+	struct simtemp_mux *mux;
+	u32 instance;
+	struct list_head dead;		/* Waiting for a grace period before kfree() */
+};
+
+/*
+ * Listener callback: queue one sample of the subscribed instance
+ * Runs in simtemp_flush() with interrupts disabled.
+ */
+static void simtemp_mux_deliver(struct simtemp_listener *listener,
+				const struct simtemp_sample *sample)
+{
+	struct simtemp_mux_sub *sub = container_of(listener, struct simtemp_mux_sub, listener);
+	struct simtemp_mux *mux = sub->mux;
+	struct simtemp_tagged_sample *rec;
+	unsigned int pending;
+
+	spin_lock(&mux->fifo_lock);
+
+	pending = mux->head - mux->tail;
+	if (pending < MUX_FIFO_SIZE) {
+		rec = &mux->fifo[mux->head & MUX_FIFO_MASK];
+		rec->instance = sub->instance;
+		rec->reserved = 0;
+		memcpy(&rec->sample, sample, sizeof(*sample));
+		mux->head++;
+		mux->delivered++;
+		pending++;
+	} else {
+		mux->dropped++;
+	}
+
+	spin_unlock(&mux->fifo_lock);
+
+	if (pending >= READ_ONCE(mux->watermark) && wq_has_sleeper(&mux->wait))
+		wake_up_interruptible(&mux->wait);
+}
+
+/*
+ * Listener callback: the subscribed instance is being removed
+ */
+static void simtemp_mux_removed(struct simtemp_listener *listener)
+{
+	struct simtemp_mux_sub *sub = container_of(listener, struct simtemp_mux_sub, listener);
+	struct simtemp_mux *mux = sub->mux;
+
+	atomic_dec(&mux->live);
+	wake_up_interruptible(&mux->wait);
+}
+
+/*
+ * Move up to @max records out of the fifo
+ * Returns the number of records copied
+ */
+static unsigned int simtemp_mux_take(struct simtemp_mux *mux,
+				     struct simtemp_tagged_sample *batch, unsigned int max)
+{
+	unsigned long flags;
+	unsigned int n = 0;
+
+	spin_lock_irqsave(&mux->fifo_lock, flags);
+	while (n < max && mux->tail != mux->head) {
+		memcpy(&batch[n++], &mux->fifo[mux->tail & MUX_FIFO_MASK], sizeof(*batch));
+		mux->tail++;
+	}
+	spin_unlock_irqrestore(&mux->fifo_lock, flags);
+
+	return n;
+}
+
+/*
+ * Check whether at least watermark records are queued (lockless)
+ */
+static bool simtemp_mux_pending(struct simtemp_mux *mux)
+{
+	return READ_ONCE(mux->head) - READ_ONCE(mux->tail) >= READ_ONCE(mux->watermark);
+}
+
+/*
+ * Check whether every subscribed instance was removed (lockless)
+ */
+static bool simtemp_mux_hangup(struct simtemp_mux *mux)
+{
+	return READ_ONCE(mux->nr_subs) && !atomic_read(&mux->live);
+}
+
+/*
+ * Unsubscribe from one instance
+ * Called with mux->lock held. The subscription is detached and moved to
+ * @dead; the caller frees it after an RCU grace period.
+ * Returns 1 if removed, 0 if not subscribed.
+ */
+static int simtemp_mux_del(struct simtemp_mux *mux, u32 instance, struct list_head *dead)
+{
+	struct simtemp_mux_sub *sub;
+
+	sub = xa_erase(&mux->subs, instance);
+	if (!sub)
+		return 0;
+
+	/*
+	 * Already detached (and uncounted) if its instance was removed.
+	 * Uncounted from the set first, so a reader never sees a hangup
+	 * that is not there.
+	 */
+	WRITE_ONCE(mux->nr_subs, mux->nr_subs - 1);
+	if (simtemp_listener_detach(&sub->listener))
+		atomic_dec(&mux->live);
+	list_add(&sub->dead, dead);
+	return 1;
+}
+
+/*
+ * Subscribe to one instance
+ * Called with mux->lock held. A subscription left detached by a removed
+ * instance is dropped and replaced. Returns 1 if added, 0 if already
+ * subscribed or the instance does not exist, or a negative error.
+ */
+static int simtemp_mux_add(struct simtemp_mux *mux, u32 instance, struct list_head *dead)
+{
+	struct simtemp_mux_sub *sub;
+	int ret;
+
+	sub = xa_load(&mux->subs, instance);
+	if (sub) {
+		if (READ_ONCE(sub->listener.dev))
+			return 0;
+		simtemp_mux_del(mux, instance, dead);
+	}
+
+	sub = kzalloc(sizeof(*sub), GFP_KERNEL);
+	if (!sub)
+		return -ENOMEM;
+
+	sub->mux = mux;
+	sub->instance = instance;
+	sub->listener.deliver = simtemp_mux_deliver;
+	sub->listener.removed = simtemp_mux_removed;
+
+	ret = xa_insert(&mux->subs, instance, sub, GFP_KERNEL);
+	if (ret) {
+		kfree(sub);
+		return ret;
+	}
+
+	/* Counted first: the instance may go away as soon as it is attached */
+	atomic_inc(&mux->live);
+	ret = simtemp_listener_attach(instance, &sub->listener);
+	if (ret) {
+		atomic_dec(&mux->live);
+		xa_erase(&mux->subs, instance);
+		kfree(sub);
+		return ret == -ENODEV ? 0 : ret;
+	}
+
+	WRITE_ONCE(mux->nr_subs, mux->nr_subs + 1);
+	return 1;
+}
+
+/*
+ * Free detached subscriptions once no flush can be delivering to them
+ */
+static void simtemp_mux_free_subs(struct list_head *dead)
+{
+	struct simtemp_mux_sub *sub, *tmp;
+
+	if (list_empty(dead))
+		return;
+
+	synchronize_rcu();
+
+	list_for_each_entry_safe(sub, tmp, dead, dead)
+		kfree(sub);
+}
+
+/*
+ * SIMTEMP_IOC_MUX_SUBSCRIBE / SIMTEMP_IOC_MUX_UNSUBSCRIBE
+ * Returns the number of instances added/removed
+ */
+static long simtemp_mux_update(struct simtemp_mux *mux, struct simtemp_mux_set __user *uset,
+			       bool subscribe)
+{
+	struct simtemp_mux_set set;
+	struct simtemp_mux_sub *sub;
+	struct simtemp_device *dev;
+	u32 __user *uinstances;
+	unsigned long index;
+	LIST_HEAD(dead);
+	long changed = 0;
+	u32 instance;
+	u32 i;
+	int ret = 0;
+
+	if (copy_from_user(&set, uset, sizeof(set)))
+		return -EFAULT;
+
+	if (set.flags & ~SIMTEMP_MUX_ALL)
+		return -EINVAL;
+
+	uinstances = u64_to_user_ptr(set.instances);
+
+	mutex_lock(&mux->lock);
+
+	if (set.flags & SIMTEMP_MUX_ALL) {
+		/* Sleeping in the body is fine, the walk takes RCU per step */
+		if (subscribe) {
+			xa_for_each(&simtemp_instances, index, dev) {
+				ret = simtemp_mux_add(mux, index, &dead);
+				if (ret < 0)
+					break;
+				changed += ret;
+			}
+		} else {
+			xa_for_each(&mux->subs, index, sub)
+				changed += simtemp_mux_del(mux, index, &dead);
+		}
+	} else {
+		for (i = 0; i < set.count; i++) {
+			if (get_user(instance, &uinstances[i])) {
+				ret = -EFAULT;
+				break;
+			}
+
+			if (subscribe) {
+				ret = simtemp_mux_add(mux, instance, &dead);
+				if (ret < 0)
+					break;
+				changed += ret;
+			} else {
+				changed += simtemp_mux_del(mux, instance, &dead);
+			}
+		}
+	}
+
+	mutex_unlock(&mux->lock);
+
+	simtemp_mux_free_subs(&dead);
+
+	/* Report partial progress rather than the error */
+	if (ret < 0 && !changed)
+		return ret;
+
+	return changed;
+}
+
+/*
+ * File operations: open()
+ * Starts with an empty subscription set
+ */
+static int simtemp_mux_open(struct inode *inode, struct file *filp)
+{
+	struct simtemp_mux *mux;
+
+	mux = kzalloc(sizeof(*mux), GFP_KERNEL);
+	if (!mux)
+		return -ENOMEM;
+
+	mux->fifo = kvcalloc(MUX_FIFO_SIZE, sizeof(*mux->fifo), GFP_KERNEL);
+	if (!mux->fifo) {
+		kfree(mux);
+		return -ENOMEM;
+	}
+
+	mutex_init(&mux->lock);
+	xa_init(&mux->subs);
+	atomic_set(&mux->live, 0);
+	spin_lock_init(&mux->fifo_lock);
+	init_waitqueue_head(&mux->wait);
+	mux->watermark = 1;
+
+	filp->private_data = mux;
+	return 0;
+}
+
+/*
+ * File operations: release()
+ * Detaches every subscription
+ */
+static int simtemp_mux_release(struct inode *inode, struct file *filp)
+{
+	struct simtemp_mux *mux = filp->private_data;
+	struct simtemp_mux_sub *sub;
+	unsigned long index;
+	LIST_HEAD(dead);
+
+	mutex_lock(&mux->lock);
+	xa_for_each(&mux->subs, index, sub)
+		simtemp_mux_del(mux, index, &dead);
+	mutex_unlock(&mux->lock);
+
+	simtemp_mux_free_subs(&dead);
+
+	xa_destroy(&mux->subs);
+	kvfree(mux->fifo);
+	kfree(mux);
+	return 0;
+}
+
+/*
+ * File operations: read()
+ * Returns as many whole struct simtemp_tagged_sample records as fit
+ *
+ * Blocks (unless O_NONBLOCK) until at least watermark records are queued,
+ * then drains the fifo in READ_BATCH chunks without sleeping again.
+ * Returns 0 once the fifo is drained and every subscribed instance is gone.
+ */
+static ssize_t simtemp_mux_read(struct file *filp, char __user *buf,
+				size_t count, loff_t *f_pos)
+{
+	struct simtemp_mux *mux = filp->private_data;
+	struct simtemp_tagged_sample batch[READ_BATCH];
+	size_t max = count / sizeof(struct simtemp_tagged_sample);
+	size_t done = 0;
+	unsigned int want, n;
+	int ret;
+
+	if (!max)
+		return -EINVAL;
+
+	for (;;) {
+		want = min_t(size_t, max, READ_BATCH);
+		n = simtemp_mux_take(mux, batch, want);
+		if (n)
+			break;
+
+		if (simtemp_mux_hangup(mux))
+			return 0;
+
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(mux->wait, simtemp_mux_pending(mux) ||
+						 simtemp_mux_hangup(mux));
+		if (ret)
+			return -ERESTARTSYS;
+	}
+
+	for (;;) {
+		if (copy_to_user(buf + done * sizeof(batch[0]), batch, n * sizeof(batch[0]))) {
+			pr_err("%s: copy_to_user failed\n", DRIVER_NAME);
+			return -EFAULT;
+		}
+		done += n;
+
+		/* Stop on a short chunk (fifo drained) or a full user buffer */
+		if (n < want || done == max)
+			break;
+
+		want = min_t(size_t, max - done, READ_BATCH);
+		n = simtemp_mux_take(mux, batch, want);
+		if (!n)
+			break;
+	}
+
+	mux->read_count++;
+	mux->samples_read += done;
+
+	return done * sizeof(struct simtemp_tagged_sample);
+}
+
+/*
+ * File operations: poll()
+ * EPOLLIN once at least watermark records are queued, EPOLLHUP once every
+ * subscribed instance is gone
+ */
+static __poll_t simtemp_mux_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct simtemp_mux *mux = filp->private_data;
+	__poll_t mask = 0;
+
+	poll_wait(filp, &mux->wait, wait);
+
+	mux->poll_count++;
+
+	if (simtemp_mux_pending(mux))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	if (simtemp_mux_hangup(mux))
+		mask |= EPOLLHUP;
+
+	return mask;
+}
+
+/*
+ * File operations: unlocked_ioctl()
+ */
+static long simtemp_mux_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct simtemp_mux *mux = filp->private_data;
+	void __user *uarg = (void __user *)arg;
+	u32 val;
+
+	switch (cmd) {
+	case SIMTEMP_IOC_MUX_SUBSCRIBE:
+		return simtemp_mux_update(mux, uarg, true);
+
+	case SIMTEMP_IOC_MUX_UNSUBSCRIBE:
+		return simtemp_mux_update(mux, uarg, false);
+
+	case SIMTEMP_IOC_SET_WATERMARK:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+
+		if (!val || val > MUX_FIFO_SIZE)
+			return -EINVAL;
+
+		WRITE_ONCE(mux->watermark, val);
+		wake_up_interruptible(&mux->wait);
+		return 0;
+
+	case SIMTEMP_IOC_GET_STATS:
+		return simtemp_stats_ioctl(uarg);
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+/*
+ * File operations: show_fdinfo()
+ */
+static void simtemp_mux_show_fdinfo(struct seq_file *m, struct file *filp)
+{
+	struct simtemp_mux *mux = filp->private_data;
+
+	seq_printf(m, "simtemp-format:\ttagged (%zu B)\n", sizeof(struct simtemp_tagged_sample));
+	seq_printf(m, "simtemp-watermark:\t%u\n", READ_ONCE(mux->watermark));
+	seq_printf(m, "simtemp-subscriptions:\t%u\n", READ_ONCE(mux->nr_subs));
+	seq_printf(m, "simtemp-attached:\t%d\n", atomic_read(&mux->live));
+	seq_printf(m, "simtemp-lag:\t%u\n", READ_ONCE(mux->head) - READ_ONCE(mux->tail));
+	seq_printf(m, "simtemp-delivered:\t%llu\n", mux->delivered);
+	seq_printf(m, "simtemp-dropped:\t%llu\n", mux->dropped);
+	seq_printf(m, "simtemp-samples-read:\t%llu\n", mux->samples_read);
+	seq_printf(m, "simtemp-reads:\t%llu\n", mux->read_count);
+	seq_printf(m, "simtemp-polls:\t%llu\n", mux->poll_count);
+}
+
+static const struct file_operations simtemp_mux_fops = {
+	.owner		= THIS_MODULE,
+	.open		= simtemp_mux_open,
+	.release	= simtemp_mux_release,
+	.read		= simtemp_mux_read,
+	.poll		= simtemp_mux_poll,
+	.unlocked_ioctl	= simtemp_mux_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
+	.show_fdinfo	= simtemp_mux_show_fdinfo,
+	.llseek		= noop_llseek,
+};
+
+static struct miscdevice simtemp_mux_miscdev = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "simtemp-all",
+	.fops	= &simtemp_mux_fops,
+	.mode	= 0666,
+};
+
+/*
+ * Register /dev/simtemp-all (module init)
+ */
+int simtemp_mux_init(void)
+{
+	return misc_register(&simtemp_mux_miscdev);
+}
+
+/*
+ * Unregister /dev/simtemp-all (module exit)
+ * Open files keep the module pinned, so none are left here.
+ */
+void simtemp_mux_exit(void)
+{
+	misc_deregister(&simtemp_mux_miscdev);
+}
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Closed-loop thermal plant and actuator input
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * In "plant" mode the generated temperature follows a first-order thermal
+ * model driven by an actuator: a heat load and a cooling (fan) command.
+ * Fan and throttling controllers can then be validated against the
+ * driver, closing the loop at the sampling rate.
+ *
+ * The commands live in one struct simtemp_control page per instance.
+ * User space writes it directly through a shared mapping (no syscall per
+ * update), with SIMTEMP_IOC_SET_ACTUATOR, or through an optional thermal
+ * cooling device; the sampling tick reads it with plain loads and
+ * reports which command sequence it consumed.
+ */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/math64.h>
+#include <linux/thermal.h>
+#include <linux/timekeeping.h>
+
+#include "nxp_simtemp.h"
+
+/*
+ * Get the actuator page, allocating it on first use
+ * Returns the page or NULL on allocation failure
+ */
+static struct simtemp_control *simtemp_control_get(struct simtemp_device *dev)
+{
+	struct simtemp_control *ctrl;
+
+	mutex_lock(&dev->config_lock);
+
+	ctrl = dev->ctrl;
+	if (!ctrl) {
+		/* Zeroed and flagged for remap_vmalloc_range() */
+		ctrl = vmalloc_user(PAGE_SIZE);
+		if (ctrl) {
+			ctrl->magic = SIMTEMP_CTRL_MAGIC;
+			ctrl->version = SIMTEMP_CTRL_VERSION;
+
+			/* Initialized page before the pointer, for the timer */
+			smp_store_release(&dev->ctrl, ctrl);
+		}
+	}
+
+	mutex_unlock(&dev->config_lock);
+	return ctrl;
+}
+
+/*
+ * Advance the plant by one sampling period
+ * Called from the timer callback in "plant" mode.
+ *
+ * The steady state is ambient + heat * R, with the fan dividing R by up
+ * to 1 + PLANT_FAN_GAIN; the temperature approaches it with time constant
+ * PLANT_TAU_MS. State is kept in micro-Celsius so 1 ms ticks still move.
+ *
+ * Returns the new temperature in milli-Celsius.
+ */
+s32 simtemp_plant_step(struct simtemp_device *dev)
+{
+	struct simtemp_control *ctrl = smp_load_acquire(&dev->ctrl);
+	s64 heat_mW = 0, target_uC;
+	u32 cooling = 0, seq;
+	s64 dt = dev->sampling_ms;
+
+	if (ctrl) {
+		/* Commands are written before seq is bumped */
+		seq = READ_ONCE(ctrl->seq);
+		smp_rmb();
+		heat_mW = clamp_t(s32, READ_ONCE(ctrl->heat_mW),
+				  -SIMTEMP_HEAT_MW_MAX, SIMTEMP_HEAT_MW_MAX);
+		cooling = min_t(u32, READ_ONCE(ctrl->cooling), SIMTEMP_COOLING_MAX);
+
+		WRITE_ONCE(ctrl->applied_ns, ktime_get_ns());
+		smp_store_release(&ctrl->applied_seq, seq);
+	}
+
+	target_uC = (s64)PLANT_AMBIENT_MC * 1000 +
+		    div_s64(heat_mW * PLANT_R_MC_PER_W * SIMTEMP_COOLING_MAX,
+			    SIMTEMP_COOLING_MAX + PLANT_FAN_GAIN * cooling);
+
+	dev->plant_uC += div_s64((target_uC - dev->plant_uC) * dt, PLANT_TAU_MS + dt);
+	dev->plant_uC = clamp_t(s64, dev->plant_uC,
+				(s64)SIMTEMP_THRESHOLD_MC_MIN * 1000,
+				(s64)SIMTEMP_THRESHOLD_MC_MAX * 1000);
+
+	return div_s64(dev->plant_uC, 1000);
+}
+
+/*
+ * Store actuator commands and bump the sequence number
+ */
+static int simtemp_actuator_set(struct simtemp_device *dev, s32 heat_mW, u32 cooling)
+{
+	struct simtemp_control *ctrl;
+
+	if (heat_mW < -SIMTEMP_HEAT_MW_MAX || heat_mW > SIMTEMP_HEAT_MW_MAX ||
+	    cooling > SIMTEMP_COOLING_MAX)
+		return -EINVAL;
+
+	ctrl = simtemp_control_get(dev);
+	if (!ctrl)
+		return -ENOMEM;
+
+	WRITE_ONCE(ctrl->heat_mW, heat_mW);
+	WRITE_ONCE(ctrl->cooling, cooling);
+	smp_wmb();
+	WRITE_ONCE(ctrl->seq, READ_ONCE(ctrl->seq) + 1);
+
+	return 0;
+}
+
+/*
+ * SIMTEMP_IOC_SET_ACTUATOR
+ */
+long simtemp_actuator_ioctl(struct simtemp_device *dev, struct simtemp_actuator __user *uact)
+{
+	struct simtemp_actuator act;
+
+	if (copy_from_user(&act, uact, sizeof(act)))
+		return -EFAULT;
+
+	return simtemp_actuator_set(dev, act.heat_mW, act.cooling);
+}
+
+/*
+ * mmap() of the actuator page (offset SIMTEMP_CTRL_MMAP_OFFSET)
+ * One shared page, writable; it stays valid after remove since the
+ * mapping holds its own page reference.
+ */
+int simtemp_control_mmap(struct simtemp_device *dev, struct vm_area_struct *vma)
+{
+	struct simtemp_control *ctrl;
+
+	if (vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	/* A private copy would never reach the driver */
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	ctrl = simtemp_control_get(dev);
+	if (!ctrl)
+		return -ENOMEM;
+
+	return remap_vmalloc_range(vma, ctrl, 0);
+}
+
+/*
+ * Thermal cooling device: states 0..PLANT_COOLING_STATES map linearly onto
+ * the cooling command
+ */
+static int simtemp_cdev_get_max_state(struct thermal_cooling_device *cdev,
+				      unsigned long *state)
+{
+	*state = PLANT_COOLING_STATES;
+	return 0;
+}
+
+static int simtemp_cdev_get_cur_state(struct thermal_cooling_device *cdev,
+				      unsigned long *state)
+{
+	struct simtemp_device *dev = cdev->devdata;
+	struct simtemp_control *ctrl = smp_load_acquire(&dev->ctrl);
+	u32 cooling = ctrl ? min_t(u32, READ_ONCE(ctrl->cooling), SIMTEMP_COOLING_MAX) : 0;
+
+	*state = DIV_ROUND_CLOSEST(cooling * PLANT_COOLING_STATES, SIMTEMP_COOLING_MAX);
+	return 0;
+}
+
+static int simtemp_cdev_set_cur_state(struct thermal_cooling_device *cdev,
+				      unsigned long state)
+{
+	struct simtemp_device *dev = cdev->devdata;
+	struct simtemp_control *ctrl = smp_load_acquire(&dev->ctrl);
+	s32 heat_mW = ctrl ? READ_ONCE(ctrl->heat_mW) : 0;
+
+	if (state > PLANT_COOLING_STATES)
+		return -EINVAL;
+
+	return simtemp_actuator_set(dev, heat_mW,
+				    state * SIMTEMP_COOLING_MAX / PLANT_COOLING_STATES);
+}
+
+static const struct thermal_cooling_device_ops simtemp_cdev_ops = {
+	.get_max_state	= simtemp_cdev_get_max_state,
+	.get_cur_state	= simtemp_cdev_get_cur_state,
+	.set_cur_state	= simtemp_cdev_set_cur_state,
+};
+
+/*
+ * Per-instance plant setup (probe)
+ * The cooling device is optional: failing to register it (or a kernel
+ * without CONFIG_THERMAL) leaves the other actuator paths working.
+ */
+void simtemp_plant_init(struct simtemp_device *dev, bool cooling_device)
+{
+	struct thermal_cooling_device *cdev;
+
+	dev->plant_uC = (s64)PLANT_AMBIENT_MC * 1000;
+
+	if (!cooling_device)
+		return;
+
+	cdev = thermal_cooling_device_register(dev->name, dev, &simtemp_cdev_ops);
+	if (IS_ERR(cdev)) {
+		pr_warn("%s: %s: no thermal cooling device: %ld\n",
+			DRIVER_NAME, dev->name, PTR_ERR(cdev));
+		return;
+	}
+
+	dev->cdev = cdev;
+}
+
+/*
+ * Per-instance plant teardown (remove)
+ * Called after the timer is cancelled; existing mappings keep their page.
+ */
+void simtemp_plant_exit(struct simtemp_device *dev)
+{
+	if (dev->cdev) {
+		thermal_cooling_device_unregister(dev->cdev);
+		dev->cdev = NULL;
+	}
+
+	vfree(dev->ctrl);
+	dev->ctrl = NULL;
+}
@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Relay channel for high-volume sample capture
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * /dev/simtemp hands samples out one read() at a time through a reader
+ * cursor. Long captures at high rates can instead use the kernel's relay
+ * transport, which existing relay capture tools consume by mmap() or
+ * read() of per-CPU files:
+ *
+ *	/sys/kernel/debug/nxp_simtemp/<instance>/relay_enable	0 or 1
+ *	/sys/kernel/debug/nxp_simtemp/<instance>/relay<cpu>	channel buffers
+ *
+ * The channel is created on the first enable (relay_subbufs sub-buffers
+ * of relay_subbuf_size bytes per CPU) and kept until the instance goes
+ * away. While enabled it is a listener of the instance, so the instance
+ * keeps sampling, and every published sample is appended to the channel
+ * buffer of the CPU running the flush (the sampling timer's, or a
+ * writer's). Every sub-buffer starts with a struct simtemp_relay_subbuf
+ * written by the sub-buffer switch callback, which carries the CPU's
+ * drop count: the channel does not overwrite, a sample arriving while
+ * every sub-buffer is still unconsumed is lost and counted.
+ */
+
+#include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/relay.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include "nxp_simtemp.h"
+
+/* Sub-buffer switch state of one CPU's channel buffer */
+struct simtemp_relay_cpu {
+	u64 sequence;			/* Sub-buffers started */
+	u64 dropped;			/* Samples lost to a full buffer */
+};
+
+struct simtemp_relay {
+	struct simtemp_listener listener;
+	struct simtemp_device *dev;
+
+	struct dentry *dir;		/* nxp_simtemp/<instance>/ */
+	struct dentry *control;		/* relay_enable */
+
+	/* Channel and enable state, under lock */
+	struct mutex lock;
+	struct rchan *chan;
+	bool enabled;
+	size_t n_subbufs;
+	size_t subbuf_size;
+
+	/* Only touched by the channel callbacks of the CPU's buffer */
+	struct simtemp_relay_cpu __percpu *cpu;
+};
+
+/*
+ * Listener callback (under ringbuf.lock, interrupts disabled)
+ */
+static void simtemp_relay_deliver(struct simtemp_listener *listener,
+				  const struct simtemp_sample *sample)
+{
+	struct simtemp_relay *relay = container_of(listener, struct simtemp_relay, listener);
+
+	__relay_write(relay->chan, sample, sizeof(*sample));
+}
+
+/*
+ * Sub-buffer switch: finish the previous sub-buffer's header and start
+ * the new one, or refuse (and count the sample) while the buffer is full
+ */
+static int simtemp_relay_subbuf_start(struct rchan_buf *buf, void *subbuf,
+				      void *prev_subbuf, size_t prev_padding)
+{
+	struct simtemp_relay *relay = buf->chan->private_data;
+	struct simtemp_relay_cpu *rc = per_cpu_ptr(relay->cpu, buf->cpu);
+	struct simtemp_relay_subbuf *hdr;
+
+	if (prev_subbuf) {
+		hdr = prev_subbuf;
+		hdr->padding = prev_padding;
+	}
+
+	if (relay_buf_full(buf)) {
+		rc->dropped++;
+		return 0;
+	}
+
+	hdr = subbuf;
+	hdr->magic = SIMTEMP_RELAY_MAGIC;
+	hdr->cpu = buf->cpu;
+	hdr->sequence = rc->sequence++;
+	hdr->dropped = rc->dropped;
+	hdr->padding = 0;
+	hdr->record_size = sizeof(struct simtemp_sample);
+	subbuf_start_reserve(buf, sizeof(*hdr));
+
+	return 1;
+}
+
+static struct dentry *simtemp_relay_create_buf_file(const char *filename,
+						    struct dentry *parent,
+						    umode_t mode,
+						    struct rchan_buf *buf,
+						    int *is_global)
+{
+	return debugfs_create_file(filename, mode, parent, buf, &relay_file_operations);
+}
+
+static int simtemp_relay_remove_buf_file(struct dentry *dentry)
+{
+	debugfs_remove(dentry);
+	return 0;
+}
+
+static const struct rchan_callbacks simtemp_relay_callbacks = {
+	.subbuf_start		= simtemp_relay_subbuf_start,
+	.create_buf_file	= simtemp_relay_create_buf_file,
+	.remove_buf_file	= simtemp_relay_remove_buf_file,
+};
+
+/*
+ * Start feeding the channel, creating it on first use
+ * Caller holds relay->lock.
+ */
+static int simtemp_relay_enable(struct simtemp_relay *relay)
+{
+	int ret;
+
+	if (relay->enabled)
+		return 0;
+
+	if (!relay->chan) {
+		relay->chan = relay_open("relay", relay->dir, relay->subbuf_size,
+					 relay->n_subbufs, &simtemp_relay_callbacks, relay);
+		if (!relay->chan)
+			return -ENOMEM;
+	}
+
+	ret = simtemp_listener_attach(relay->dev->id, &relay->listener);
+	if (ret)
+		return ret;
+
+	relay->enabled = true;
+	return 0;
+}
+
+/*
+ * Stop feeding the channel and make partly filled sub-buffers readable
+ * Caller holds relay->lock.
+ */
+static void simtemp_relay_disable(struct simtemp_relay *relay)
+{
+	if (!relay->enabled)
+		return;
+
+	/* The channel has no writer once a grace period passed */
+	simtemp_listener_detach(&relay->listener);
+	synchronize_rcu();
+
+	relay_flush(relay->chan);
+	relay->enabled = false;
+}
+
+/*
+ * debugfs 'relay_enable'
+ */
+static ssize_t simtemp_relay_enable_read(struct file *filp, char __user *buf,
+					 size_t count, loff_t *f_pos)
+{
+	struct simtemp_relay *relay = filp->private_data;
+	char kbuf[4];
+	int len;
+
+	len = scnprintf(kbuf, sizeof(kbuf), "%d\n", READ_ONCE(relay->enabled));
+	return simple_read_from_buffer(buf, count, f_pos, kbuf, len);
+}
+
+static ssize_t simtemp_relay_enable_write(struct file *filp, const char __user *buf,
+					  size_t count, loff_t *f_pos)
+{
+	struct simtemp_relay *relay = filp->private_data;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&relay->lock);
+	if (enable)
+		ret = simtemp_relay_enable(relay);
+	else
+		simtemp_relay_disable(relay);
+	mutex_unlock(&relay->lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations simtemp_relay_enable_fops = {
+	.owner		= THIS_MODULE,
+	.open		= simple_open,
+	.read		= simtemp_relay_enable_read,
+	.write		= simtemp_relay_enable_write,
+	.llseek		= default_llseek,
+};
+
+/*
+ * Create the instance's debugfs directory and relay control file
+ * Like the rest of debugfs this is optional: failures leave the instance
+ * without a relay channel. @n_subbufs == 0 disables it.
+ */
+void simtemp_relay_init(struct simtemp_device *dev, unsigned int n_subbufs,
+			unsigned int subbuf_size)
+{
+	struct simtemp_relay *relay;
+
+	if (!n_subbufs || IS_ERR_OR_NULL(simtemp_debugfs_dir))
+		return;
+
+	relay = kzalloc(sizeof(*relay), GFP_KERNEL);
+	if (!relay)
+		return;
+
+	relay->cpu = alloc_percpu(struct simtemp_relay_cpu);
+	if (!relay->cpu) {
+		kfree(relay);
+		return;
+	}
+
+	relay->dev = dev;
+	relay->listener.deliver = simtemp_relay_deliver;
+	mutex_init(&relay->lock);
+	relay->n_subbufs = min_t(unsigned int, n_subbufs, RELAY_SUBBUFS_MAX);
+	relay->subbuf_size = clamp_t(size_t, subbuf_size,
+				     sizeof(struct simtemp_relay_subbuf) + sizeof(struct simtemp_sample),
+				     RELAY_SUBBUF_SIZE_MAX);
+
+	relay->dir = debugfs_create_dir(dev->name, simtemp_debugfs_dir);
+	relay->control = debugfs_create_file("relay_enable", 0600, relay->dir, relay,
+					     &simtemp_relay_enable_fops);
+
+	dev->relay = relay;
+}
+
+/*
+ * Tear the channel down
+ * Called from remove after simtemp_listeners_release(), so the channel
+ * has no writer left.
+ */
+void simtemp_relay_exit(struct simtemp_device *dev)
+{
+	struct simtemp_relay *relay = dev->relay;
+
+	if (!relay)
+		return;
+
+	/* Waits for a relay_enable write in progress */
+	debugfs_remove(relay->control);
+
+	if (relay->chan)
+		relay_close(relay->chan);
+	debugfs_remove_recursive(relay->dir);
+
+	free_percpu(relay->cpu);
+	kfree(relay);
+	dev->relay = NULL;
+}
@@ -0,0 +1,583 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Sample ring buffer and per-CPU staging rings
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * The ring buffer is a single-writer overwrite ring. Records are addressed
+ * by a free-running 32-bit sequence number; record seq lives at index
+ * (seq & mask). Every reader keeps its own cursor, so readers never steal
+ * samples from each other and a slow reader only loses its own data.
+ *
+ * The ring lives in vmalloc_user() memory: one header page followed by the
+ * records. The whole allocation can be mapped read-only into user space,
+ * where the header's head field is the publication point.
+ *
+ * With a payload configured every record is a frame: the sample followed
+ * by payload_bytes of data generated in place when the sample is
+ * published. Staging rings still only carry the 16-byte samples, and a
+ * flush generates at most FLUSH_PAYLOAD_MAX of payload (FLUSH_SAMPLES_MAX
+ * records without a payload).
+ *
+ * Ring and staging rings are only allocated while an instance has users
+ * (struct simtemp_buffers); see simtemp_buffers_get() for the lifetime.
+ * They are freed when the last reference (device, file or mapping) is
+ * dropped.
+ */
+
+#include <linux/kernel.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/cpumask.h>
+#include <linux/uio.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+
+#include "nxp_simtemp.h"
+
+/*
+ * Ring buffer operations
+ */
+
+/* Record of sequence number @seq */
+static inline void *simtemp_ringbuf_record(struct simtemp_ringbuf *rb, u32 seq)
+{
+	return rb->records + (size_t)(seq & rb->mask) * rb->record_size;
+}
+
+/*
+ * Generate a frame payload: 64-bit word i holds @ts + i
+ * Runs at memory bandwidth and lets a consumer check that a frame
+ * arrived whole (see SIMTEMP_PAYLOAD_MIN in the UAPI header).
+ */
+static void simtemp_payload_fill(u64 *words, unsigned int bytes, u64 ts)
+{
+	unsigned int i;
+
+	for (i = 0; i < bytes / sizeof(*words); i++)
+		words[i] = ts + i;
+}
+
+/*
+ * Allocate and initialize a ring buffer of @size records
+ * @size must be a power of 2; @payload_bytes is 0 for plain samples
+ * Returns 0 on success, -ENOMEM on allocation failure
+ */
+int simtemp_ringbuf_init(struct simtemp_ringbuf *rb, unsigned int size,
+			 unsigned int payload_bytes)
+{
+	if (!is_power_of_2(size))
+		return -EINVAL;
+
+	rb->record_size = sizeof(struct simtemp_sample) + payload_bytes;
+	rb->payload_bytes = payload_bytes;
+	rb->flush_max = payload_bytes ? max(FLUSH_PAYLOAD_MAX / payload_bytes, 1U) :
+					FLUSH_SAMPLES_MAX;
+	rb->bytes = PAGE_SIZE + PAGE_ALIGN((size_t)size * rb->record_size);
+
+	/* Zeroed and flagged for remap_vmalloc_range() */
+	rb->hdr = vmalloc_user(rb->bytes);
+	if (!rb->hdr)
+		return -ENOMEM;
+
+	rb->records = (char *)rb->hdr + PAGE_SIZE;
+	rb->size = size;
+	rb->mask = size - 1;
+	spin_lock_init(&rb->lock);
+
+	rb->hdr->magic = SIMTEMP_RING_MAGIC;
+	rb->hdr->version = SIMTEMP_RING_VERSION;
+	rb->hdr->record_size = rb->record_size;
+	rb->hdr->data_offset = PAGE_SIZE;
+	rb->hdr->size = size;
+	rb->hdr->head = 0;
+
+	return 0;
+}
+
+/*
+ * Release ring buffer memory
+ */
+void simtemp_ringbuf_free(struct simtemp_ringbuf *rb)
+{
+	vfree(rb->hdr);
+	rb->hdr = NULL;
+	rb->records = NULL;
+}
+
+/*
+ * Number of records a reader at @cursor has not consumed yet
+ * Lockless; may exceed the ring size when the reader was overrun
+ */
+u32 simtemp_ringbuf_pending(struct simtemp_ringbuf *rb, u32 cursor)
+{
+	return smp_load_acquire(&rb->hdr->head) - cursor;
+}
+
+/*
+ * Append a record, overwriting the oldest one when the ring is full
+ * Caller holds rb->lock
+ */
+void simtemp_ringbuf_put(struct simtemp_ringbuf *rb, const struct simtemp_sample *sample)
+{
+	u32 head = rb->hdr->head;
+	struct simtemp_sample *rec = simtemp_ringbuf_record(rb, head);
+
+	/* Copy sample to buffer, then its payload in frame mode */
+	memcpy(rec, sample, sizeof(*sample));
+	if (rb->payload_bytes)
+		simtemp_payload_fill((u64 *)(rec + 1), rb->payload_bytes, sample->timestamp_ns);
+
+	/* Ensure sample is written before publishing the new head */
+	smp_store_release(&rb->hdr->head, head + 1);
+}
+
+/*
+ * Copy up to @max samples starting at *@cursor into @batch
+ * Caller holds rb->lock. In frame mode only the samples are copied.
+ *
+ * A cursor that fell more than one ring behind is moved to the oldest
+ * record still present, and the number of skipped records is added to
+ * *@dropped. *@cursor is advanced past the copied records.
+ *
+ * Returns the number of records copied.
+ */
+unsigned int simtemp_ringbuf_read(struct simtemp_ringbuf *rb, u32 *cursor,
+				  struct simtemp_sample *batch, unsigned int max,
+				  u64 *dropped)
+{
+	u32 head = rb->hdr->head;
+	u32 pos = *cursor;
+	unsigned int n = 0;
+
+	if (head - pos > rb->size) {
+		*dropped += head - pos - rb->size;
+		pos = head - rb->size;
+	}
+
+	while (n < max && pos != head) {
+		memcpy(&batch[n], simtemp_ringbuf_record(rb, pos), sizeof(*batch));
+		pos++;
+		n++;
+	}
+
+	*cursor = pos;
+	return n;
+}
+
+/*
+ * Copy up to @max whole frames starting at *@cursor to @to
+ * Lockless; the caller serializes users of @cursor.
+ *
+ * Frames are too large to bounce through a stack batch under rb->lock,
+ * so they go straight from the ring to @to and are validated afterwards,
+ * the same way an mmap reader does: frames the writer may have reached
+ * during the copy are reverted, counted in *@dropped, and the copy is
+ * redone from the oldest valid one. Copying at most a quarter ring at a
+ * time means the writer has to lap three quarters of the ring for that
+ * to happen; after FRAME_READ_RETRIES such laps the read gives up.
+ *
+ * *@newest_ns is set to the timestamp of the last frame copied.
+ *
+ * Returns the number of frames copied, or -EFAULT if none could be.
+ */
+int simtemp_ringbuf_read_frames(struct simtemp_ringbuf *rb, u32 *cursor,
+				struct iov_iter *to, unsigned int max,
+				u64 *dropped, u64 *newest_ns)
+{
+	size_t rsize = rb->record_size;
+	unsigned int chunk = max_t(unsigned int, rb->size / 4, 1);
+	unsigned int done = 0, retries = 0, n, first, torn;
+	bool fault = false;
+	u32 head, pos = *cursor;
+	size_t want, copied;
+	u64 ts;
+
+	while (done < max) {
+		head = smp_load_acquire(&rb->hdr->head);
+		if (head - pos > rb->size) {
+			*dropped += head - pos - rb->size;
+			pos = head - rb->size;
+		}
+
+		n = min3(head - pos, max - done, chunk);
+		if (!n)
+			break;
+
+		/* Up to two contiguous spans, split where the ring wraps */
+		first = min(n, rb->size - (pos & rb->mask));
+		want = (size_t)n * rsize;
+		copied = copy_to_iter(simtemp_ringbuf_record(rb, pos), first * rsize, to);
+		if (copied == first * rsize && n > first)
+			copied += copy_to_iter(rb->records, (n - first) * rsize, to);
+
+		if (copied != want) {
+			/* Fault: keep the frames that made it whole */
+			iov_iter_revert(to, copied % rsize);
+			n = copied / rsize;
+			fault = true;
+		}
+
+		ts = n ? READ_ONCE(((struct simtemp_sample *)
+				    simtemp_ringbuf_record(rb, pos + n - 1))->timestamp_ns) : 0;
+
+		/* Frames the writer may have started to overwrite meanwhile */
+		smp_rmb();
+		head = READ_ONCE(rb->hdr->head);
+		torn = head - pos >= rb->size ? min(n, head - pos - rb->size + 1) : 0;
+		if (torn) {
+			iov_iter_revert(to, (size_t)n * rsize);
+			*dropped += torn;
+			pos += torn;
+			if (fault || ++retries == FRAME_READ_RETRIES)
+				break;
+			continue;
+		}
+
+		if (n) {
+			pos += n;
+			done += n;
+			*newest_ns = ts;
+		}
+		if (fault)
+			break;
+	}
+
+	*cursor = pos;
+	return done || !fault ? done : -EFAULT;
+}
+
+/*
+ * Lockless copy of the newest record's sample
+ * For callers that cannot take rb->lock (BPF programs run in any
+ * context): the copy is validated like in simtemp_ringbuf_read_frames().
+ *
+ * Returns 0, -ENODATA if nothing was written yet, or -EAGAIN if the
+ * writer kept overwriting the record.
+ */
+int simtemp_ringbuf_peek(struct simtemp_ringbuf *rb, struct simtemp_sample *sample)
+{
+	unsigned int retries;
+	u32 head;
+
+	for (retries = 0; retries < FRAME_READ_RETRIES; retries++) {
+		head = smp_load_acquire(&rb->hdr->head);
+		if (!head)
+			return -ENODATA;
+
+		memcpy(sample, simtemp_ringbuf_record(rb, head - 1), sizeof(*sample));
+
+		smp_rmb();
+		if (READ_ONCE(rb->hdr->head) - (head - 1) < rb->size)
+			return 0;
+	}
+
+	return -EAGAIN;
+}
+
+/*
+ * Lockless min/max/mean of the @window newest records
+ * Same validation as simtemp_ringbuf_peek(); @window is capped to half
+ * the ring so the writer has to lap the other half to tear it.
+ *
+ * Returns the number of samples aggregated, -ENODATA or -EAGAIN.
+ */
+int simtemp_ringbuf_aggregate(struct simtemp_ringbuf *rb, unsigned int window,
+			      struct simtemp_aggregate *agg)
+{
+	struct simtemp_sample sample;
+	unsigned int retries, n, i;
+	u32 head, pos;
+	s64 sum;
+
+	window = clamp(window, 1U, rb->size / 2);
+
+	for (retries = 0; retries < FRAME_READ_RETRIES; retries++) {
+		head = smp_load_acquire(&rb->hdr->head);
+		n = min(head, window);
+		if (!n)
+			return -ENODATA;
+
+		pos = head - n;
+		sum = 0;
+		for (i = 0; i < n; i++) {
+			memcpy(&sample, simtemp_ringbuf_record(rb, pos + i), sizeof(sample));
+			if (!i) {
+				agg->first_ns = sample.timestamp_ns;
+				agg->min_mC = agg->max_mC = sample.temp_mC;
+			}
+			agg->min_mC = min(agg->min_mC, sample.temp_mC);
+			agg->max_mC = max(agg->max_mC, sample.temp_mC);
+			sum += sample.temp_mC;
+		}
+		agg->last_ns = sample.timestamp_ns;
+		agg->count = n;
+		agg->mean_mC = div_s64(sum, n);
+
+		smp_rmb();
+		if (READ_ONCE(rb->hdr->head) - pos < rb->size)
+			return n;
+	}
+
+	return -EAGAIN;
+}
+
+/*
+ * Per-CPU staging operations
+ */
+
+/*
+ * Append samples to this CPU's staging ring
+ *
+ * Lock-free: head is only written by the owning CPU, and local interrupts
+ * are disabled so the sampling timer cannot interleave with a write() on
+ * the same CPU. head/tail are free-running; samples that do not fit are
+ * dropped and their number is stored in *@dropped.
+ *
+ * Returns the number of samples now pending on this CPU.
+ */
+unsigned int simtemp_stage(struct simtemp_buffers *bufs,
+			   const struct simtemp_sample *samples, unsigned int n,
+			   unsigned int *dropped)
+{
+	struct simtemp_staging *st;
+	unsigned long flags;
+	unsigned int head, tail, i;
+
+	local_irq_save(flags);
+	st = this_cpu_ptr(bufs->staging);
+
+	head = st->head;
+	tail = smp_load_acquire(&st->tail);
+
+	for (i = 0; i < n; i++) {
+		if (head - tail >= STAGING_SIZE)
+			break;
+		memcpy(&st->buffer[head & STAGING_MASK], &samples[i], sizeof(*samples));
+		head++;
+	}
+
+	/* Ensure samples are written before publishing the new head */
+	smp_store_release(&st->head, head);
+	local_irq_restore(flags);
+
+	*dropped = n - i;
+	return head - tail;
+}
+
+/*
+ * Hand one merged sample to every listener of the instance
+ * Caller holds ringbuf.lock, so listeners see samples in ring order.
+ */
+static void simtemp_publish(struct simtemp_device *dev, const struct simtemp_sample *sample)
+{
+	struct simtemp_listener *listener;
+
+	list_for_each_entry_rcu(listener, &dev->listeners, node)
+		listener->deliver(listener, sample);
+}
+
+/*
+ * Tell listeners that a flush delivered everything it had
+ * Caller holds ringbuf.lock, like for simtemp_publish().
+ */
+static void simtemp_publish_done(struct simtemp_device *dev)
+{
+	struct simtemp_listener *listener;
+
+	list_for_each_entry_rcu(listener, &dev->listeners, node)
+		if (listener->flushed)
+			listener->flushed(listener);
+}
+
+/*
+ * Merge all per-CPU staging rings into the ring buffer
+ *
+ * Every staging ring is ordered on its own, so this is a k-way merge that
+ * repeatedly moves the oldest head-of-queue sample across CPUs. Runs under
+ * ringbuf.lock, which makes it the single consumer of every staging ring
+ * and the single writer of the ring buffer.
+ *
+ * This is the single publish point: every sample that reaches the ring is
+ * also handed to the instance's listeners here.
+ *
+ * Only what was staged on entry is merged, and only from the CPUs that
+ * had something staged, so writers on other CPUs cannot keep a flush
+ * going and each merged sample costs a scan of those CPUs alone. At most
+ * ringbuf.flush_max records are moved (FLUSH_SAMPLES_MAX, or as many
+ * frames as fit in FLUSH_PAYLOAD_MAX), which bounds the time spent with
+ * interrupts off; the rest waits in staging for the next flush.
+ *
+ * Returns the number of samples moved into the ring buffer.
+ */
+unsigned int simtemp_flush(struct simtemp_device *dev, struct simtemp_buffers *bufs)
+{
+	struct simtemp_staging *st, *oldest;
+	struct simtemp_sample *sample;
+	unsigned long flags;
+	unsigned int moved = 0;
+	bool listeners;
+	int cpu, oldest_cpu = 0;
+
+	spin_lock_irqsave(&bufs->ringbuf.lock, flags);
+	rcu_read_lock();
+	listeners = !list_empty(&dev->listeners);
+
+	/* Snapshot every staging head; later samples wait for the next flush */
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(bufs->staging, cpu);
+		st->limit = smp_load_acquire(&st->head);
+		if (st->limit != st->tail)
+			cpumask_set_cpu(cpu, bufs->flush_cpus);
+		else
+			cpumask_clear_cpu(cpu, bufs->flush_cpus);
+	}
+
+	while (moved < bufs->ringbuf.flush_max) {
+		oldest = NULL;
+		for_each_cpu(cpu, bufs->flush_cpus) {
+			st = per_cpu_ptr(bufs->staging, cpu);
+			if (!oldest ||
+			    st->buffer[st->tail & STAGING_MASK].timestamp_ns <
+			    oldest->buffer[oldest->tail & STAGING_MASK].timestamp_ns) {
+				oldest = st;
+				oldest_cpu = cpu;
+			}
+		}
+
+		if (!oldest)
+			break;
+
+		sample = &oldest->buffer[oldest->tail & STAGING_MASK];
+		simtemp_ringbuf_put(&bufs->ringbuf, sample);
+		if (listeners)
+			simtemp_publish(dev, sample);
+
+		/* Sample is copied out, hand the slot back to the producer */
+		smp_store_release(&oldest->tail, oldest->tail + 1);
+		if (oldest->tail == oldest->limit)
+			cpumask_clear_cpu(oldest_cpu, bufs->flush_cpus);
+		moved++;
+	}
+
+	if (listeners && moved)
+		simtemp_publish_done(dev);
+
+	rcu_read_unlock();
+	spin_unlock_irqrestore(&bufs->ringbuf.lock, flags);
+
+	return moved;
+}
+
+/*
+ * Merge staging until it is empty, from process context
+ * Takes ringbuf.lock once per bounded simtemp_flush() and may sleep in
+ * between. Stops after as many samples as staging can hold, so writers
+ * staging concurrently cannot keep it going. Returns the number of
+ * samples moved into the ring buffer.
+ */
+unsigned int simtemp_flush_all(struct simtemp_device *dev, struct simtemp_buffers *bufs)
+{
+	unsigned int budget = num_possible_cpus() * STAGING_SIZE;
+	unsigned int moved, total = 0;
+
+	do {
+		moved = simtemp_flush(dev, bufs);
+		total += moved;
+		cond_resched();
+	} while (moved == bufs->ringbuf.flush_max && total < budget);
+
+	return total;
+}
+
+/*
+ * Sample buffer allocation
+ */
+
+/*
+ * Allocate the ring buffer (@ring_size records, power of 2) and zeroed
+ * per-CPU staging rings
+ * With @payload_bytes, the ring holds fewer records if needed to stay
+ * within RING_BYTES_MAX (but at least RING_FRAMES_MIN).
+ * Returns the buffers or an ERR_PTR()
+ */
+struct simtemp_buffers *simtemp_buffers_alloc(unsigned int ring_size,
+					      unsigned int payload_bytes)
+{
+	size_t record_size = sizeof(struct simtemp_sample) + payload_bytes;
+	struct simtemp_buffers *bufs;
+	int ret;
+
+	while (ring_size > RING_FRAMES_MIN && ring_size * record_size > RING_BYTES_MAX)
+		ring_size >>= 1;
+
+	bufs = kzalloc(sizeof(*bufs), GFP_KERNEL);
+	if (!bufs)
+		return ERR_PTR(-ENOMEM);
+
+	ret = simtemp_ringbuf_init(&bufs->ringbuf, ring_size, payload_bytes);
+	if (ret)
+		goto err_free;
+
+	bufs->staging = alloc_percpu(struct simtemp_staging);
+	if (!bufs->staging) {
+		ret = -ENOMEM;
+		goto err_ring;
+	}
+
+	if (!zalloc_cpumask_var(&bufs->flush_cpus, GFP_KERNEL)) {
+		ret = -ENOMEM;
+		goto err_staging;
+	}
+
+	init_waitqueue_head(&bufs->wait);
+
+	/* The caller's reference */
+	kref_init(&bufs->ref);
+
+	return bufs;
+
+err_staging:
+	free_percpu(bufs->staging);
+err_ring:
+	simtemp_ringbuf_free(&bufs->ringbuf);
+err_free:
+	kfree(bufs);
+	return ERR_PTR(ret);
+}
+
+/*
+ * Free sample buffers once the last reference is gone
+ * No producer or reader may use them any more
+ */
+static void simtemp_buffers_free(struct kref *ref)
+{
+	struct simtemp_buffers *bufs = container_of(ref, struct simtemp_buffers, ref);
+
+	free_cpumask_var(bufs->flush_cpus);
+	free_percpu(bufs->staging);
+	simtemp_ringbuf_free(&bufs->ringbuf);
+	kfree(bufs);
+}
+
+/*
+ * Drop a reference on sample buffers, freeing them with the last one
+ * Process context (vfree())
+ */
+void simtemp_buffers_unref(struct simtemp_buffers *bufs)
+{
+	kref_put(&bufs->ref, simtemp_buffers_free);
+}
+
+/*
+ * Memory held by sample buffers, in bytes
+ */
+size_t simtemp_buffers_bytes(struct simtemp_buffers *bufs)
+{
+	return sizeof(*bufs) + bufs->ringbuf.bytes +
+	       num_possible_cpus() * sizeof(struct simtemp_staging);
+}
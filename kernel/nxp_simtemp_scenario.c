@@ -0,0 +1,321 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Scripted multi-phase temperature scenarios
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * Benchmark profiles ("ramp to 80 C over 30 s, hold 60 s with noise, drop
+ * to 40 C, repeat") used to be driven by sysfs writes from a script, and
+ * every sampling_ms change restarted the timer and left a gap. Instead the
+ * whole profile is uploaded once with SIMTEMP_IOC_SET_SCENARIO as a list
+ * of struct simtemp_segment, and in "scenario" mode the sampling timer
+ * walks it on its own timeline.
+ *
+ * The timeline is the timer's expiry time, not the time the callback
+ * happens to run: the scenario starts at the first tick after it was
+ * loaded, segment N starts exactly at the sum of the durations before
+ * it, and simtemp_scenario_forward() programs a tick at every boundary
+ * (and switches to the segment's sampling period) by moving the expiry
+ * of the running timer rather than restarting it.
+ *
+ * The scenario is published with RCU and replaced as a whole; its
+ * position is only touched by the timer callback.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/overflow.h>
+#include <linux/uaccess.h>
+#include <linux/random.h>
+#include <linux/math64.h>
+#include <linux/hrtimer.h>
+#include <linux/sysfs.h>
+#include <linux/err.h>
+
+#include "nxp_simtemp.h"
+
+struct simtemp_scenario {
+	struct rcu_head rcu;
+	u32 count;
+	u32 loops;			/* 0 = forever */
+	u64 span_ns;			/* One pass through the segments */
+	bool restart;			/* Set under config_lock, consumed by the timer */
+
+	/* Position, timer only */
+	bool started;
+	bool done;			/* All passes completed */
+	u32 index;			/* Current segment */
+	u32 loop;			/* Passes completed */
+	u64 seg_start_ns;		/* Start of the current segment */
+	s32 from_mC;			/* End of the previous segment */
+
+	struct simtemp_segment segs[] __counted_by(count);
+};
+
+static inline u64 simtemp_segment_ns(const struct simtemp_segment *seg)
+{
+	return (u64)seg->duration_ms * NSEC_PER_MSEC;
+}
+
+/*
+ * Move the position up to @now, crossing every boundary in between
+ * Whole passes are skipped at once, so a long gap (a stopped timer, a
+ * restart long after loading) costs at most one pass of iterations.
+ */
+static void simtemp_scenario_advance(struct simtemp_scenario *sc, u64 now)
+{
+	const struct simtemp_segment *seg;
+	u64 passes;
+
+	while (!sc->done) {
+		if (!sc->index && now - sc->seg_start_ns >= sc->span_ns) {
+			passes = div64_u64(now - sc->seg_start_ns, sc->span_ns);
+			if (sc->loops)
+				passes = min_t(u64, passes, sc->loops - sc->loop);
+
+			sc->loop += passes;
+			sc->seg_start_ns += passes * sc->span_ns;
+			sc->from_mC = sc->segs[sc->count - 1].end_mC;
+			if (sc->loops && sc->loop == sc->loops) {
+				sc->done = true;
+				sc->index = sc->count - 1;
+				break;
+			}
+		}
+
+		seg = &sc->segs[sc->index];
+		if (now - sc->seg_start_ns < simtemp_segment_ns(seg))
+			break;
+
+		sc->from_mC = seg->end_mC;
+		sc->seg_start_ns += simtemp_segment_ns(seg);
+		if (++sc->index < sc->count)
+			continue;
+
+		sc->index = 0;
+		if (sc->loops && ++sc->loop == sc->loops) {
+			sc->done = true;
+			sc->index = sc->count - 1;
+		}
+	}
+}
+
+/*
+ * Temperature of the current tick
+ * Called from the timer callback in "scenario" mode.
+ */
+s32 simtemp_scenario_step(struct simtemp_device *dev)
+{
+	struct simtemp_scenario *sc;
+	const struct simtemp_segment *seg;
+	u64 now = ktime_to_ns(hrtimer_get_expires(&dev->timer));
+	s32 start_mC, temp_mC;
+	u32 random;
+
+	rcu_read_lock();
+
+	sc = rcu_dereference(dev->scenario);
+	if (!sc) {
+		temp_mC = dev->current_temp_mC;
+		goto out;
+	}
+
+	if (!sc->started || READ_ONCE(sc->restart)) {
+		WRITE_ONCE(sc->restart, false);
+		sc->started = true;
+		sc->done = false;
+		sc->index = 0;
+		sc->loop = 0;
+		sc->seg_start_ns = now;
+		sc->from_mC = dev->current_temp_mC;
+	}
+
+	simtemp_scenario_advance(sc, now);
+	seg = &sc->segs[sc->index];
+
+	if (sc->done) {
+		temp_mC = seg->end_mC;
+	} else {
+		/* Linear from the segment's start to its end, in microseconds */
+		start_mC = seg->flags & SIMTEMP_SEGMENT_FROM_PREV ? sc->from_mC : seg->start_mC;
+		temp_mC = start_mC +
+			  (s32)div64_s64((s64)(seg->end_mC - start_mC) *
+					 (s64)div_u64(now - sc->seg_start_ns, NSEC_PER_USEC),
+					 (s64)seg->duration_ms * USEC_PER_MSEC);
+	}
+
+	if (seg->noise_mC) {
+		get_random_bytes(&random, sizeof(random));
+		temp_mC += (s32)(random % (2 * seg->noise_mC + 1)) - (s32)seg->noise_mC;
+	}
+
+	dev->current_temp_mC = temp_mC;
+out:
+	rcu_read_unlock();
+	return temp_mC;
+}
+
+/*
+ * Program the timer's next tick in "scenario" mode
+ * One period of the current segment later, but never past its end, so
+ * the next segment starts with a tick of its own. Ticks that are already
+ * late are skipped like hrtimer_forward_now() does.
+ */
+void simtemp_scenario_forward(struct simtemp_device *dev, struct hrtimer *timer)
+{
+	struct simtemp_scenario *sc;
+	const struct simtemp_segment *seg;
+	ktime_t period = dev->sampling_period;
+	ktime_t next;
+	u64 boundary = 0;
+
+	rcu_read_lock();
+	sc = rcu_dereference(dev->scenario);
+	if (sc && sc->started && !sc->done) {
+		seg = &sc->segs[sc->index];
+		if (seg->sampling_ms)
+			period = ms_to_ktime(seg->sampling_ms);
+		boundary = sc->seg_start_ns + simtemp_segment_ns(seg);
+	}
+	rcu_read_unlock();
+
+	next = ktime_add(hrtimer_get_expires(timer), period);
+	if (boundary && ktime_to_ns(next) > boundary)
+		next = ns_to_ktime(boundary);
+
+	if (ktime_before(next, hrtimer_cb_get_time(timer)))
+		hrtimer_forward_now(timer, period);
+	else
+		hrtimer_set_expires(timer, next);
+}
+
+static int simtemp_segment_check(const struct simtemp_segment *seg)
+{
+	if (!seg->duration_ms || seg->duration_ms > SIMTEMP_SEGMENT_MS_MAX)
+		return -EINVAL;
+
+	if (seg->sampling_ms && (seg->sampling_ms < SIMTEMP_SAMPLING_MS_MIN ||
+				 seg->sampling_ms > SIMTEMP_SAMPLING_MS_MAX))
+		return -EINVAL;
+
+	if (seg->start_mC < SIMTEMP_THRESHOLD_MC_MIN || seg->start_mC > SIMTEMP_THRESHOLD_MC_MAX ||
+	    seg->end_mC < SIMTEMP_THRESHOLD_MC_MIN || seg->end_mC > SIMTEMP_THRESHOLD_MC_MAX)
+		return -EINVAL;
+
+	if (seg->noise_mC > SIMTEMP_SEGMENT_NOISE_MAX ||
+	    seg->flags & ~SIMTEMP_SEGMENT_FROM_PREV)
+		return -EINVAL;
+
+	return 0;
+}
+
+/*
+ * SIMTEMP_IOC_SET_SCENARIO: copy in and validate a new scenario
+ * The caller publishes it with simtemp_scenario_set().
+ * Returns the scenario or an ERR_PTR()
+ */
+struct simtemp_scenario *simtemp_scenario_load(struct simtemp_scenario_req __user *ureq)
+{
+	struct simtemp_scenario_req req;
+	struct simtemp_scenario *sc;
+	u32 i;
+	int ret;
+
+	if (copy_from_user(&req, ureq, sizeof(req)))
+		return ERR_PTR(-EFAULT);
+
+	if (req.flags || req.reserved)
+		return ERR_PTR(-EINVAL);
+
+	if (!req.count || req.count > SIMTEMP_SCENARIO_SEGMENTS_MAX)
+		return ERR_PTR(-EINVAL);
+
+	sc = kzalloc(struct_size(sc, segs, req.count), GFP_KERNEL);
+	if (!sc)
+		return ERR_PTR(-ENOMEM);
+
+	sc->count = req.count;
+	sc->loops = req.loops;
+
+	if (copy_from_user(sc->segs, u64_to_user_ptr(req.segments),
+			   array_size(req.count, sizeof(sc->segs[0])))) {
+		kfree(sc);
+		return ERR_PTR(-EFAULT);
+	}
+
+	for (i = 0; i < sc->count; i++) {
+		ret = simtemp_segment_check(&sc->segs[i]);
+		if (ret) {
+			kfree(sc);
+			return ERR_PTR(ret);
+		}
+		sc->span_ns += simtemp_segment_ns(&sc->segs[i]);
+	}
+
+	return sc;
+}
+
+/*
+ * Publish a scenario from simtemp_scenario_load()
+ * Called with config_lock held, together with the switch to "scenario"
+ * mode. The previous scenario is freed after a grace period.
+ */
+void simtemp_scenario_set(struct simtemp_device *dev, struct simtemp_scenario *sc)
+{
+	struct simtemp_scenario *old;
+
+	old = rcu_replace_pointer(dev->scenario, sc, lockdep_is_held(&dev->config_lock));
+	if (old)
+		kfree_rcu(old, rcu);
+
+	pr_info("%s: %s: scenario loaded (%u segments, %u loops)\n",
+		DRIVER_NAME, dev->name, sc->count, sc->loops);
+}
+
+/*
+ * Start the loaded scenario over at the next tick
+ * Called with config_lock held. Returns -ENOENT if none is loaded.
+ */
+int simtemp_scenario_restart(struct simtemp_device *dev)
+{
+	struct simtemp_scenario *sc;
+
+	sc = rcu_dereference_protected(dev->scenario, lockdep_is_held(&dev->config_lock));
+	if (!sc)
+		return -ENOENT;
+
+	WRITE_ONCE(sc->restart, true);
+	return 0;
+}
+
+/*
+ * sysfs 'scenario': position of the loaded scenario
+ */
+ssize_t simtemp_scenario_show(struct simtemp_device *dev, char *buf)
+{
+	struct simtemp_scenario *sc;
+	ssize_t len;
+
+	rcu_read_lock();
+	sc = rcu_dereference(dev->scenario);
+	if (!sc)
+		len = sysfs_emit(buf, "none\n");
+	else
+		len = sysfs_emit(buf, "segment=%u/%u loop=%u/%u %s\n",
+				 READ_ONCE(sc->index), sc->count, READ_ONCE(sc->loop), sc->loops,
+				 !READ_ONCE(sc->started) ? "pending" :
+				 READ_ONCE(sc->done) ? "done" : "running");
+	rcu_read_unlock();
+
+	return len;
+}
+
+/*
+ * Free the scenario on remove, after the timer was cancelled
+ */
+void simtemp_scenario_exit(struct simtemp_device *dev)
+{
+	kfree(rcu_dereference_protected(dev->scenario, true));
+	RCU_INIT_POINTER(dev->scenario, NULL);
+}
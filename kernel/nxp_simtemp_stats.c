@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Driver-wide statistics snapshot
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * Metrics agents scraping hundreds of instances should not need one
+ * open/read/close per 'stats' attribute. The counters of every instance
+ * are returned as packed struct simtemp_stats_record arrays, either from
+ * /sys/kernel/debug/nxp_simtemp/stats (one read()) or through
+ * SIMTEMP_IOC_GET_STATS on any instance.
+ *
+ * Snapshots walk simtemp_instances under its xa_lock, which keeps every
+ * listed instance (and its per-CPU counters) alive, and sum the per-CPU
+ * counters without taking any per-instance lock.
+ */
+
+#include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/xarray.h>
+#include <linux/overflow.h>
+#include <linux/build_bug.h>
+
+#include "nxp_simtemp.h"
+
+/* Driver-wide debugfs directory */
+struct dentry *simtemp_debugfs_dir;
+
+/*
+ * Fill @rec with the counters of @dev
+ * Lockless (the per-CPU counters are summed), so any context that keeps
+ * @dev alive may call it.
+ */
+void simtemp_stats_record(struct simtemp_device *dev, struct simtemp_stats_record *rec)
+{
+	struct simtemp_stats stats;
+
+	simtemp_stats_read(dev, &stats);
+
+	rec->instance = dev->id;
+	rec->flags = rcu_access_pointer(dev->bufs) ? SIMTEMP_STATS_ACTIVE : 0;
+	rec->total_samples = stats.total_samples;
+	rec->threshold_alerts = stats.threshold_alerts;
+	rec->read_count = stats.read_count;
+	rec->poll_count = stats.poll_count;
+	rec->reader_overruns = stats.reader_overruns;
+	rec->injected_samples = stats.injected_samples;
+	rec->staging_drops = stats.staging_drops;
+	rec->jittered_ticks = stats.jittered_ticks;
+	rec->bursts = stats.bursts;
+	rec->stalls = stats.stalls;
+	rec->held_samples = stats.held_samples;
+}
+
+/*
+ * Fill @records with the counters of up to @max instances
+ * *@total is set to the number of instances, which may be larger than
+ * @max (@records may be NULL to only count them).
+ *
+ * Returns the number of records written.
+ */
+static unsigned int simtemp_stats_snapshot(struct simtemp_stats_record *records,
+					   unsigned int max, unsigned int *total)
+{
+	struct simtemp_device *dev;
+	unsigned long index;
+	unsigned int n = 0;
+
+	*total = 0;
+
+	/* Instances leave the xarray before their counters are freed */
+	xa_lock(&simtemp_instances);
+	xa_for_each(&simtemp_instances, index, dev) {
+		(*total)++;
+		if (n == max)
+			continue;
+
+		simtemp_stats_record(dev, &records[n++]);
+	}
+	xa_unlock(&simtemp_instances);
+
+	return n;
+}
+
+/*
+ * SIMTEMP_IOC_GET_STATS: copy the counters of every instance that fits
+ * into the caller's array
+ */
+long simtemp_stats_ioctl(struct simtemp_stats_query __user *uquery)
+{
+	struct simtemp_stats_query query;
+	struct simtemp_stats_record *records;
+	unsigned int capacity;
+	long ret = 0;
+
+	if (copy_from_user(&query, uquery, sizeof(query)))
+		return -EFAULT;
+
+	if (query.reserved)
+		return -EINVAL;
+
+	/* There are never more instances than NR_INSTANCES_MAX */
+	capacity = min_t(u32, query.capacity, NR_INSTANCES_MAX);
+
+	records = kvcalloc(max(capacity, 1U), sizeof(*records), GFP_KERNEL);
+	if (!records)
+		return -ENOMEM;
+
+	query.count = simtemp_stats_snapshot(records, capacity, &query.total);
+
+	if (copy_to_user(u64_to_user_ptr(query.records), records,
+			 query.count * sizeof(*records)) ||
+	    copy_to_user(uquery, &query, sizeof(query)))
+		ret = -EFAULT;
+
+	kvfree(records);
+	return ret;
+}
+
+/*
+ * debugfs 'stats': snapshot at open(), so every read() of the same file
+ * sees one consistent header + record array
+ */
+struct simtemp_stats_file {
+	size_t size;
+	struct simtemp_stats_header hdr;
+	struct simtemp_stats_record records[];
+};
+
+static int simtemp_stats_open(struct inode *inode, struct file *filp)
+{
+	struct simtemp_stats_file *snap;
+	unsigned int capacity, total;
+
+	/* The header and the records are read as one contiguous buffer */
+	BUILD_BUG_ON(offsetof(struct simtemp_stats_file, records) !=
+		     offsetof(struct simtemp_stats_file, hdr) + sizeof(snap->hdr));
+
+	/* Sized for the instances there are, again if more were probed meanwhile */
+	simtemp_stats_snapshot(NULL, 0, &total);
+	for (;;) {
+		capacity = total;
+		snap = kvzalloc(struct_size(snap, records, capacity), GFP_KERNEL);
+		if (!snap)
+			return -ENOMEM;
+
+		snap->hdr.count = simtemp_stats_snapshot(snap->records, capacity, &total);
+		if (total <= capacity)
+			break;
+
+		kvfree(snap);
+	}
+
+	snap->hdr.magic = SIMTEMP_STATS_MAGIC;
+	snap->hdr.version = SIMTEMP_STATS_VERSION;
+	snap->hdr.record_size = sizeof(struct simtemp_stats_record);
+	snap->size = sizeof(snap->hdr) + snap->hdr.count * sizeof(snap->records[0]);
+
+	filp->private_data = snap;
+	return 0;
+}
+
+static ssize_t simtemp_stats_file_read(struct file *filp, char __user *buf,
+				       size_t count, loff_t *f_pos)
+{
+	struct simtemp_stats_file *snap = filp->private_data;
+
+	return simple_read_from_buffer(buf, count, f_pos, &snap->hdr, snap->size);
+}
+
+static int simtemp_stats_release(struct inode *inode, struct file *filp)
+{
+	kvfree(filp->private_data);
+	return 0;
+}
+
+static const struct file_operations simtemp_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= simtemp_stats_open,
+	.read		= simtemp_stats_file_read,
+	.release	= simtemp_stats_release,
+	.llseek		= default_llseek,
+};
+
+/*
+ * Create /sys/kernel/debug/nxp_simtemp/
+ * debugfs is optional: errors are ignored, like the debugfs API expects
+ */
+void simtemp_debugfs_init(void)
+{
+	simtemp_debugfs_dir = debugfs_create_dir(DRIVER_NAME, NULL);
+	debugfs_create_file("stats", 0444, simtemp_debugfs_dir, NULL, &simtemp_stats_fops);
+}
+
+void simtemp_debugfs_exit(void)
+{
+	debugfs_remove_recursive(simtemp_debugfs_dir);
+	simtemp_debugfs_dir = NULL;
+}
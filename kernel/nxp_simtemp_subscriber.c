@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * In-kernel subscriber API
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * Exported wrapper around the instance listeners (see
+ * nxp_simtemp_subscriber.h for the API and its context rules).
+ *
+ * Every subscriber is a listener fed at the publish point in
+ * simtemp_flush(). ATOMIC subscribers collect the samples of one flush in
+ * a small batch buffer and get it from the listener's flushed callback,
+ * still under the ring lock. BH and THREAD subscribers push each sample
+ * into their own single-producer/single-consumer ring: the producer is
+ * the publish point (serialized by the ring lock), the consumer is the
+ * subscriber's work item, which hands contiguous runs of the ring to the
+ * callback in place. The flushed callback queues the work once per flush
+ * rather than once per sample.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/workqueue.h>
+
+#include "nxp_simtemp.h"
+#include "nxp_simtemp_subscriber.h"
+
+/* ATOMIC batch buffer (samples) */
+#define SUB_BATCH		32
+
+struct simtemp_subscriber {
+	struct simtemp_listener listener;
+	const struct simtemp_subscriber_ops *ops;
+	enum simtemp_sub_context context;
+	void *priv;
+
+	/* ATOMIC: samples of the flush in progress */
+	struct simtemp_sample batch[SUB_BATCH];
+	unsigned int nbatch;
+
+	/* BH/THREAD: SPSC ring (size samples, free-running indices) */
+	struct simtemp_sample *ring;
+	unsigned int size;
+	u32 head;			/* Next slot written, by the publish point */
+	u32 tail;			/* Next slot handed over, by the work item */
+	struct work_struct work;
+	struct workqueue_struct *wq;
+
+	/* Counters, each written from a single context */
+	u64 delivered;
+	u64 dropped;
+	u64 batches;
+};
+
+/*
+ * Hand a batch to the subscriber, then report its threshold crossings
+ */
+static void simtemp_sub_hand_over(struct simtemp_subscriber *sub,
+				  const struct simtemp_sample *samples, unsigned int n)
+{
+	unsigned int i;
+
+	sub->ops->samples(sub, samples, n);
+	WRITE_ONCE(sub->delivered, sub->delivered + n);
+	WRITE_ONCE(sub->batches, sub->batches + 1);
+
+	if (!sub->ops->threshold)
+		return;
+
+	for (i = 0; i < n; i++)
+		if (samples[i].flags & SIMTEMP_FLAG_THRESHOLD_CROSSED)
+			sub->ops->threshold(sub, &samples[i]);
+}
+
+/*
+ * ATOMIC listener callbacks (under ringbuf.lock)
+ */
+static void simtemp_sub_deliver_atomic(struct simtemp_listener *listener,
+				       const struct simtemp_sample *sample)
+{
+	struct simtemp_subscriber *sub = container_of(listener, struct simtemp_subscriber, listener);
+
+	sub->batch[sub->nbatch++] = *sample;
+	if (sub->nbatch == SUB_BATCH) {
+		simtemp_sub_hand_over(sub, sub->batch, SUB_BATCH);
+		sub->nbatch = 0;
+	}
+}
+
+static void simtemp_sub_flushed_atomic(struct simtemp_listener *listener)
+{
+	struct simtemp_subscriber *sub = container_of(listener, struct simtemp_subscriber, listener);
+
+	if (sub->nbatch) {
+		simtemp_sub_hand_over(sub, sub->batch, sub->nbatch);
+		sub->nbatch = 0;
+	}
+}
+
+/*
+ * BH/THREAD listener callbacks: ring producer (under ringbuf.lock)
+ */
+static void simtemp_sub_deliver_ring(struct simtemp_listener *listener,
+				     const struct simtemp_sample *sample)
+{
+	struct simtemp_subscriber *sub = container_of(listener, struct simtemp_subscriber, listener);
+	u32 head = sub->head;
+
+	if (head - smp_load_acquire(&sub->tail) >= sub->size) {
+		WRITE_ONCE(sub->dropped, sub->dropped + 1);
+		return;
+	}
+
+	sub->ring[head & (sub->size - 1)] = *sample;
+	smp_store_release(&sub->head, head + 1);
+}
+
+static void simtemp_sub_flushed_ring(struct simtemp_listener *listener)
+{
+	struct simtemp_subscriber *sub = container_of(listener, struct simtemp_subscriber, listener);
+
+	if (READ_ONCE(sub->head) != sub->tail)
+		queue_work(sub->wq, &sub->work);
+}
+
+/*
+ * Ring consumer: hand over everything published so far, one contiguous
+ * run of the ring at a time
+ */
+static void simtemp_sub_work(struct work_struct *work)
+{
+	struct simtemp_subscriber *sub = container_of(work, struct simtemp_subscriber, work);
+	u32 tail = sub->tail;
+	u32 head, idx, n;
+
+	while ((head = smp_load_acquire(&sub->head)) != tail) {
+		idx = tail & (sub->size - 1);
+		n = min(head - tail, sub->size - idx);
+
+		simtemp_sub_hand_over(sub, &sub->ring[idx], n);
+
+		tail += n;
+		smp_store_release(&sub->tail, tail);
+	}
+}
+
+struct simtemp_subscriber *simtemp_subscribe(u32 instance,
+					     const struct simtemp_subscriber_ops *ops,
+					     enum simtemp_sub_context context,
+					     unsigned int ring_size, void *priv)
+{
+	struct simtemp_subscriber *sub;
+	int ret;
+
+	if (!ops || !ops->samples)
+		return ERR_PTR(-EINVAL);
+
+	switch (context) {
+	case SIMTEMP_SUB_ATOMIC:
+		ring_size = 0;
+		break;
+	case SIMTEMP_SUB_BH:
+	case SIMTEMP_SUB_THREAD:
+		if (!ring_size)
+			ring_size = SIMTEMP_SUB_RING_DEFAULT;
+		if (!is_power_of_2(ring_size) || ring_size > SIMTEMP_SUB_RING_MAX)
+			return ERR_PTR(-EINVAL);
+		break;
+	default:
+		return ERR_PTR(-EINVAL);
+	}
+
+	sub = kzalloc(sizeof(*sub), GFP_KERNEL);
+	if (!sub)
+		return ERR_PTR(-ENOMEM);
+
+	sub->ops = ops;
+	sub->context = context;
+	sub->priv = priv;
+
+	if (context == SIMTEMP_SUB_ATOMIC) {
+		sub->listener.deliver = simtemp_sub_deliver_atomic;
+		sub->listener.flushed = simtemp_sub_flushed_atomic;
+	} else {
+		sub->ring = kvcalloc(ring_size, sizeof(*sub->ring), GFP_KERNEL);
+		if (!sub->ring) {
+			kfree(sub);
+			return ERR_PTR(-ENOMEM);
+		}
+		sub->size = ring_size;
+		sub->wq = context == SIMTEMP_SUB_BH ? system_bh_highpri_wq : system_highpri_wq;
+		INIT_WORK(&sub->work, simtemp_sub_work);
+		sub->listener.deliver = simtemp_sub_deliver_ring;
+		sub->listener.flushed = simtemp_sub_flushed_ring;
+	}
+
+	ret = simtemp_listener_attach(instance, &sub->listener);
+	if (ret) {
+		kvfree(sub->ring);
+		kfree(sub);
+		return ERR_PTR(ret);
+	}
+
+	return sub;
+}
+EXPORT_SYMBOL_GPL(simtemp_subscribe);
+
+/*
+ * The listener may be running on another CPU until a grace period passed,
+ * and may have queued the work one last time.
+ */
+void simtemp_unsubscribe(struct simtemp_subscriber *sub)
+{
+	if (IS_ERR_OR_NULL(sub))
+		return;
+
+	simtemp_listener_detach(&sub->listener);
+	synchronize_rcu();
+
+	if (sub->ring)
+		cancel_work_sync(&sub->work);
+
+	kvfree(sub->ring);
+	kfree(sub);
+}
+EXPORT_SYMBOL_GPL(simtemp_unsubscribe);
+
+void *simtemp_subscriber_priv(struct simtemp_subscriber *sub)
+{
+	return sub->priv;
+}
+EXPORT_SYMBOL_GPL(simtemp_subscriber_priv);
+
+void simtemp_subscriber_stats(struct simtemp_subscriber *sub,
+			      struct simtemp_subscriber_stats *stats)
+{
+	stats->delivered = READ_ONCE(sub->delivered);
+	stats->dropped = READ_ONCE(sub->dropped);
+	stats->batches = READ_ONCE(sub->batches);
+}
+EXPORT_SYMBOL_GPL(simtemp_subscriber_stats);
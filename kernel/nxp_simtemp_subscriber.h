@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * In-kernel subscriber API
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * Lets other kernel modules (a throttling policy, a logger) receive an
+ * instance's samples and threshold crossings straight from the publish
+ * point, without a round trip through user space:
+ *
+ *	static void my_samples(struct simtemp_subscriber *sub,
+ *			       const struct simtemp_sample *samples,
+ *			       unsigned int n)
+ *	{
+ *		...
+ *	}
+ *
+ *	static const struct simtemp_subscriber_ops my_ops = {
+ *		.samples = my_samples,
+ *	};
+ *
+ *	sub = simtemp_subscribe(0, &my_ops, SIMTEMP_SUB_THREAD, 0, my_data);
+ *	...
+ *	simtemp_unsubscribe(sub);
+ *
+ * Build against this header and the driver's Module.symvers
+ * (KBUILD_EXTRA_SYMBOLS); the symbols are EXPORT_SYMBOL_GPL.
+ *
+ * Context rules, chosen per subscriber with one of the SIMTEMP_SUB_*
+ * contexts:
+ *
+ * SIMTEMP_SUB_ATOMIC	Callbacks run at the publish point, inside the
+ *			instance's ring lock with interrupts disabled:
+ *			hardirq context (sampling timer) or process context
+ *			(a write() injecting samples). Lowest latency. Must
+ *			not sleep, and must be short: every subscriber and
+ *			reader of the instance waits for it.
+ * SIMTEMP_SUB_BH	Samples are queued on a per-subscriber lock-free
+ *			ring and handed over from a BH workqueue (softirq
+ *			context, interrupts enabled). Must not sleep.
+ * SIMTEMP_SUB_THREAD	Same ring, drained by a high-priority workqueue in
+ *			process context. May sleep (take mutexes, allocate
+ *			with GFP_KERNEL, call into cpufreq or thermal).
+ *
+ * In every context, callbacks for one subscriber never run concurrently
+ * and see samples in timestamp order. Batches point into driver memory
+ * (the per-subscriber ring, or a small batch buffer for ATOMIC) that is
+ * only valid during the callback. When a ring subscriber falls more than
+ * its ring size behind, new samples are dropped and counted.
+ *
+ * simtemp_subscribe() and simtemp_unsubscribe() may sleep. A subscriber
+ * whose instance is removed stops receiving samples; it must still be
+ * unsubscribed by its owner.
+ */
+
+#ifndef _NXP_SIMTEMP_SUBSCRIBER_H
+#define _NXP_SIMTEMP_SUBSCRIBER_H
+
+#include <linux/types.h>
+
+#include "nxp_simtemp_ioctl.h"
+
+struct simtemp_subscriber;
+
+/* Delivery contexts */
+enum simtemp_sub_context {
+	SIMTEMP_SUB_ATOMIC = 0,
+	SIMTEMP_SUB_BH,
+	SIMTEMP_SUB_THREAD,
+};
+
+/* Ring size of BH/THREAD subscribers when 0 is passed (samples) */
+#define SIMTEMP_SUB_RING_DEFAULT	1024
+#define SIMTEMP_SUB_RING_MAX		65536
+
+struct simtemp_subscriber_ops {
+	/* A batch of consecutive samples, oldest first (required) */
+	void (*samples)(struct simtemp_subscriber *sub,
+			const struct simtemp_sample *samples, unsigned int n);
+
+	/*
+	 * A sample that crossed the threshold (SIMTEMP_FLAG_THRESHOLD_CROSSED),
+	 * called after the batch that contains it (optional)
+	 */
+	void (*threshold)(struct simtemp_subscriber *sub,
+			  const struct simtemp_sample *sample);
+};
+
+struct simtemp_subscriber_stats {
+	u64 delivered;			/* Samples handed to ops->samples */
+	u64 dropped;			/* Samples lost to a full ring */
+	u64 batches;			/* ops->samples calls */
+};
+
+/*
+ * Subscribe to instance @instance
+ * @ring_size: ring of BH/THREAD subscribers (power of 2, 0 = default);
+ * ignored for ATOMIC
+ * Returns the subscriber or an ERR_PTR(): -ENODEV (no such instance),
+ * -EINVAL, -ENOMEM.
+ */
+struct simtemp_subscriber *simtemp_subscribe(u32 instance,
+					     const struct simtemp_subscriber_ops *ops,
+					     enum simtemp_sub_context context,
+					     unsigned int ring_size, void *priv);
+
+/*
+ * Stop delivery and free @sub
+ * No callback runs once this returns.
+ */
+void simtemp_unsubscribe(struct simtemp_subscriber *sub);
+
+/* The @priv pointer given to simtemp_subscribe() */
+void *simtemp_subscriber_priv(struct simtemp_subscriber *sub);
+
+/* Snapshot of the subscriber's counters */
+void simtemp_subscriber_stats(struct simtemp_subscriber *sub,
+			      struct simtemp_subscriber_stats *stats);
+
+#endif /* _NXP_SIMTEMP_SUBSCRIBER_H */
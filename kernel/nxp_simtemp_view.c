@@ -0,0 +1,554 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NXP SimTemp - Virtual Temperature Sensor Driver
+ * Per-view stream file descriptors
+ *
+ * Copyright (C) 2025 NXP Semiconductors
+ *
+ * A /dev/simtemp fd delivers raw samples and raises EPOLLPRI for the
+ * threshold, so every other view of the data would be one more mode on
+ * the same fd. SIMTEMP_IOC_OPEN_VIEW instead returns an anon-inode fd
+ * dedicated to one view: raw samples, low-pass filtered samples,
+ * threshold/anomaly events or periodic aggregates. Consumers register
+ * exactly the streams they need with epoll.
+ *
+ * Each view is a listener on its instance, fed at the publish point in
+ * simtemp_flush(). Its deliver callback (one per view type) computes the
+ * view and pushes records into the view's own overwrite ring; a view
+ * only wakes its readers when it produces a record, so an aggregate over
+ * 1000 samples costs one wakeup per 1000 samples. When the instance is
+ * removed the view is detached: read() returns 0 once its ring is drained
+ * and poll() reports EPOLLHUP.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/anon_inodes.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+
+#include "nxp_simtemp.h"
+
+/* Largest record of any view type, for the read() bounce batch */
+#define VIEW_RECORD_MAX		sizeof(struct simtemp_aggregate)
+
+/* One view fd */
+struct simtemp_view {
+	struct simtemp_listener listener;
+	struct simtemp_view_req req;
+
+	/*
+	 * Record ring (depth records of rsize bytes, free-running indices)
+	 * The writer overwrites the oldest record when it is full.
+	 */
+	spinlock_t lock;
+	void *ring;
+	unsigned int rsize;
+	unsigned int depth;
+	u32 head;			/* Next record written, under lock */
+	u32 tail;			/* Read cursor, under lock */
+	u32 watermark;			/* Records pending before EPOLLIN / wakeup */
+	wait_queue_head_t wait;
+
+	/* View state, only touched by the deliver callback */
+	u32 skip;			/* Samples since the last decimated one */
+	bool primed;			/* At least one sample seen */
+	s64 filter_acc;			/* FILTERED: temperature << filter_shift */
+	bool above;			/* EVENTS: above the threshold */
+	s32 last_mC;			/* EVENTS: previous temperature */
+	struct simtemp_aggregate agg;	/* AGGREGATES: window in progress */
+	s64 agg_sum;
+
+	/* Counters for fdinfo */
+	u64 samples_seen;		/* Samples handed to the view */
+	u64 delivered;			/* Records pushed, under lock */
+	u64 dropped;			/* Records overwritten unread, under lock */
+	u64 records_read;
+	u64 read_count;
+	u64 poll_count;
+};
+
+static const char * const simtemp_view_names[] = {
+	[SIMTEMP_VIEW_RAW]		= "raw",
+	[SIMTEMP_VIEW_FILTERED]		= "filtered",
+	[SIMTEMP_VIEW_EVENTS]		= "events",
+	[SIMTEMP_VIEW_AGGREGATES]	= "aggregates",
+};
+
+/*
+ * Append one record to the view's ring and wake readers past watermark
+ * Called from the deliver callbacks, with interrupts disabled.
+ */
+static void simtemp_view_push(struct simtemp_view *view, const void *rec)
+{
+	unsigned int pending;
+
+	spin_lock(&view->lock);
+
+	if (view->head - view->tail == view->depth) {
+		view->tail++;
+		view->dropped++;
+	}
+
+	memcpy(view->ring + (size_t)(view->head & (view->depth - 1)) * view->rsize,
+	       rec, view->rsize);
+	view->head++;
+	view->delivered++;
+	pending = view->head - view->tail;
+
+	spin_unlock(&view->lock);
+
+	if (pending >= READ_ONCE(view->watermark) && wq_has_sleeper(&view->wait))
+		wake_up_interruptible(&view->wait);
+}
+
+/*
+ * Decimation: true for every Nth sample handed to the view
+ */
+static bool simtemp_view_decimate(struct simtemp_view *view)
+{
+	if (++view->skip < view->req.decimate)
+		return false;
+
+	view->skip = 0;
+	return true;
+}
+
+/*
+ * Deliver callbacks, one per view type
+ * Called from simtemp_flush() with the instance's ring lock held and
+ * interrupts disabled, in timestamp order.
+ */
+
+static void simtemp_view_deliver_raw(struct simtemp_listener *listener,
+				     const struct simtemp_sample *sample)
+{
+	struct simtemp_view *view = container_of(listener, struct simtemp_view, listener);
+
+	view->samples_seen++;
+	if (simtemp_view_decimate(view))
+		simtemp_view_push(view, sample);
+}
+
+/*
+ * First-order low-pass filter: acc holds the output << shift, so
+ * acc += x - acc / 2^shift keeps full precision in integers
+ */
+static void simtemp_view_deliver_filtered(struct simtemp_listener *listener,
+					  const struct simtemp_sample *sample)
+{
+	struct simtemp_view *view = container_of(listener, struct simtemp_view, listener);
+	unsigned int shift = view->req.filter_shift;
+	struct simtemp_sample out = *sample;
+
+	view->samples_seen++;
+
+	if (!view->primed) {
+		view->filter_acc = (s64)sample->temp_mC << shift;
+		view->primed = true;
+	} else {
+		view->filter_acc += sample->temp_mC - (view->filter_acc >> shift);
+	}
+
+	if (!simtemp_view_decimate(view))
+		return;
+
+	out.temp_mC = view->filter_acc >> shift;
+	simtemp_view_push(view, &out);
+}
+
+static void simtemp_view_deliver_events(struct simtemp_listener *listener,
+					const struct simtemp_sample *sample)
+{
+	struct simtemp_view *view = container_of(listener, struct simtemp_view, listener);
+	const struct simtemp_view_req *req = &view->req;
+	struct simtemp_event ev = {
+		.timestamp_ns	= sample->timestamp_ns,
+		.temp_mC	= sample->temp_mC,
+	};
+
+	view->samples_seen++;
+
+	if (!view->above && sample->temp_mC > req->threshold_mC) {
+		view->above = true;
+		ev.type = SIMTEMP_EVENT_RISING;
+		simtemp_view_push(view, &ev);
+	} else if (view->above &&
+		   (s64)sample->temp_mC <= (s64)req->threshold_mC - req->hysteresis_mC) {
+		view->above = false;
+		ev.type = SIMTEMP_EVENT_FALLING;
+		simtemp_view_push(view, &ev);
+	}
+
+	if (req->jump_mC && view->primed &&
+	    abs((s64)sample->temp_mC - view->last_mC) >= req->jump_mC) {
+		ev.type = SIMTEMP_EVENT_JUMP;
+		simtemp_view_push(view, &ev);
+	}
+
+	view->last_mC = sample->temp_mC;
+	view->primed = true;
+}
+
+static void simtemp_view_deliver_aggregates(struct simtemp_listener *listener,
+					    const struct simtemp_sample *sample)
+{
+	struct simtemp_view *view = container_of(listener, struct simtemp_view, listener);
+	struct simtemp_aggregate *agg = &view->agg;
+
+	view->samples_seen++;
+
+	if (!agg->count) {
+		agg->first_ns = sample->timestamp_ns;
+		agg->min_mC = sample->temp_mC;
+		agg->max_mC = sample->temp_mC;
+		view->agg_sum = 0;
+	}
+
+	agg->last_ns = sample->timestamp_ns;
+	agg->min_mC = min(agg->min_mC, sample->temp_mC);
+	agg->max_mC = max(agg->max_mC, sample->temp_mC);
+	view->agg_sum += sample->temp_mC;
+
+	if (++agg->count < view->req.window)
+		return;
+
+	agg->mean_mC = div_s64(view->agg_sum, agg->count);
+	simtemp_view_push(view, agg);
+	agg->count = 0;
+}
+
+/*
+ * Listener callback: the instance is being removed, wake the readers
+ */
+static void simtemp_view_removed(struct simtemp_listener *listener)
+{
+	struct simtemp_view *view = container_of(listener, struct simtemp_view, listener);
+
+	wake_up_interruptible(&view->wait);
+}
+
+static const simtemp_deliver_fn simtemp_view_deliver[] = {
+	[SIMTEMP_VIEW_RAW]		= simtemp_view_deliver_raw,
+	[SIMTEMP_VIEW_FILTERED]		= simtemp_view_deliver_filtered,
+	[SIMTEMP_VIEW_EVENTS]		= simtemp_view_deliver_events,
+	[SIMTEMP_VIEW_AGGREGATES]	= simtemp_view_deliver_aggregates,
+};
+
+static const unsigned int simtemp_view_rsize[] = {
+	[SIMTEMP_VIEW_RAW]		= sizeof(struct simtemp_sample),
+	[SIMTEMP_VIEW_FILTERED]		= sizeof(struct simtemp_sample),
+	[SIMTEMP_VIEW_EVENTS]		= sizeof(struct simtemp_event),
+	[SIMTEMP_VIEW_AGGREGATES]	= sizeof(struct simtemp_aggregate),
+};
+
+/*
+ * Move up to @max records out of the view's ring into @batch
+ * Returns the number of records copied
+ */
+static unsigned int simtemp_view_take(struct simtemp_view *view, void *batch,
+				      unsigned int max)
+{
+	unsigned long flags;
+	unsigned int n = 0;
+
+	spin_lock_irqsave(&view->lock, flags);
+	while (n < max && view->tail != view->head) {
+		memcpy(batch + (size_t)n * view->rsize,
+		       view->ring + (size_t)(view->tail & (view->depth - 1)) * view->rsize,
+		       view->rsize);
+		view->tail++;
+		n++;
+	}
+	spin_unlock_irqrestore(&view->lock, flags);
+
+	return n;
+}
+
+/*
+ * Check whether at least watermark records are queued (lockless)
+ */
+static bool simtemp_view_pending(struct simtemp_view *view)
+{
+	return READ_ONCE(view->head) - READ_ONCE(view->tail) >= READ_ONCE(view->watermark);
+}
+
+/*
+ * Check whether the instance was removed (lockless)
+ */
+static bool simtemp_view_hangup(struct simtemp_view *view)
+{
+	return !READ_ONCE(view->listener.dev);
+}
+
+/*
+ * File operations: read()
+ * Returns as many whole records of the view's type as fit
+ *
+ * Blocks (unless O_NONBLOCK) until at least watermark records are queued,
+ * then drains the ring in READ_BATCH chunks without sleeping again.
+ * Returns 0 once the ring is drained and the instance is gone.
+ */
+static ssize_t simtemp_view_read(struct file *filp, char __user *buf,
+				 size_t count, loff_t *f_pos)
+{
+	struct simtemp_view *view = filp->private_data;
+	u8 batch[READ_BATCH * VIEW_RECORD_MAX];
+	size_t rsize = view->rsize;
+	size_t max = count / rsize;
+	size_t done = 0;
+	unsigned int want, n;
+	int ret;
+
+	if (!max)
+		return -EINVAL;
+
+	for (;;) {
+		want = min_t(size_t, max, READ_BATCH);
+		n = simtemp_view_take(view, batch, want);
+		if (n)
+			break;
+
+		if (simtemp_view_hangup(view))
+			return 0;
+
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(view->wait, simtemp_view_pending(view) ||
+						 simtemp_view_hangup(view));
+		if (ret)
+			return -ERESTARTSYS;
+	}
+
+	for (;;) {
+		if (copy_to_user(buf + done * rsize, batch, n * rsize)) {
+			pr_err("%s: copy_to_user failed\n", DRIVER_NAME);
+			return -EFAULT;
+		}
+		done += n;
+
+		/* Stop on a short chunk (ring drained) or a full user buffer */
+		if (n < want || done == max)
+			break;
+
+		want = min_t(size_t, max - done, READ_BATCH);
+		n = simtemp_view_take(view, batch, want);
+		if (!n)
+			break;
+	}
+
+	view->read_count++;
+	view->records_read += done;
+
+	return done * rsize;
+}
+
+/*
+ * File operations: poll()
+ * EPOLLIN once at least watermark records are queued, EPOLLHUP once the
+ * instance is gone
+ */
+static __poll_t simtemp_view_poll(struct file *filp, struct poll_table_struct *wait)
+{
+	struct simtemp_view *view = filp->private_data;
+	__poll_t mask = 0;
+
+	poll_wait(filp, &view->wait, wait);
+
+	view->poll_count++;
+
+	if (simtemp_view_pending(view))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	if (simtemp_view_hangup(view))
+		mask |= EPOLLHUP;
+
+	return mask;
+}
+
+/*
+ * File operations: unlocked_ioctl()
+ */
+static long simtemp_view_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct simtemp_view *view = filp->private_data;
+	void __user *uarg = (void __user *)arg;
+	u32 val;
+
+	switch (cmd) {
+	case SIMTEMP_IOC_SET_WATERMARK:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+
+		if (!val || val > view->depth)
+			return -EINVAL;
+
+		WRITE_ONCE(view->watermark, val);
+		wake_up_interruptible(&view->wait);
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+/*
+ * Detach the view from its instance and free it
+ * The listener may be running on another CPU until a grace period passed.
+ */
+static void simtemp_view_free(struct simtemp_view *view)
+{
+	simtemp_listener_detach(&view->listener);
+	synchronize_rcu();
+
+	kvfree(view->ring);
+	kfree(view);
+}
+
+/*
+ * File operations: release()
+ */
+static int simtemp_view_release(struct inode *inode, struct file *filp)
+{
+	simtemp_view_free(filp->private_data);
+	return 0;
+}
+
+/*
+ * File operations: show_fdinfo()
+ */
+static void simtemp_view_show_fdinfo(struct seq_file *m, struct file *filp)
+{
+	struct simtemp_view *view = filp->private_data;
+
+	seq_printf(m, "simtemp-view:\t%s\n", simtemp_view_names[view->req.type]);
+	seq_printf(m, "simtemp-format:\t%u B\n", view->rsize);
+	seq_printf(m, "simtemp-depth:\t%u\n", view->depth);
+	seq_printf(m, "simtemp-watermark:\t%u\n", READ_ONCE(view->watermark));
+	seq_printf(m, "simtemp-lag:\t%u\n", READ_ONCE(view->head) - READ_ONCE(view->tail));
+	seq_printf(m, "simtemp-samples-seen:\t%llu\n", view->samples_seen);
+	seq_printf(m, "simtemp-delivered:\t%llu\n", view->delivered);
+	seq_printf(m, "simtemp-dropped:\t%llu\n", view->dropped);
+	seq_printf(m, "simtemp-records-read:\t%llu\n", view->records_read);
+	seq_printf(m, "simtemp-reads:\t%llu\n", view->read_count);
+	seq_printf(m, "simtemp-polls:\t%llu\n", view->poll_count);
+}
+
+static const struct file_operations simtemp_view_fops = {
+	.owner		= THIS_MODULE,
+	.release	= simtemp_view_release,
+	.read		= simtemp_view_read,
+	.poll		= simtemp_view_poll,
+	.unlocked_ioctl	= simtemp_view_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
+	.show_fdinfo	= simtemp_view_show_fdinfo,
+	.llseek		= noop_llseek,
+};
+
+/*
+ * Validate a view request and fill in defaults
+ * Returns 0 or -EINVAL
+ */
+static int simtemp_view_check(struct simtemp_view_req *req)
+{
+	if (req->type >= ARRAY_SIZE(simtemp_view_deliver) || req->reserved ||
+	    req->flags & ~(SIMTEMP_VIEW_NONBLOCK | SIMTEMP_VIEW_CLOEXEC))
+		return -EINVAL;
+
+	if (!req->depth)
+		req->depth = SIMTEMP_VIEW_DEPTH;
+	if (!is_power_of_2(req->depth) || req->depth > SIMTEMP_VIEW_DEPTH_MAX)
+		return -EINVAL;
+
+	switch (req->type) {
+	case SIMTEMP_VIEW_FILTERED:
+		if (!req->filter_shift || req->filter_shift > SIMTEMP_VIEW_FILTER_SHIFT_MAX)
+			return -EINVAL;
+		fallthrough;
+	case SIMTEMP_VIEW_RAW:
+		if (req->threshold_mC || req->hysteresis_mC || req->jump_mC || req->window)
+			return -EINVAL;
+		if (req->type == SIMTEMP_VIEW_RAW && req->filter_shift)
+			return -EINVAL;
+		req->decimate = max_t(u32, req->decimate, 1);
+		return 0;
+
+	case SIMTEMP_VIEW_EVENTS:
+		if (req->decimate || req->filter_shift || req->window)
+			return -EINVAL;
+		return 0;
+
+	case SIMTEMP_VIEW_AGGREGATES:
+		if (req->decimate || req->filter_shift || req->threshold_mC ||
+		    req->hysteresis_mC || req->jump_mC)
+			return -EINVAL;
+		if (!req->window || req->window > SIMTEMP_VIEW_WINDOW_MAX)
+			return -EINVAL;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * SIMTEMP_IOC_OPEN_VIEW
+ * Returns the new fd or a negative error code
+ */
+long simtemp_view_open(struct simtemp_device *dev, struct simtemp_view_req __user *ureq)
+{
+	struct simtemp_view *view;
+	int flags = O_RDONLY;
+	int fd, ret;
+
+	view = kzalloc(sizeof(*view), GFP_KERNEL);
+	if (!view)
+		return -ENOMEM;
+
+	if (copy_from_user(&view->req, ureq, sizeof(view->req))) {
+		kfree(view);
+		return -EFAULT;
+	}
+
+	ret = simtemp_view_check(&view->req);
+	if (ret) {
+		kfree(view);
+		return ret;
+	}
+
+	view->depth = view->req.depth;
+	view->rsize = simtemp_view_rsize[view->req.type];
+	view->ring = kvcalloc(view->depth, view->rsize, GFP_KERNEL);
+	if (!view->ring) {
+		kfree(view);
+		return -ENOMEM;
+	}
+
+	spin_lock_init(&view->lock);
+	init_waitqueue_head(&view->wait);
+	view->watermark = 1;
+	view->listener.deliver = simtemp_view_deliver[view->req.type];
+	view->listener.removed = simtemp_view_removed;
+
+	ret = simtemp_listener_attach(dev->id, &view->listener);
+	if (ret) {
+		kvfree(view->ring);
+		kfree(view);
+		return ret;
+	}
+
+	if (view->req.flags & SIMTEMP_VIEW_NONBLOCK)
+		flags |= O_NONBLOCK;
+	if (view->req.flags & SIMTEMP_VIEW_CLOEXEC)
+		flags |= O_CLOEXEC;
+
+	fd = anon_inode_getfd("[simtemp-view]", &simtemp_view_fops, view, flags);
+	if (fd < 0)
+		simtemp_view_free(view);
+
+	return fd;
+}
@@ -0,0 +1,135 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# NXP SimTemp Startup Benchmark
+# Measures how long it takes to bring up N instances (insmod until every
+# /dev/simtempN and its sysfs attributes exist) and to tear them down.
+# Results are appended to perf_results/startup.csv so they can be tracked
+# across commits.
+#
+# Usage: sudo ./scripts/bench_startup.sh [options]
+#   -n 1000         Number of instances (default: 1000)
+#   -r 3            Repetitions, the median is recorded (default: 3)
+#   -c 20           Fail if slower than the previous run by more than
+#                   this many percent (same instance count and kernel)
+
+set -e  # Exit on error
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Project root
+PROJECT_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+KERNEL_DIR="$PROJECT_ROOT/kernel"
+MODULE_NAME="nxp_simtemp"
+MODULE_FILE="$KERNEL_DIR/${MODULE_NAME}.ko"
+RESULTS_DIR="$PROJECT_ROOT/perf_results"
+HISTORY="$RESULTS_DIR/startup.csv"
+
+# Defaults
+INSTANCES=1000
+REPEAT=3
+CHECK_PCT=""
+TIMEOUT_S=120
+
+info() {
+    echo -e "${BLUE}→${NC} $1"
+}
+
+die() {
+    echo -e "${RED}ERROR: $1${NC}"
+    exit 1
+}
+
+while getopts "n:r:c:h" opt; do
+    case $opt in
+        n) INSTANCES="$OPTARG" ;;
+        r) REPEAT="$OPTARG" ;;
+        c) CHECK_PCT="$OPTARG" ;;
+        *) sed -n '3,16p' "$0" | sed 's/^# \{0,1\}//'; exit 1 ;;
+    esac
+done
+
+# Check if running as root
+if [ "$EUID" -ne 0 ]; then
+    die "This script must be run as root (use sudo)"
+fi
+
+[ -f "$MODULE_FILE" ] || die "Module not found, run ./scripts/build.sh"
+
+if lsmod | grep -q "^${MODULE_NAME}"; then
+    rmmod $MODULE_NAME
+fi
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# Every instance is ready once its stats attribute is visible
+ready_count() {
+    ls -d /sys/class/misc/simtemp*/stats 2>/dev/null | wc -l
+}
+
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+echo -e "${BLUE}NXP SimTemp startup benchmark: $INSTANCES instances, $REPEAT runs${NC}"
+
+LOAD=""
+READY=""
+UNLOAD=""
+for run in $(seq "$REPEAT"); do
+    start=$(now_ms)
+    insmod "$MODULE_FILE" nr_instances="$INSTANCES"
+    loaded=$(now_ms)
+
+    # Probes are asynchronous: insmod returns before instances exist
+    while [ "$(ready_count)" -lt "$INSTANCES" ]; do
+        if [ $(( $(now_ms) - start )) -gt $(( TIMEOUT_S * 1000 )) ]; then
+            rmmod $MODULE_NAME || true
+            die "Only $(ready_count)/$INSTANCES instances after ${TIMEOUT_S}s"
+        fi
+        sleep 0.01
+    done
+    ready=$(now_ms)
+
+    rmmod $MODULE_NAME
+    gone=$(now_ms)
+
+    LOAD="$LOAD $((loaded - start))"
+    READY="$READY $((ready - start))"
+    UNLOAD="$UNLOAD $((gone - ready))"
+    info "run $run: insmod $((loaded - start)) ms, all ready $((ready - start)) ms, rmmod $((gone - ready)) ms"
+done
+
+LOAD_MS=$(echo $LOAD | tr ' ' '\n' | median)
+READY_MS=$(echo $READY | tr ' ' '\n' | median)
+UNLOAD_MS=$(echo $UNLOAD | tr ' ' '\n' | median)
+
+# Append to the history
+mkdir -p "$RESULTS_DIR"
+[ -f "$HISTORY" ] || echo "date,commit,kernel,instances,insmod_ms,ready_ms,rmmod_ms" > "$HISTORY"
+
+KERNEL=$(uname -r)
+COMMIT=$(git -C "$PROJECT_ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)
+PREV=$(awk -F, -v k="$KERNEL" -v n="$INSTANCES" '$3 == k && $4 == n { r = $6 } END { print r }' "$HISTORY")
+
+echo "$(date +%Y-%m-%dT%H:%M:%S),$COMMIT,$KERNEL,$INSTANCES,$LOAD_MS,$READY_MS,$UNLOAD_MS" >> "$HISTORY"
+
+echo
+echo -e "${GREEN}Median:${NC} insmod ${LOAD_MS} ms, all ready ${READY_MS} ms, rmmod ${UNLOAD_MS} ms"
+info "Recorded in $HISTORY"
+
+if [ -n "$PREV" ] && [ "$PREV" -gt 0 ]; then
+    PCT=$(( (READY_MS - PREV) * 100 / PREV ))
+    echo "Previous run: ready ${PREV} ms (${PCT}% change)"
+    if [ -n "$CHECK_PCT" ] && [ "$PCT" -gt "$CHECK_PCT" ]; then
+        echo -e "${RED}✗ Startup regressed by ${PCT}% (limit ${CHECK_PCT}%)${NC}"
+        exit 1
+    fi
+fi
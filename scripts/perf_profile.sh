@@ -0,0 +1,260 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# NXP SimTemp Profiling Harness
+# Runs load scenarios (sampling period x reader count) under perf record
+# and produces folded stacks, flame graphs and a top-N self-time report,
+# optionally diffed against a stored baseline.
+#
+# Usage: sudo ./scripts/perf_profile.sh [options]
+#   -p "10 1"       Sampling periods in ms to profile (default: "10 1")
+#   -n "1 4"        Reader counts to profile (default: "1 4")
+#   -d 10           Seconds recorded per scenario (default: 10)
+#   -t 20           Top-N entries in the report (default: 20)
+#   -o DIR          Output directory (default: perf_results/<timestamp>)
+#   -b DIR          Baseline directory to diff against
+#   -s              Store this run as the baseline (perf_results/baseline)
+#
+# Flame graphs need flamegraph.pl (FlameGraph, set FLAMEGRAPH_DIR) or
+# inferno-flamegraph in PATH; folded stacks and reports are always written.
+
+set -e  # Exit on error
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Project root
+PROJECT_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+KERNEL_DIR="$PROJECT_ROOT/kernel"
+MODULE_NAME="nxp_simtemp"
+MODULE_FILE="$KERNEL_DIR/${MODULE_NAME}.ko"
+SYSFS_PATH="/sys/class/misc/simtemp"
+RESULTS_DIR="$PROJECT_ROOT/perf_results"
+
+# Defaults
+PERIODS="10 1"
+READERS="1 4"
+DURATION=10
+TOP_N=20
+OUT_DIR="$RESULTS_DIR/$(date +%Y%m%d-%H%M%S)"
+BASELINE_DIR=""
+SAVE_BASELINE=0
+
+info() {
+    echo -e "${BLUE}→${NC} $1"
+}
+
+warn() {
+    echo -e "${YELLOW}⚠${NC} $1"
+}
+
+die() {
+    echo -e "${RED}ERROR: $1${NC}"
+    exit 1
+}
+
+while getopts "p:n:d:t:o:b:sh" opt; do
+    case $opt in
+        p) PERIODS="$OPTARG" ;;
+        n) READERS="$OPTARG" ;;
+        d) DURATION="$OPTARG" ;;
+        t) TOP_N="$OPTARG" ;;
+        o) OUT_DIR="$OPTARG" ;;
+        b) BASELINE_DIR="$OPTARG" ;;
+        s) SAVE_BASELINE=1 ;;
+        *) sed -n '3,20p' "$0" | sed 's/^# \{0,1\}//'; exit 1 ;;
+    esac
+done
+
+if [ $SAVE_BASELINE -eq 1 ]; then
+    OUT_DIR="$RESULTS_DIR/baseline"
+fi
+
+# Check if running as root
+if [ "$EUID" -ne 0 ]; then
+    die "This script must be run as root (use sudo)"
+fi
+
+command -v perf >/dev/null 2>&1 || die "perf not found (install linux-tools for this kernel)"
+
+# Flame graph renderer (optional)
+FLAMEGRAPH=""
+if [ -n "$FLAMEGRAPH_DIR" ] && [ -x "$FLAMEGRAPH_DIR/flamegraph.pl" ]; then
+    FLAMEGRAPH="$FLAMEGRAPH_DIR/flamegraph.pl"
+elif command -v flamegraph.pl >/dev/null 2>&1; then
+    FLAMEGRAPH="flamegraph.pl"
+elif command -v inferno-flamegraph >/dev/null 2>&1; then
+    FLAMEGRAPH="inferno-flamegraph"
+else
+    warn "No flame graph renderer found, SVGs will be skipped"
+fi
+
+echo -e "${BLUE}╔══════════════════════════════════════════════════════════════╗${NC}"
+echo -e "${BLUE}║       NXP SimTemp Profiling Harness                         ║${NC}"
+echo -e "${BLUE}╚══════════════════════════════════════════════════════════════╝${NC}"
+echo
+
+# Load the module unless it is already there
+LOADED_HERE=0
+if ! lsmod | grep -q "^${MODULE_NAME}"; then
+    [ -f "$MODULE_FILE" ] || die "Module not found, run ./scripts/build.sh"
+    insmod "$MODULE_FILE"
+    LOADED_HERE=1
+    sleep 1
+fi
+
+# Module symbols are only visible in /proc/kallsyms with kptr_restrict=0
+OLD_KPTR=$(sysctl -n kernel.kptr_restrict)
+OLD_PARANOID=$(sysctl -n kernel.perf_event_paranoid)
+OLD_SAMPLING=$(cat "$SYSFS_PATH/sampling_ms")
+READER_PIDS=""
+
+cleanup() {
+    [ -n "$READER_PIDS" ] && kill $READER_PIDS 2>/dev/null || true
+    echo "$OLD_SAMPLING" > "$SYSFS_PATH/sampling_ms" 2>/dev/null || true
+    sysctl -qw kernel.kptr_restrict="$OLD_KPTR" || true
+    sysctl -qw kernel.perf_event_paranoid="$OLD_PARANOID" || true
+    if [ $LOADED_HERE -eq 1 ]; then
+        rmmod $MODULE_NAME || true
+    fi
+}
+trap cleanup EXIT
+
+sysctl -qw kernel.kptr_restrict=0
+sysctl -qw kernel.perf_event_paranoid=-1
+
+mkdir -p "$OUT_DIR"
+cp /proc/kallsyms "$OUT_DIR/kallsyms"
+info "Results: $OUT_DIR"
+
+#
+# fold_stacks - perf script output to folded stacks (root first)
+# Module frames keep their module name, e.g. simtemp_flush [nxp_simtemp]
+#
+fold_stacks() {
+    awk '
+    function flush_stack(   i, s) {
+        if (comm == "")
+            return
+        s = comm
+        for (i = depth; i >= 1; i--)
+            s = s ";" frame[i]
+        count[s]++
+        comm = ""
+        depth = 0
+    }
+    /^[^ \t]/ { flush_stack(); comm = $1; next }
+    /^[ \t]+[0-9a-f]+ / {
+        sym = $2
+        sub(/\+0x[0-9a-f]+$/, "", sym)
+        dso = $NF
+        gsub(/[()]/, "", dso)
+        if (sym == "[unknown]")
+            sym = "[" dso "]"
+        else if (dso ~ /^\[/ && dso != "[kernel.kallsyms]")
+            sym = sym " " dso
+        frame[++depth] = sym
+        next
+    }
+    /^$/ { flush_stack() }
+    END {
+        flush_stack()
+        for (s in count)
+            print s, count[s]
+    }'
+}
+
+#
+# top_self - self-time share per leaf frame, "percent<TAB>symbol", every
+# symbol, largest first
+#
+top_self() {
+    awk '
+    {
+        n = $NF
+        $NF = ""
+        sub(/ $/, "")
+        k = split($0, f, ";")
+        self[f[k]] += n
+        total += n
+    }
+    END {
+        for (s in self)
+            printf "%.2f\t%s\n", 100.0 * self[s] / total, s
+    }' "$1" | sort -t "$(printf '\t')" -k1,1 -rn
+}
+
+#
+# diff_top - percentage-point change per symbol against the baseline
+# Takes full self-time tables, so symbols entering or leaving the top N
+# keep their real share on both sides
+#
+diff_top() {
+    echo -e "delta\tbase%\tnow%\tsymbol"
+    awk -F '\t' '
+    NR == FNR { base[$2] = $1; seen[$2] = 1; next }
+    { cur[$2] = $1; seen[$2] = 1 }
+    END {
+        # Leading absolute delta sorts the largest movements first
+        for (s in seen) {
+            d = cur[s] - base[s]
+            printf "%.2f\t%+.2f\t%.2f\t%.2f\t%s\n", d < 0 ? -d : d, d, base[s], cur[s], s
+        }
+    }' "$1" "$2" | sort -t "$(printf '\t')" -k1,1 -rg | cut -f 2-
+}
+
+# Run every scenario
+for period in $PERIODS; do
+    for readers in $READERS; do
+        name="p${period}ms_r${readers}"
+        echo -e "\n${BLUE}[$name]${NC} sampling_ms=$period, readers=$readers, ${DURATION}s"
+
+        echo "$period" > "$SYSFS_PATH/sampling_ms"
+
+        READER_PIDS=""
+        for i in $(seq "$readers"); do
+            dd if=/dev/simtemp of=/dev/null bs=4096 status=none &
+            READER_PIDS="$READER_PIDS $!"
+        done
+        sleep 1
+
+        cp "$SYSFS_PATH/stats" "$OUT_DIR/$name.stats.before"
+        perf record -q -a -g -o "$OUT_DIR/$name.data" -- sleep "$DURATION" 2>/dev/null
+        cp "$SYSFS_PATH/stats" "$OUT_DIR/$name.stats.after"
+
+        kill $READER_PIDS 2>/dev/null || true
+        wait $READER_PIDS 2>/dev/null || true
+        READER_PIDS=""
+
+        perf script -i "$OUT_DIR/$name.data" --kallsyms="$OUT_DIR/kallsyms" 2>/dev/null |
+            fold_stacks > "$OUT_DIR/$name.folded"
+        info "Folded stacks: $name.folded ($(wc -l < "$OUT_DIR/$name.folded") unique)"
+
+        if [ -n "$FLAMEGRAPH" ]; then
+            $FLAMEGRAPH --title "simtemp $name" "$OUT_DIR/$name.folded" > "$OUT_DIR/$name.svg"
+            info "Flame graph: $name.svg"
+        fi
+
+        top_self "$OUT_DIR/$name.folded" > "$OUT_DIR/$name.self"
+        head -n "$TOP_N" "$OUT_DIR/$name.self" > "$OUT_DIR/$name.top"
+        echo "Top $TOP_N by self time:"
+        column -t -s "$(printf '\t')" "$OUT_DIR/$name.top" | sed 's/^/    /'
+
+        if [ -n "$BASELINE_DIR" ]; then
+            if [ -f "$BASELINE_DIR/$name.self" ]; then
+                diff_top "$BASELINE_DIR/$name.self" "$OUT_DIR/$name.self" > "$OUT_DIR/$name.diff"
+                echo "Change against baseline (percentage points):"
+                head -n $((TOP_N + 1)) "$OUT_DIR/$name.diff" |
+                    column -t -s "$(printf '\t')" | sed 's/^/    /'
+            else
+                warn "No baseline for $name in $BASELINE_DIR (no $name.self)"
+            fi
+        fi
+    done
+done
+
+echo -e "\n${GREEN}✓ Profiling complete:${NC} $OUT_DIR"
@@ -0,0 +1,464 @@
+#!/usr/bin/env python3
+"""
+NXP SimTemp Python Consumer Benchmarks
+CPU cost and throughput ceiling of the CLI and GUI consumer paths
+
+Synthetic samples are fed through a memfd or a pipe in place of
+/dev/simtemp, so the real SimTempDevice, DeviceReader,
+SimTempMonitor._update_temperature and LiveDataPanel code runs unchanged
+and no kernel module is needed.
+
+pyperf benchmarks (per sample unless noted):
+    read_block[N]               SimTempDevice.read_block() of N samples
+    decode[N]                   Iterating a block as TemperatureSample (CLI monitor)
+    device_reader[N]            DeviceReader thread: poll, read, queue hand-off
+    update_temperature@RATE     One GUI frame at RATE Hz: _update_temperature()
+                                plus the Tk redraw (per frame)
+    live_data_panel             LiveDataPanel.update_temperatures() plus redraw
+                                of a full plot (per frame)
+
+Rate sweep (--sweep, outside pyperf): a paced writer feeds the pipe at
+increasing rates while DeviceReader and the monitor's frame loop consume
+it. Reports CPU per sample, delivered fraction and frame time per rate,
+and the highest rate delivered without loss. Results are appended to
+perf_results/python_sweep.csv.
+
+Usage:
+    python3 bench_python.py -o before.json          # pyperf suite
+    python3 bench_python.py --fast --no-gui
+    python3 -m pyperf compare_to before.json after.json
+    python3 bench_python.py --sweep                 # throughput ceiling
+
+The GUI benchmarks need a display (e.g. `xvfb-run python3 bench_python.py`)
+and are skipped without one.
+"""
+
+import fcntl
+import os
+import statistics
+import struct
+import subprocess
+import sys
+import threading
+import time
+from datetime import datetime
+from pathlib import Path
+
+PROJECT_ROOT = Path(__file__).resolve().parent.parent.parent
+sys.path.insert(0, str(PROJECT_ROOT / "user" / "cli"))
+sys.path.insert(0, str(PROJECT_ROOT / "user" / "gui"))
+
+from simtemp_device import (  # noqa: E402
+    SimTempDevice,
+    SampleBlock,
+    SAMPLE_FORMAT,
+    SAMPLE_SIZE,
+    FLAG_NEW_SAMPLE,
+    FLAG_THRESHOLD_CROSSED,
+)
+from core.device_reader import DeviceReader  # noqa: E402
+from core.running_stats import RunningStats  # noqa: E402
+
+# Samples per read() / per pyperf call
+BATCHES = (1, 16, 256)
+
+# Device rates of the GUI frame benchmarks and of the sweep
+FRAME_RATES = (100, 1000, 10000, 100000)
+SWEEP_RATES = (100, 1000, 10000, 50000, 100000, 200000, 500000, 1000000)
+
+# Sweep: seconds per rate, and the delivered fraction that counts as sustained
+SWEEP_SECONDS = 3.0
+SUSTAINED = 0.99
+
+F_SETPIPE_SZ = 1031
+PIPE_BYTES = 1 << 20
+
+
+def synthetic_samples(count: int, start_ns: int = 0, period_ns: int = 1000000,
+                      alert_every: int = 1000) -> bytes:
+    """Packed samples: a sawtooth around 45 °C, every Nth flagged as a crossing"""
+    return b"".join(
+        struct.pack(SAMPLE_FORMAT, start_ns + i * period_ns, 40000 + (i * 37) % 10000,
+                    FLAG_NEW_SAMPLE | (FLAG_THRESHOLD_CROSSED if i % alert_every == 0 else 0))
+        for i in range(count))
+
+
+def attach(device: SimTempDevice, fd: int) -> SimTempDevice:
+    """Make an unopened SimTempDevice read from fd instead of /dev/simtemp"""
+    device._fd = fd
+    device.record_size = SAMPLE_SIZE
+    return device
+
+
+def synthetic_pipe():
+    """Non-blocking read end, blocking write end, 1 MiB of buffering"""
+    r, w = os.pipe()
+    try:
+        fcntl.fcntl(w, F_SETPIPE_SZ, PIPE_BYTES)
+    except OSError:
+        pass  # Above fs.pipe-max-size: keep the default
+    os.set_blocking(r, False)
+    return r, w
+
+
+def start_reader(fd: int) -> DeviceReader:
+    """DeviceReader running its real thread loop on a synthetic fd"""
+    reader = DeviceReader()
+    attach(reader.device, fd)
+    reader._stop_event.clear()
+    reader._read_thread = threading.Thread(target=reader._read_loop, daemon=True)
+    reader._read_thread.start()
+    reader._running = True
+    return reader
+
+
+# CLI path
+
+def bench_read_block(loops: int, batch: int) -> float:
+    fd = os.memfd_create("simtemp-bench")
+    os.write(fd, synthetic_samples(batch))
+    device = attach(SimTempDevice(), fd)
+
+    start = time.perf_counter()
+    for _ in range(loops):
+        os.lseek(fd, 0, os.SEEK_SET)
+        device.read_block(batch)
+    elapsed = time.perf_counter() - start
+
+    device.close()
+    return elapsed
+
+
+def bench_decode(loops: int, batch: int) -> float:
+    block = SampleBlock(synthetic_samples(batch))
+
+    start = time.perf_counter()
+    for _ in range(loops):
+        for sample in block:
+            sample.temp_celsius
+            sample.is_threshold_crossed
+    return time.perf_counter() - start
+
+
+def bench_device_reader(loops: int, batch: int) -> float:
+    r, w = synthetic_pipe()
+    reader = start_reader(r)
+    data = synthetic_samples(batch)
+
+    start = time.perf_counter()
+    for _ in range(loops):
+        os.write(w, data)
+        got = 0
+        while got < batch:
+            block = reader.get_block(timeout=1.0)
+            if block is None:
+                raise RuntimeError("DeviceReader stalled")
+            got += len(block)
+    elapsed = time.perf_counter() - start
+
+    reader.stop()
+    os.close(w)
+    return elapsed
+
+
+# GUI path
+
+class _FrameRoot:
+    """Tk root whose after() does nothing: the benchmark drives the frames"""
+
+    def __init__(self, root):
+        self._root = root
+
+    def after(self, ms, func=None, *args):
+        return None
+
+    def __getattr__(self, name):
+        return getattr(self._root, name)
+
+
+class _FrameReader:
+    """DeviceReader stand-in handing out prepared frames of SampleBlocks"""
+
+    last_error = None
+
+    def __init__(self, frames: list):
+        self._frames = frames
+        self._next = 0
+
+    def get_all_blocks(self) -> list:
+        blocks = self._frames[self._next]
+        self._next = (self._next + 1) % len(self._frames)
+        return blocks
+
+    def get_counters(self):
+        return None
+
+
+_gui = {}
+
+
+def gui_available() -> bool:
+    if "root" not in _gui:
+        try:
+            import tkinter as tk
+            _gui["root"] = tk.Tk()
+        except Exception:
+            _gui["root"] = None
+    return _gui["root"] is not None
+
+
+def gui_monitor():
+    """A SimTempMonitor with its window mapped but no device or timers"""
+    if "monitor" not in _gui:
+        from widgets.app import SimTempMonitor
+
+        class BenchMonitor(SimTempMonitor):
+            def _start_monitoring(self):
+                pass
+
+        root = _gui["root"]
+        monitor = BenchMonitor(root)
+        root.update()
+        monitor.root = _FrameRoot(root)
+        _gui["monitor"] = monitor
+    return _gui["monitor"]
+
+
+def frames_at(rate: int, count: int = 20) -> list:
+    """count frames of SampleBlocks as DeviceReader queues them at rate Hz"""
+    from widgets.app import SimTempMonitor
+
+    per_frame = max(1, rate * SimTempMonitor.FRAME_MS // 1000)
+    period_ns = 1000000000 // rate
+    data = synthetic_samples(per_frame * count, period_ns=period_ns)
+    chunk = DeviceReader.READ_BATCH * SAMPLE_SIZE
+    frame_bytes = per_frame * SAMPLE_SIZE
+
+    frames = []
+    for f in range(count):
+        frame = data[f * frame_bytes:(f + 1) * frame_bytes]
+        frames.append([SampleBlock(frame[i:i + chunk]) for i in range(0, len(frame), chunk)])
+    return frames
+
+
+def bench_update_temperature(loops: int, rate: int) -> float:
+    monitor = gui_monitor()
+    monitor.device_reader = _FrameReader(frames_at(rate))
+    root = _gui["root"]
+
+    start = time.perf_counter()
+    for _ in range(loops):
+        monitor._update_temperature()
+        root.update_idletasks()
+    return time.perf_counter() - start
+
+
+def bench_live_data_panel(loops: int) -> float:
+    from widgets.panels.live_data import LiveDataPanel
+
+    monitor = gui_monitor()
+    panel = monitor.live_data_panel
+    root = _gui["root"]
+    points = LiveDataPanel.HISTORY_POINTS
+    temps = [40.0 + (i * 37) % 10000 / 1000.0 for i in range(points)]
+    stamps = [i * 1000000 for i in range(points)]
+
+    start = time.perf_counter()
+    for _ in range(loops):
+        panel.update_temperatures(temps, stamps)
+        root.update_idletasks()
+    return time.perf_counter() - start
+
+
+# Rate sweep
+
+def _pace_writer(w: int, rate: int, seconds: float, result: dict) -> None:
+    """Write rate samples/s in 1 ms ticks on absolute deadlines"""
+    tick_ns = 1000000
+    data = synthetic_samples(max(1, rate // 100), period_ns=1000000000 // rate)
+    start = time.monotonic_ns()
+    end = start + int(seconds * 1e9)
+    cpu = time.thread_time()
+    written = 0
+    tick = start
+
+    while tick < end:
+        due = (tick - start + tick_ns) * rate // 1000000000 - written
+        while due > 0:
+            n = min(due, len(data) // SAMPLE_SIZE)
+            os.write(w, data[:n * SAMPLE_SIZE])
+            written += n
+            due -= n
+        tick += tick_ns
+        delay = tick - time.monotonic_ns()
+        if delay > 0:
+            time.sleep(delay / 1e9)
+
+    result["written"] = written
+    result["cpu"] = time.thread_time() - cpu
+    result["elapsed"] = (time.monotonic_ns() - start) / 1e9
+
+
+class _CountingReader:
+    """Passes a DeviceReader through, counting the samples frames take"""
+
+    def __init__(self, reader: DeviceReader):
+        self._reader = reader
+        self.delivered = 0
+
+    def get_all_blocks(self) -> list:
+        blocks = self._reader.get_all_blocks()
+        self.delivered += sum(len(block) for block in blocks)
+        return blocks
+
+    def __getattr__(self, name):
+        return getattr(self._reader, name)
+
+
+def sweep_rate(rate: int, seconds: float, use_gui: bool) -> dict:
+    """Feed rate samples/s for seconds through DeviceReader into frames"""
+    from widgets.app import SimTempMonitor
+
+    r, w = synthetic_pipe()
+    reader = start_reader(r)
+    counted = _CountingReader(reader)
+    stats = RunningStats(SimTempMonitor.AVERAGE_WINDOW)
+    monitor = gui_monitor() if use_gui else None
+    if monitor:
+        monitor.device_reader = counted
+
+    writer = {}
+    thread = threading.Thread(target=_pace_writer, args=(w, rate, seconds, writer))
+    cpu = time.process_time()
+    thread.start()
+
+    frame_ms = []
+    next_frame = time.monotonic()
+    idle_frames = 0
+    while thread.is_alive() or idle_frames < 3:
+        begin = time.perf_counter()
+        taken = counted.delivered
+        if monitor:
+            monitor._update_temperature()
+            _gui["root"].update_idletasks()
+        else:
+            # Headless: the frame handler's statistics work only
+            for block in counted.get_all_blocks():
+                stats.add_many(block.temps_mC.tolist())
+        frame_ms.append((time.perf_counter() - begin) * 1000)
+        idle_frames = 0 if counted.delivered > taken else idle_frames + 1
+
+        next_frame += SimTempMonitor.FRAME_MS / 1000
+        delay = next_frame - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+
+    thread.join()
+    reader.stop()
+    cpu = time.process_time() - cpu - writer["cpu"]
+    os.close(w)
+
+    delivered = counted.delivered
+    return {
+        "rate": rate,
+        "offered": writer["written"] / writer["elapsed"],
+        "delivered": delivered / max(1, writer["written"]),
+        "cpu_us": cpu * 1e6 / max(1, delivered),
+        "cpu_pct": 100 * cpu / writer["elapsed"],
+        "frame_p50": statistics.median(frame_ms),
+        "frame_p99": sorted(frame_ms)[min(len(frame_ms) - 1, int(len(frame_ms) * 0.99))],
+    }
+
+
+def run_sweep(seconds: float, use_gui: bool) -> None:
+    mode = "GUI frames" if use_gui else "headless frames"
+    print(f"Rate sweep ({mode}, {seconds:.0f} s per rate)")
+    print(f"  {'rate/s':>8s} {'offered':>9s} {'delivered':>9s} {'us/sample':>9s} "
+          f"{'cpu %':>6s} {'frame p50':>9s} {'p99 ms':>7s}")
+
+    rows = []
+    best = 0
+    failures = 0
+    for rate in SWEEP_RATES:
+        row = sweep_rate(rate, seconds, use_gui)
+        rows.append(row)
+        sustained = (row["delivered"] >= SUSTAINED and
+                     row["offered"] >= SUSTAINED * rate)
+        print(f"  {rate:8d} {row['offered']:9.0f} {100 * row['delivered']:8.1f}% "
+              f"{row['cpu_us']:9.2f} {row['cpu_pct']:6.1f} {row['frame_p50']:9.2f} "
+              f"{row['frame_p99']:7.2f}" + ("" if sustained else "  (not sustained)"))
+        if sustained:
+            best = rate
+            failures = 0
+        else:
+            failures += 1
+            if failures == 2:
+                break
+
+    print(f"Max sustainable rate: {best} samples/s")
+
+    # Appended like scripts/bench_startup.sh, to track across commits
+    results = PROJECT_ROOT / "perf_results"
+    results.mkdir(exist_ok=True)
+    history = results / "python_sweep.csv"
+    try:
+        commit = subprocess.run(["git", "-C", str(PROJECT_ROOT), "rev-parse", "--short", "HEAD"],
+                                capture_output=True, text=True).stdout.strip() or "unknown"
+    except OSError:
+        commit = "unknown"
+    new = not history.exists()
+    with open(history, "a") as f:
+        if new:
+            f.write("date,commit,python,mode,rate,offered,delivered,cpu_us_per_sample,"
+                    "frame_p50_ms,frame_p99_ms,max_sustained\n")
+        stamp = datetime.now().strftime("%Y-%m-%dT%H:%M:%S")
+        python = ".".join(map(str, sys.version_info[:3]))
+        for row in rows:
+            f.write(f"{stamp},{commit},{python},{'gui' if use_gui else 'headless'},{row['rate']},"
+                    f"{row['offered']:.0f},{row['delivered']:.4f},{row['cpu_us']:.3f},"
+                    f"{row['frame_p50']:.3f},{row['frame_p99']:.3f},{best}\n")
+    print(f"Recorded in {history}")
+
+
+def add_cmdline_args(cmd: list, args) -> None:
+    """Forward our options to the pyperf worker processes"""
+    if args.no_gui:
+        cmd.append("--no-gui")
+
+
+def main() -> None:
+    import pyperf
+
+    runner = pyperf.Runner(add_cmdline_args=add_cmdline_args)
+    runner.argparser.add_argument("--no-gui", action="store_true",
+                                  help="Skip the Tk benchmarks")
+    runner.argparser.add_argument("--sweep", action="store_true",
+                                  help="Run the rate sweep instead of the pyperf suite")
+    runner.argparser.add_argument("--sweep-seconds", type=float, default=SWEEP_SECONDS,
+                                  help="Seconds per rate in the sweep")
+    args = runner.parse_args()
+
+    use_gui = not args.no_gui and gui_available()
+    if not args.no_gui and not use_gui and not args.worker:
+        print("No display: skipping the GUI benchmarks (try xvfb-run)", file=sys.stderr)
+
+    if args.sweep:
+        # Not a pyperf benchmark: run once, in this process
+        if not args.worker:
+            run_sweep(args.sweep_seconds, use_gui)
+        return
+
+    for batch in BATCHES:
+        runner.bench_time_func(f"read_block[{batch}]", bench_read_block, batch, inner_loops=batch)
+        runner.bench_time_func(f"decode[{batch}]", bench_decode, batch, inner_loops=batch)
+        runner.bench_time_func(f"device_reader[{batch}]", bench_device_reader, batch,
+                               inner_loops=batch)
+
+    if use_gui:
+        for rate in FRAME_RATES:
+            runner.bench_time_func(f"update_temperature@{rate}Hz", bench_update_temperature, rate)
+        runner.bench_time_func("live_data_panel", bench_live_data_panel)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,467 @@
+#!/usr/bin/env python3
+"""
+NXP SimTemp Sample Archive
+Segmented on-disk archive of recorded samples with rollup tiers
+
+Layout (timestamps are CLOCK_REALTIME ns; <start> is the first second of
+the file, 20 digits so names sort by time):
+
+    raw/<start>.bin     Full-rate struct simtemp_sample records (the format
+                        read() returns and `simtemp replay` plays back)
+    raw/<start>.sum     One rollup per second of that segment
+    events/<start>.bin  Full-rate samples around threshold crossings
+    1s/<start>.roll     Per-second rollups of compacted segments
+    1m/<start>.roll     Per-minute rollups
+
+The recorder writes the per-second rollups while it records, so
+compaction works from them: an aged raw segment becomes its .sum renamed
+into 1s/, plus the event windows cut from the seconds whose rollup counts
+threshold crossings. Aged 1 s files are folded 60:1 into 1m/. Files are
+only ever created, renamed or deleted, never rewritten, so compaction
+can run in the background of a recorder and survive being killed.
+
+Each tier has an age and a size budget. Exceeding it demotes the oldest
+files to the next tier (raw -> 1s -> 1m) or, for the last tiers (events,
+1m), deletes them.
+
+Queries bisect the sorted file names, then the fixed-size records inside
+each file, so their cost depends on the span asked for and not on how
+large the archive has grown.
+
+Example:
+    archive = Archive("/var/lib/simtemp")
+    with SimTempDevice() as device, Recorder(archive) as recorder:
+        recorder.add_block(device.read_block())
+    archive.compact()
+    for r in archive.rollups(start_ns, end_ns, step_ns=60 * SECOND_NS):
+        print(r.start_ns, r.min_mC, r.max_mC, r.mean_mC)
+"""
+
+import bisect
+import os
+import struct
+import time
+from dataclasses import dataclass
+from typing import Dict, Optional
+
+from simtemp_device import SampleBlock, SAMPLE_FORMAT, SAMPLE_SIZE, FLAG_THRESHOLD_CROSSED
+
+SECOND_NS = 1000000000
+MINUTE_NS = 60 * SECOND_NS
+
+# struct rollup: start_ns, count, min_mC, max_mC, sum_mC, events
+ROLLUP_FORMAT = "=QIiiqI"
+ROLLUP_SIZE = struct.calcsize(ROLLUP_FORMAT)
+
+# Tier directories
+TIERS = ("raw", "events", "1s", "1m")
+
+# Full-rate samples kept on each side of a threshold crossing
+EVENT_WINDOW_S = 5.0
+
+
+@dataclass
+class Rollup:
+    """Aggregate of the samples of one bucket"""
+
+    start_ns: int
+    count: int = 0
+    min_mC: int = 0
+    max_mC: int = 0
+    sum_mC: int = 0
+    events: int = 0
+
+    @property
+    def mean_mC(self) -> int:
+        return self.sum_mC // self.count if self.count else 0
+
+    def add(self, temp_mC: int, flags: int) -> None:
+        if not self.count or temp_mC < self.min_mC:
+            self.min_mC = temp_mC
+        if not self.count or temp_mC > self.max_mC:
+            self.max_mC = temp_mC
+        self.count += 1
+        self.sum_mC += temp_mC
+        self.events += bool(flags & FLAG_THRESHOLD_CROSSED)
+
+    def merge(self, other: "Rollup") -> None:
+        if not other.count:
+            return
+        if not self.count or other.min_mC < self.min_mC:
+            self.min_mC = other.min_mC
+        if not self.count or other.max_mC > self.max_mC:
+            self.max_mC = other.max_mC
+        self.count += other.count
+        self.sum_mC += other.sum_mC
+        self.events += other.events
+
+    def pack(self) -> bytes:
+        return struct.pack(ROLLUP_FORMAT, self.start_ns, self.count, self.min_mC,
+                           self.max_mC, self.sum_mC, self.events)
+
+
+@dataclass
+class Budget:
+    """Retention budget of one tier (None = unlimited)"""
+
+    max_age_s: Optional[float] = None
+    max_bytes: Optional[int] = None
+
+
+DEFAULT_POLICY = {
+    "raw": Budget(max_age_s=86400),
+    "events": Budget(max_age_s=30 * 86400),
+    "1s": Budget(max_age_s=7 * 86400),
+    "1m": Budget(max_age_s=365 * 86400),
+}
+
+
+def _file_name(start_ns: int, ext: str) -> str:
+    return f"{start_ns:020d}{ext}"
+
+
+def _read_rollups(path: str, first: int = 0, count: Optional[int] = None) -> list:
+    with open(path, "rb") as f:
+        f.seek(first * ROLLUP_SIZE)
+        data = f.read(-1 if count is None else count * ROLLUP_SIZE)
+    usable = len(data) - len(data) % ROLLUP_SIZE
+    return [Rollup(*fields) for fields in struct.iter_unpack(ROLLUP_FORMAT, data[:usable])]
+
+
+def _bisect_records(f, size: int, record_size: int, key_ns: int) -> int:
+    """Index of the first record whose leading u64 is >= key_ns"""
+    low, high = 0, size // record_size
+    while low < high:
+        mid = (low + high) // 2
+        f.seek(mid * record_size)
+        if struct.unpack("=Q", f.read(8))[0] < key_ns:
+            low = mid + 1
+        else:
+            high = mid
+    return low
+
+
+def _write_atomic(path: str, data: bytes) -> None:
+    tmp = path + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(data)
+        f.flush()
+        os.fsync(f.fileno())
+    os.replace(tmp, path)
+
+
+class Archive:
+    """An archive directory: tier listing, compaction and queries"""
+
+    def __init__(self, path: str, policy: Optional[Dict[str, Budget]] = None,
+                 event_window_s: float = EVENT_WINDOW_S):
+        self.path = path
+        self.policy = dict(DEFAULT_POLICY)
+        self.policy.update(policy or {})
+        self.event_window_ns = int(event_window_s * SECOND_NS)
+        self._listing = {}  # (tier, ext) -> (dir mtime, sorted starts)
+
+        for tier in TIERS:
+            os.makedirs(os.path.join(path, tier), exist_ok=True)
+
+    def file(self, tier: str, start_ns: int, ext: str) -> str:
+        return os.path.join(self.path, tier, _file_name(start_ns, ext))
+
+    def starts(self, tier: str, ext: str) -> list:
+        """Sorted start times of a tier's files (cached until the directory changes)"""
+        directory = os.path.join(self.path, tier)
+        mtime = os.stat(directory).st_mtime_ns
+        cached = self._listing.get((tier, ext))
+        if cached and cached[0] == mtime:
+            return cached[1]
+
+        starts = sorted(int(name[:20]) for name in os.listdir(directory)
+                        if name.endswith(ext) and len(name) == 20 + len(ext))
+        self._listing[(tier, ext)] = (mtime, starts)
+        return starts
+
+    def tier_bytes(self, tier: str) -> int:
+        directory = os.path.join(self.path, tier)
+        return sum(entry.stat().st_size for entry in os.scandir(directory) if entry.is_file())
+
+    # Compaction
+
+    def compact(self, now_ns: Optional[int] = None) -> Dict[str, int]:
+        """
+        Apply the retention policy once; returns files moved per tier
+
+        The newest raw segment is left alone, a recorder may be appending
+        to it. Safe to call while recording and after an interruption.
+        """
+        now_ns = now_ns or time.time_ns()
+        done = {tier: 0 for tier in TIERS}
+
+        for tier, ext in (("raw", ".bin"), ("1s", ".roll"), ("events", ".bin"), ("1m", ".roll")):
+            budget = self.policy.get(tier, Budget())
+            starts = self.starts(tier, ext)
+            # A raw segment ends where the next begins; the newest is never due
+            candidates = starts[:-1] if tier == "raw" else starts
+
+            total = self.tier_bytes(tier) if budget.max_bytes is not None else 0
+            for i, start in enumerate(candidates):
+                end = starts[i + 1] if i + 1 < len(starts) else self._file_end(tier, start, ext)
+                aged = budget.max_age_s is not None and end <= now_ns - budget.max_age_s * SECOND_NS
+                over = budget.max_bytes is not None and total > budget.max_bytes
+                if not aged and not over:
+                    break
+
+                total -= self._retire(tier, start, ext)
+                done[tier] += 1
+
+        return done
+
+    def _file_end(self, tier: str, start_ns: int, ext: str) -> int:
+        """Time just after the last sample of a file"""
+        path = self.file(tier, start_ns, ext)
+        if tier == "events":
+            size = os.path.getsize(path)
+            with open(path, "rb") as f:
+                f.seek(size - size % SAMPLE_SIZE - SAMPLE_SIZE)
+                return struct.unpack("=Q", f.read(8))[0] + 1
+
+        last = _read_rollups(path, max(0, os.path.getsize(path) // ROLLUP_SIZE - 1))
+        step = MINUTE_NS if tier == "1m" else SECOND_NS
+        return (last[0].start_ns if last else start_ns) + step
+
+    def _retire(self, tier: str, start_ns: int, ext: str) -> int:
+        """Demote or delete one file; returns the bytes freed in the tier"""
+        path = self.file(tier, start_ns, ext)
+        freed = os.path.getsize(path)
+
+        if tier == "raw":
+            freed += self._compact_segment(start_ns)
+        elif tier == "1s":
+            self._fold_minutes(start_ns)
+
+        os.unlink(path)
+        return freed
+
+    def _compact_segment(self, start_ns: int) -> int:
+        """Move a raw segment's rollups to 1s/ and keep its event windows"""
+        raw = self.file("raw", start_ns, ".bin")
+        summary = self.file("raw", start_ns, ".sum")
+        target = self.file("1s", start_ns, ".roll")
+        freed = 0
+
+        # Interrupted after the rename: only the raw data is left to delete
+        if os.path.exists(target):
+            if os.path.exists(summary):
+                freed = os.path.getsize(summary)
+                os.unlink(summary)
+            return freed
+
+        rollups = _read_rollups(summary) if os.path.exists(summary) else []
+        samples = os.path.getsize(raw) // SAMPLE_SIZE
+        if sum(r.count for r in rollups) != samples:
+            # Recorder killed mid-second, or an imported capture
+            rollups = self._summarize(raw)
+            if os.path.exists(summary):
+                os.unlink(summary)
+            _write_atomic(summary, b"".join(r.pack() for r in rollups))
+
+        self._save_events(start_ns, raw, rollups)
+
+        freed = os.path.getsize(summary)
+        os.replace(summary, target)
+        return freed
+
+    @staticmethod
+    def _summarize(raw: str) -> list:
+        rollups = []
+        with open(raw, "rb") as f:
+            while True:
+                data = f.read(4096 * SAMPLE_SIZE)
+                if len(data) < SAMPLE_SIZE:
+                    break
+                for ts, temp, flags in struct.iter_unpack(SAMPLE_FORMAT,
+                                                          data[:len(data) - len(data) % SAMPLE_SIZE]):
+                    second = ts - ts % SECOND_NS
+                    if not rollups or second > rollups[-1].start_ns:
+                        rollups.append(Rollup(second))
+                    rollups[-1].add(temp, flags)
+        return rollups
+
+    def _save_events(self, start_ns: int, raw: str, rollups: list) -> None:
+        """Copy the samples within event_window_ns of a crossing to events/"""
+        if not any(r.events for r in rollups):
+            return
+
+        first = [0]
+        for r in rollups:
+            first.append(first[-1] + r.count)
+        seconds = [r.start_ns for r in rollups]
+
+        def read_seconds(f, lo: int, hi: int) -> bytes:
+            f.seek(first[lo] * SAMPLE_SIZE)
+            return f.read((first[hi] - first[lo]) * SAMPLE_SIZE)
+
+        out = []
+        with open(raw, "rb") as f:
+            # Exact crossing times, read only from the seconds that have one
+            windows = []
+            for i, r in enumerate(rollups):
+                if not r.events:
+                    continue
+                for ts, _, flags in struct.iter_unpack(SAMPLE_FORMAT, read_seconds(f, i, i + 1)):
+                    if flags & FLAG_THRESHOLD_CROSSED:
+                        low, high = ts - self.event_window_ns, ts + self.event_window_ns
+                        if windows and low <= windows[-1][1]:
+                            windows[-1][1] = max(windows[-1][1], high)
+                        else:
+                            windows.append([low, high])
+
+            for low, high in windows:
+                lo = max(0, bisect.bisect_right(seconds, low) - 1)
+                hi = bisect.bisect_right(seconds, high)
+                data = read_seconds(f, lo, hi)
+                out.extend(data[i:i + SAMPLE_SIZE] for i in range(0, len(data), SAMPLE_SIZE)
+                           if low <= struct.unpack_from("=Q", data, i)[0] <= high)
+
+        if out:
+            _write_atomic(self.file("events", start_ns, ".bin"), b"".join(out))
+
+    def _fold_minutes(self, start_ns: int) -> None:
+        minutes = []
+        for r in _read_rollups(self.file("1s", start_ns, ".roll")):
+            minute = r.start_ns - r.start_ns % MINUTE_NS
+            if not minutes or minute > minutes[-1].start_ns:
+                minutes.append(Rollup(minute))
+            minutes[-1].merge(r)
+
+        target = self.file("1m", start_ns - start_ns % MINUTE_NS, ".roll")
+        if os.path.exists(target):
+            # A 1 s file starting in the same minute was folded before
+            target = self.file("1m", start_ns, ".roll")
+        _write_atomic(target, b"".join(m.pack() for m in minutes))
+
+    # Queries
+
+    def _records(self, tier: str, ext: str, record_size: int, span_ns: int,
+                 start_ns: int, end_ns: int) -> list:
+        """Raw record bytes with leading timestamp in [start_ns, end_ns)"""
+        starts = self.starts(tier, ext)
+        # The file before the first one starting in range may reach into it
+        i = max(0, bisect.bisect_right(starts, start_ns) - 1)
+        chunks = []
+        for start in starts[i:]:
+            if start >= end_ns:
+                break
+            path = self.file(tier, start, ext)
+            try:
+                with open(path, "rb") as f:
+                    size = os.fstat(f.fileno()).st_size
+                    lo = _bisect_records(f, size, record_size, start_ns - span_ns + 1)
+                    hi = _bisect_records(f, size, record_size, end_ns)
+                    f.seek(lo * record_size)
+                    chunks.append(f.read((hi - lo) * record_size))
+            except FileNotFoundError:
+                continue  # Compacted under us; the next tier has it
+        return chunks
+
+    def rollups(self, start_ns: int, end_ns: int, step_ns: int = SECOND_NS) -> list:
+        """
+        min/max/mean of [start_ns, end_ns) in buckets of step_ns, from
+        whichever tier holds each part (1 min data stays per-minute when
+        step_ns is smaller)
+        """
+        buckets = {}
+        sources = (("1m", ".roll", MINUTE_NS), ("1s", ".roll", SECOND_NS), ("raw", ".sum", SECOND_NS))
+        for tier, ext, span in sources:
+            for chunk in self._records(tier, ext, ROLLUP_SIZE, span, start_ns, end_ns):
+                for fields in struct.iter_unpack(ROLLUP_FORMAT, chunk):
+                    r = Rollup(*fields)
+                    key = r.start_ns - r.start_ns % max(step_ns, span)
+                    bucket = buckets.get(key)
+                    if bucket is None:
+                        bucket = buckets[key] = Rollup(key)
+                    bucket.merge(r)
+        return [buckets[key] for key in sorted(buckets)]
+
+    def samples(self, start_ns: int, end_ns: int) -> SampleBlock:
+        """Full-rate samples of [start_ns, end_ns): raw segments and event windows"""
+        chunks = self._records("events", ".bin", SAMPLE_SIZE, 1, start_ns, end_ns)
+        chunks += self._records("raw", ".bin", SAMPLE_SIZE, 1, start_ns, end_ns)
+        return SampleBlock(b"".join(chunks))
+
+
+class Recorder:
+    """
+    Appends samples to the archive's newest raw segment
+
+    Device timestamps (CLOCK_MONOTONIC) are rebased to CLOCK_REALTIME.
+    Segments start on multiples of segment_s (a multiple of 60, so no
+    minute spans two segments); the rollup of each second is appended to
+    the segment's .sum once the second is over.
+    """
+
+    def __init__(self, archive: Archive, segment_s: int = 3600):
+        if segment_s <= 0 or segment_s % 60:
+            raise ValueError(f"Segment length must be a multiple of 60 s, got {segment_s}")
+        self.archive = archive
+        self.segment_s = segment_s
+        self.offset_ns = time.time_ns() - time.monotonic_ns()
+        self._raw = None
+        self._summary = None
+        self._segment_end = 0
+        self._second = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def close(self) -> None:
+        self._close_second()
+        for f in (self._raw, self._summary):
+            if f:
+                f.close()
+        self._raw = self._summary = None
+
+    def _close_second(self) -> None:
+        if self._second and self._second.count:
+            self._summary.write(self._second.pack())
+            self._summary.flush()
+        self._second = None
+
+    def _open_segment(self, second_ns: int) -> None:
+        self.close()
+        segment_ns = self.segment_s * SECOND_NS
+        start = second_ns - second_ns % segment_ns
+        self._raw = open(self.archive.file("raw", start, ".bin"), "ab")
+        self._summary = open(self.archive.file("raw", start, ".sum"), "ab")
+        self._segment_end = start + segment_ns
+
+    def add_block(self, block: SampleBlock) -> None:
+        out = []
+        for i in range(len(block)):
+            ts = block.timestamps_ns[i] + self.offset_ns
+            temp, flags = block.temps_mC[i], block.flags[i]
+            second = ts - ts % SECOND_NS
+
+            if ts >= self._segment_end:
+                if out:
+                    self._raw.write(b"".join(out))
+                    out = []
+                self._open_segment(second)
+
+            if self._second is None or second > self._second.start_ns:
+                # Raw data first: a .sum never counts samples not on disk
+                if out:
+                    self._raw.write(b"".join(out))
+                    self._raw.flush()
+                    out = []
+                self._close_second()
+                self._second = Rollup(second)
+
+            self._second.add(temp, flags)
+            out.append(struct.pack(SAMPLE_FORMAT, ts, temp, flags))
+
+        if out:
+            self._raw.write(b"".join(out))
+            self._raw.flush()
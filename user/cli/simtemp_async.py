@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+NXP SimTemp asyncio Interface
+Thread-free streaming from /dev/simtemp for asyncio applications
+
+One event loop can follow many devices: each device registers its
+non-blocking fd with loop.add_reader() and hands whole sample blocks
+(one read() each) to its subscribers.
+
+Example:
+    async with AsyncSimTempDevice() as device:
+        async for block in device.stream():
+            print(len(block), max(block.temps_mC))
+"""
+
+import asyncio
+import os
+from typing import Optional, Set
+
+from simtemp_device import (
+    SimTempDevice,
+    SampleBlock,
+    TemperatureSample,
+    SAMPLE_SIZE,
+    DEVICE_PATH,
+    SYSFS_BASE,
+)
+
+
+class AsyncSimTempDevice:
+    """asyncio front-end for one /dev/simtemp instance"""
+
+    def __init__(self, device_path: str = DEVICE_PATH, sysfs_base: str = SYSFS_BASE,
+                 max_batch: int = 256, queue_blocks: int = 64):
+        """
+        Args:
+            device_path: Character device to follow
+            sysfs_base: Sysfs directory of the device (for configuration)
+            max_batch: Maximum samples fetched by one read()
+            queue_blocks: Blocks buffered per subscriber before the oldest is dropped
+        """
+        self.device_path = device_path
+        self.max_batch = max_batch
+        self.queue_blocks = queue_blocks
+
+        # Synchronous interface, used for sysfs configuration only
+        self.sysfs = SimTempDevice(device_path, sysfs_base)
+
+        self._fd: Optional[int] = None
+        self._record_size = SAMPLE_SIZE
+        self._loop: Optional[asyncio.AbstractEventLoop] = None
+        self._streams: Set[asyncio.Queue] = set()
+        self._event_queues: Set[asyncio.Queue] = set()
+        self._threshold_waiters: Set[asyncio.Future] = set()
+
+        # Statistics
+        self.samples_read = 0
+        self.blocks_read = 0
+        self.blocks_dropped = 0
+
+    async def __aenter__(self):
+        self.open()
+        return self
+
+    async def __aexit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def open(self) -> None:
+        """Open the device non-blocking and register it with the running loop"""
+        if self._fd is not None:
+            raise RuntimeError("Device already open")
+
+        if not os.path.exists(self.device_path):
+            raise FileNotFoundError(f"Device not found: {self.device_path}")
+
+        self._loop = asyncio.get_running_loop()
+        self._fd = os.open(self.device_path, os.O_RDONLY | os.O_NONBLOCK)
+
+        # Frame mode: records carry a payload, fixed while the device is open
+        try:
+            self._record_size = SAMPLE_SIZE + self.sysfs.get_payload_bytes()
+        except (OSError, ValueError):
+            self._record_size = SAMPLE_SIZE
+
+        self._loop.add_reader(self._fd, self._on_readable)
+
+    def close(self) -> None:
+        """Unregister from the loop, close the fd and end all streams"""
+        if self._fd is None:
+            return
+
+        self._loop.remove_reader(self._fd)
+        os.close(self._fd)
+        self._fd = None
+
+        # None tells stream()/events() consumers that the device is gone
+        for queue in self._streams | self._event_queues:
+            self._put_latest(queue, None)
+        for waiter in self._threshold_waiters:
+            if not waiter.done():
+                waiter.set_exception(EOFError("Device closed"))
+        self._threshold_waiters.clear()
+
+    def _on_readable(self) -> None:
+        """Drain the device and dispatch blocks; runs inside the event loop"""
+        while self._fd is not None:
+            try:
+                data = os.read(self._fd, self.max_batch * self._record_size)
+            except BlockingIOError:
+                return
+            except InterruptedError:
+                continue
+
+            if not data:
+                return
+
+            block = SampleBlock(data, self._record_size)
+            self.blocks_read += 1
+            self.samples_read += len(block)
+
+            for queue in self._streams:
+                self._put_latest(queue, block)
+
+            if self._event_queues or self._threshold_waiters:
+                self._dispatch_events(block)
+
+            # Short read: ring drained, wait for the next readiness callback
+            if len(data) < self.max_batch * self._record_size:
+                return
+
+    def _dispatch_events(self, block: SampleBlock) -> None:
+        """Hand threshold samples to event subscribers and waiters"""
+        events = block.threshold_samples()
+        if not events:
+            return
+
+        for queue in self._event_queues:
+            for event in events:
+                self._put_latest(queue, event)
+
+        for waiter in self._threshold_waiters:
+            if not waiter.done():
+                waiter.set_result(events[0])
+        self._threshold_waiters.clear()
+
+    def _put_latest(self, queue: asyncio.Queue, item) -> None:
+        """Enqueue without blocking the loop, dropping the oldest entry if full"""
+        if queue.full():
+            queue.get_nowait()
+            self.blocks_dropped += 1
+        queue.put_nowait(item)
+
+    async def stream(self):
+        """
+        Async iterator over SampleBlock objects
+
+        Every concurrent stream() receives every block. Iteration ends when
+        the device is closed.
+        """
+        queue = asyncio.Queue(maxsize=self.queue_blocks)
+        self._streams.add(queue)
+        try:
+            while True:
+                block = await queue.get()
+                if block is None:
+                    return
+                yield block
+        finally:
+            self._streams.discard(queue)
+
+    async def events(self):
+        """Async iterator over threshold-crossing TemperatureSample events"""
+        queue = asyncio.Queue(maxsize=self.queue_blocks)
+        self._event_queues.add(queue)
+        try:
+            while True:
+                event = await queue.get()
+                if event is None:
+                    return
+                yield event
+        finally:
+            self._event_queues.discard(queue)
+
+    async def wait_threshold(self, timeout: Optional[float] = None) -> TemperatureSample:
+        """
+        Wait for the next threshold crossing
+
+        Raises:
+            asyncio.TimeoutError: No crossing within timeout seconds
+            EOFError: Device closed while waiting
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        waiter = self._loop.create_future()
+        self._threshold_waiters.add(waiter)
+        try:
+            return await asyncio.wait_for(waiter, timeout)
+        finally:
+            self._threshold_waiters.discard(waiter)
+
+
+async def follow_devices(device_paths, on_block):
+    """
+    Follow several devices from one event loop
+
+    Args:
+        device_paths: Iterable of character device paths
+        on_block: Callable on_block(device_path, block) for every SampleBlock
+    """
+    async def follow(path):
+        async with AsyncSimTempDevice(path) as device:
+            async for block in device.stream():
+                on_block(path, block)
+
+    await asyncio.gather(*(follow(path) for path in device_paths))
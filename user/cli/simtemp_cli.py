@@ -8,8 +8,9 @@ import click
 import sys
 import time
 import signal
+import struct
 from typing import Optional
-from simtemp_device import SimTempDevice, celsius_to_mC, mC_to_celsius
+from simtemp_device import SimTempDevice, EVENT_NAMES, celsius_to_mC, mC_to_celsius
 
 
 # Color definitions
@@ -174,10 +175,16 @@ def monitor(count: Optional[int], interval: Optional[float], no_color: bool, ver
               help='Set sampling period in milliseconds (10-10000)')
 @click.option('--threshold', type=float, metavar='CELSIUS',
               help='Set threshold in Celsius (-40.0 to 125.0)')
-@click.option('--mode', type=click.Choice(['normal', 'noisy', 'ramp'], case_sensitive=False),
+@click.option('--mode', type=click.Choice(['normal', 'noisy', 'ramp', 'plant', 'replay',
+                                           'scenario'], case_sensitive=False),
               help='Set temperature generation mode')
+@click.option('--shaping', metavar='SPEC',
+              help='Set delivery shaping, e.g. "jitter_us=500 burst=8 seed=1" or "off"')
+@click.option('--payload', type=int, metavar='BYTES',
+              help='Set frame payload per sample (0, or 64-65536 in steps of 16)')
 @click.option('--show', is_flag=True, help='Show current configuration')
-def config(sampling: Optional[int], threshold: Optional[float], mode: Optional[str], show: bool):
+def config(sampling: Optional[int], threshold: Optional[float], mode: Optional[str],
+           shaping: Optional[str], payload: Optional[int], show: bool):
     """
     Configure device parameters via sysfs
 
@@ -190,6 +197,8 @@ def config(sampling: Optional[int], threshold: Optional[float], mode: Optional[s
         simtemp config --threshold 45.5          # Set 45.5°C threshold
         simtemp config --mode noisy              # Set noisy mode
         simtemp config --mode ramp --sampling 50 # Multiple changes
+        simtemp config --shaping "stall_ms=500 stall_permille=2 seed=7"
+        simtemp config --payload 4096            # 4 KiB frames
     """
     check_device_availability()
 
@@ -197,12 +206,23 @@ def config(sampling: Optional[int], threshold: Optional[float], mode: Optional[s
 
     try:
         # Show current configuration
-        if show or (sampling is None and threshold is None and mode is None):
+        if show or (sampling is None and threshold is None and mode is None and
+                    shaping is None and payload is None):
             config_data = device.get_config()
             click.echo(colorize("\n📊 Current Configuration:", Colors.INFO, bold=True))
             click.echo(f"  Sampling Period: {config_data['sampling_ms']} ms")
             click.echo(f"  Threshold:       {config_data['threshold_celsius']:.1f}°C ({config_data['threshold_mC']} mC)")
             click.echo(f"  Mode:            {config_data['mode']}")
+            try:
+                shaping_data = device.get_shaping()
+                click.echo("  Shaping:         " +
+                           " ".join(f"{k}={v}" for k, v in shaping_data.items()))
+            except Exception:
+                pass
+            try:
+                click.echo(f"  Payload:         {device.get_payload_bytes()} bytes")
+            except Exception:
+                pass
             return
 
         # Apply changes
@@ -221,6 +241,14 @@ def config(sampling: Optional[int], threshold: Optional[float], mode: Optional[s
             device.set_mode(mode.lower())
             changes_made.append(f"mode={mode}")
 
+        if shaping is not None:
+            device.set_shaping(shaping)
+            changes_made.append(f"shaping={shaping}")
+
+        if payload is not None:
+            device.set_payload_bytes(payload)
+            changes_made.append(f"payload={payload}B")
+
         if changes_made:
             print_success(f"Configuration updated: {', '.join(changes_made)}")
         else:
@@ -298,6 +326,707 @@ def stats(watch: bool, interval: float):
         sys.exit(1)
 
 
+def _latency_run(samples: int, busy_poll_us: int) -> tuple:
+    """Sample-to-userspace latency (ns) of blocking single-sample reads"""
+    with SimTempDevice() as device:
+        device.set_busy_poll(busy_poll_us)
+
+        # Start from an empty ring so every read waits for a fresh sample
+        while device.poll(timeout_ms=0):
+            device.read_block()
+
+        latencies = []
+        while len(latencies) < samples and not interrupted:
+            sample = device.read_sample()
+            latencies.append(time.monotonic_ns() - sample.timestamp_ns)
+
+        info = device.fdinfo()
+
+    return latencies, info
+
+
+def _percentile(sorted_values: list, pct: float) -> int:
+    return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * pct / 100))]
+
+
+# Latency command
+@cli.command()
+@click.option('-n', '--samples', type=int, default=1000, help='Samples per run (default: 1000)')
+@click.option('-b', '--busy-poll', type=int, default=50,
+              help='Busy-poll budget in microseconds for the second run (default: 50)')
+def latency(samples: int, busy_poll: int):
+    """
+    Measure sample-to-userspace latency with and without busy polling
+
+    Runs blocking single-sample reads twice, sleeping (budget 0) and
+    spinning (--busy-poll), and prints the latency distribution of each:
+    time from the sample's kernel timestamp to read() returning.
+
+    Examples:
+        simtemp latency              # 1000 samples, 0 vs 50 us
+        simtemp latency -n 5000 -b 200
+    """
+    check_device_availability()
+
+    results = {}
+    try:
+        for budget in (0, busy_poll):
+            print_info(f"Measuring {samples} samples, busy poll {budget} us...")
+            results[budget] = _latency_run(samples, budget)
+    except KeyboardInterrupt:
+        click.echo("\n" + colorize("Stopped by user", Colors.WARNING))
+    except Exception as e:
+        print_error(f"Latency measurement failed: {e}")
+        sys.exit(1)
+
+    click.echo(colorize("\n⏱  Latency (us):", Colors.INFO, bold=True))
+    click.echo(f"  {'busy poll':>10s} {'p50':>9s} {'p90':>9s} {'p99':>9s} {'p99.9':>9s} "
+               f"{'max':>9s}  hits/misses/skips")
+    for budget, (values, info) in results.items():
+        if not values:
+            continue
+        values = sorted(values)
+        row = [_percentile(values, pct) / 1000 for pct in (50, 90, 99, 99.9)] + [values[-1] / 1000]
+        counters = "/".join(info.get(k, "-") for k in ("busy-hits", "busy-misses", "busy-skips"))
+        click.echo(f"  {budget:>7d} us " + " ".join(f"{v:9.1f}" for v in row) + f"  {counters}")
+
+
+# View command
+@cli.command()
+@click.option('--raw', 'decimate', type=int, metavar='N', help='Raw samples, every Nth')
+@click.option('--filtered', 'filter_shift', type=int, metavar='SHIFT',
+              help='Low-pass filtered samples, new-sample weight 1/2^SHIFT (1-8)')
+@click.option('--events', is_flag=True, help='Threshold crossings (device threshold) and jumps')
+@click.option('--hysteresis', type=float, default=1.0, metavar='CELSIUS',
+              help='Falling edge this far below the threshold (default: 1.0)')
+@click.option('--jump', type=float, default=0.0, metavar='CELSIUS',
+              help='Report steps of at least this size as events (default: off)')
+@click.option('--aggregates', 'window', type=int, metavar='N', help='min/max/mean every N samples')
+@click.option('-d', '--duration', type=float, default=None, help='Seconds to run (default: until Ctrl+C)')
+def view(decimate: Optional[int], filter_shift: Optional[int], events: bool, hysteresis: float,
+         jump: float, window: Optional[int], duration: Optional[float]):
+    """
+    Follow dedicated view streams of the device in one epoll loop
+
+    Every selected view is its own fd with its own ring, so only the
+    streams asked for are computed and each wakes up only when it has
+    something to deliver.
+
+    Examples:
+        simtemp view --events --jump 5             # alerts only
+        simtemp view --aggregates 100 --filtered 4 --raw 50
+    """
+    import select
+
+    check_device_availability()
+
+    if decimate is None and filter_shift is None and not events and window is None:
+        print_error("Select at least one view (--raw, --filtered, --events, --aggregates)")
+        sys.exit(1)
+
+    views = {}
+    try:
+        with SimTempDevice() as device:
+            if decimate is not None:
+                v = device.open_view("raw", non_blocking=True, decimate=decimate)
+                views[v.fileno()] = ("raw", v)
+            if filter_shift is not None:
+                v = device.open_view("filtered", non_blocking=True, filter_shift=filter_shift)
+                views[v.fileno()] = ("filtered", v)
+            if events:
+                v = device.open_view("events", non_blocking=True,
+                                     threshold_mC=device.get_threshold_mC(),
+                                     hysteresis_mC=celsius_to_mC(hysteresis),
+                                     jump_mC=celsius_to_mC(jump))
+                views[v.fileno()] = ("events", v)
+            if window is not None:
+                v = device.open_view("aggregates", non_blocking=True, window=window)
+                views[v.fileno()] = ("aggregates", v)
+
+            # The device fd itself is not needed any more
+            device.close()
+
+            epoll = select.epoll()
+            for fd in views:
+                epoll.register(fd, select.EPOLLIN)
+
+            end = None if duration is None else time.monotonic() + duration
+            while not interrupted and (end is None or time.monotonic() < end):
+                for fd, _ in epoll.poll(0.5):
+                    name, v = views[fd]
+                    try:
+                        records = v.read_records()
+                    except TimeoutError:
+                        continue
+
+                    for rec in records:
+                        if name in ("raw", "filtered"):
+                            click.echo(f"{name:>10s}  {rec}")
+                        elif name == "events":
+                            ts, temp_mC, kind = rec
+                            click.echo(colorize(f"{name:>10s}  {mC_to_celsius(temp_mC):6.2f}°C "
+                                                f"{EVENT_NAMES.get(kind, kind)}", Colors.ALERT))
+                        else:
+                            first_ns, last_ns, count, low, high, mean = rec
+                            click.echo(f"{name:>10s}  {count} samples over "
+                                       f"{(last_ns - first_ns) / 1e9:.2f}s: min {mC_to_celsius(low):.2f} "
+                                       f"max {mC_to_celsius(high):.2f} mean {mC_to_celsius(mean):.2f}°C")
+            epoll.close()
+
+    except KeyboardInterrupt:
+        pass
+    except Exception as e:
+        print_error(f"View failed: {e}")
+        sys.exit(1)
+    finally:
+        for _, v in views.values():
+            v.close()
+
+
+# Bandwidth command
+@cli.command()
+@click.option('-p', '--payload', type=click.IntRange(64, 65536), default=4096,
+              help='Payload bytes per frame (default: 4096)')
+@click.option('--sampling', type=int, default=1, metavar='MS', help='Sampling period (default: 1 ms)')
+@click.option('--inject', type=int, default=0, metavar='N',
+              help='Also inject N samples per read, each becoming a frame (default: 0)')
+@click.option('-d', '--duration', type=float, default=5.0, help='Seconds to run (default: 5)')
+@click.option('--verify', is_flag=True, help='Check the first and last payload word of every frame')
+def bandwidth(payload: int, sampling: int, inject: int, duration: float, verify: bool):
+    """
+    Measure read() throughput with large frames
+
+    Switches the device to frame mode (every sample carries --payload bytes
+    of generated data), reads in large batches and prints MB/s, frames/s
+    and frames lost to overruns. The device must not be open elsewhere.
+
+    Examples:
+        sudo simtemp bandwidth                       # 4 KiB at 1 kHz
+        sudo simtemp bandwidth -p 65536 --inject 64 --verify
+    """
+    check_device_availability()
+
+    device = SimTempDevice()
+    old_payload = device.get_payload_bytes()
+    old_sampling = device.get_sampling_ms()
+
+    frames = 0
+    total_bytes = 0
+    corrupt = 0
+    info = {}
+    start = time.monotonic()
+    try:
+        device.set_payload_bytes(payload)
+        device.set_sampling_ms(sampling)
+
+        device.open(writable=bool(inject))
+        words = payload // 8
+        start = time.monotonic()
+        end = start + duration
+
+        while time.monotonic() < end and not interrupted:
+            if inject:
+                device.inject_samples((45000, 0, 0) for _ in range(inject))
+
+            block = device.read_block(1024)
+            frames += len(block)
+            total_bytes += len(block.data)
+
+            if verify:
+                for i in range(len(block)):
+                    ts = block.timestamps_ns[i]
+                    first, = struct.unpack_from("=Q", block.payload(i))
+                    last, = struct.unpack_from("=Q", block.payload(i), payload - 8)
+                    corrupt += first != ts or last != ts + words - 1
+
+        info = device.fdinfo()
+
+    except KeyboardInterrupt:
+        pass
+    except Exception as e:
+        print_error(f"Bandwidth run failed: {e}")
+        sys.exit(1)
+    finally:
+        device.close()
+        try:
+            device.set_payload_bytes(old_payload)
+            device.set_sampling_ms(old_sampling)
+        except Exception:
+            pass
+
+    elapsed = time.monotonic() - start
+    if frames:
+        click.echo(colorize(f"\n📦 {payload} B payload: {total_bytes / elapsed / 1e6:.1f} MB/s, "
+                            f"{frames / elapsed:.0f} frames/s, {info.get('dropped', '-')} dropped"
+                            + (f", {corrupt} corrupt" if verify else ""), Colors.INFO))
+
+
+# Plant command
+@cli.command()
+@click.option('--setpoint', type=float, default=50.0, help='Target temperature in Celsius (default: 50.0)')
+@click.option('--heat', type=int, default=6000, help='Heat load in mW (default: 6000)')
+@click.option('--sampling', type=int, default=1, metavar='MS',
+              help='Sampling period while running, i.e. loop rate (default: 1 ms)')
+@click.option('-d', '--duration', type=float, default=10.0, help='Seconds to run (default: 10)')
+def plant(setpoint: float, heat: int, sampling: int, duration: float):
+    """
+    Close a fan control loop through the driver's thermal plant
+
+    Switches the device to plant mode, applies a heat load and runs a PI
+    fan controller on every sample, writing the cooling command through
+    the mmap'd actuator page. Prints the tracking error and how often a
+    command had been applied by the time the next sample arrived.
+
+    Examples:
+        sudo simtemp plant                         # 50°C at 1 kHz
+        sudo simtemp plant --setpoint 40 --heat 8000 -d 30
+    """
+    from simtemp_plant import ActuatorPage, COOLING_MAX
+
+    check_device_availability()
+
+    device = SimTempDevice()
+    old_mode = device.get_mode()
+    old_sampling = device.get_sampling_ms()
+
+    errors = []
+    applied = 0
+    try:
+        device.set_mode("plant")
+        device.set_sampling_ms(sampling)
+
+        device.open(writable=True)
+        with device, ActuatorPage(device) as actuator:
+            integral = 0.0
+            seq = actuator.set(heat, 0)
+            end = time.monotonic() + duration
+            last_print = 0.0
+
+            while time.monotonic() < end and not interrupted:
+                block = device.read_block()
+                if not len(block):
+                    continue
+
+                temp = block.temps_mC[len(block) - 1] / 1000.0
+                error = temp - setpoint
+                errors.append(error)
+                applied += actuator.applied_seq == seq
+
+                # PI controller: fan up when hotter than the setpoint
+                integral = max(0.0, min(COOLING_MAX / 0.5, integral + error * sampling / 1000.0))
+                cooling = max(0, min(COOLING_MAX, int(150 * error + 0.5 * integral)))
+                seq = actuator.set(heat, cooling)
+
+                now = time.monotonic()
+                if now - last_print >= 0.5:
+                    click.echo(f"  {temp:6.2f}°C  error {error:+6.2f}  fan {cooling:4d}/1000")
+                    last_print = now
+
+    except KeyboardInterrupt:
+        pass
+    except Exception as e:
+        print_error(f"Plant loop failed: {e}")
+        sys.exit(1)
+    finally:
+        try:
+            device.set_mode(old_mode)
+            device.set_sampling_ms(old_sampling)
+        except Exception:
+            pass
+
+    if errors:
+        tail = errors[len(errors) // 2:]
+        rms = (sum(e * e for e in tail) / len(tail)) ** 0.5
+        click.echo(colorize(f"\n{len(errors)} loop iterations, settled RMS error {rms:.3f}°C, "
+                            f"{100.0 * applied / len(errors):.1f}% of commands applied by the next sample", Colors.INFO))
+
+
+# Replay command
+@cli.command()
+@click.argument('capture', type=click.Path(exists=True, dir_okay=False))
+@click.option('-s', '--speed', type=click.FloatRange(0.01, 1000.0), default=1.0,
+              help='Playback speed factor (default: 1.0)')
+@click.option('-l', '--loop', type=int, default=1, metavar='N',
+              help='Play the capture N times, 0 = until interrupted (default: 1)')
+@click.option('--spin', type=click.IntRange(0, 10000), default=200, metavar='US',
+              help='Busy-wait this long before each deadline (default: 200)')
+@click.option('--frame-bytes', type=int, default=0, metavar='N',
+              help='Payload bytes per record of a frame-mode capture (default: 0)')
+@click.option('--keep-timestamps', is_flag=True,
+              help='Inject the recorded timestamps instead of injection times')
+@click.option('--mix', is_flag=True,
+              help='Keep the current mode generating samples alongside the replay')
+def replay(capture: str, speed: float, loop: int, spin: int, frame_bytes: int,
+           keep_timestamps: bool, mix: bool):
+    """
+    Replay a recorded capture with its original timing
+
+    CAPTURE is raw read() output of the device, e.g. from
+    `dd if=/dev/simtemp of=capture.bin`. Samples are injected at their
+    recorded spacing divided by --speed, on absolute deadlines (timerfd
+    plus a short spin), through an O_DSYNC file so each write() reaches
+    readers immediately. The device is switched to replay mode for the
+    run unless --mix is given. Prints the timing error distribution.
+
+    Examples:
+        sudo simtemp replay incident.bin             # Original timing
+        sudo simtemp replay incident.bin -s 100 -l 0 # 100x, soak until ^C
+    """
+    from simtemp_replay import Capture, Replayer
+    from simtemp_device import SAMPLE_SIZE
+
+    check_device_availability()
+
+    try:
+        recorded = Capture.load(capture, SAMPLE_SIZE + frame_bytes, restamp=not keep_timestamps)
+    except (OSError, ValueError) as e:
+        print_error(f"Cannot load capture: {e}")
+        sys.exit(1)
+
+    interval_us = recorded.period_ns / speed / 1000
+    print_info(f"Replaying {len(recorded)} samples over {recorded.span_ns / speed / 1e9:.2f} s "
+               f"per pass ({interval_us:.1f} us mean interval)")
+
+    def on_loop(stats):
+        if loop != 1:
+            click.echo(f"  pass {stats.loops}: {stats.samples} samples, "
+                       f"p99 {stats.percentile_us(99)} us, max {stats.max_ns / 1000:.0f} us")
+
+    device = SimTempDevice()
+    old_mode = device.get_mode()
+    stats = None
+    try:
+        if not mix:
+            device.set_mode("replay")
+        device.open(writable=True, sync=True)
+        stats = Replayer(device, recorded, speed, spin).run(
+            loop, should_stop=lambda: interrupted, on_loop=on_loop)
+    except KeyboardInterrupt:
+        pass
+    except Exception as e:
+        print_error(f"Replay failed: {e}")
+        sys.exit(1)
+    finally:
+        device.close()
+        try:
+            device.set_mode(old_mode)
+        except Exception:
+            pass
+
+    if stats and stats.samples:
+        click.echo(colorize("\n⏱  Timing error (us):", Colors.INFO, bold=True))
+        click.echo(f"  {'p50':>9s} {'p90':>9s} {'p99':>9s} {'p99.9':>9s} {'max':>9s}  samples/writes")
+        row = [stats.percentile_us(pct) for pct in (50, 90, 99, 99.9)] + [stats.max_ns / 1000]
+        click.echo("  " + " ".join(f"{v:9.1f}" for v in row) + f"  {stats.samples}/{stats.writes}")
+        click.echo(f"  p99 is {100.0 * stats.percentile_us(99) / max(interval_us, 1e-3):.1f}% "
+                   f"of the mean interval")
+
+
+# Scenario command
+@cli.command()
+@click.argument('segments', nargs=-1)
+@click.option('-l', '--loops', type=click.IntRange(0), default=1, metavar='N',
+              help='Run the scenario N times, 0 = until changed (default: 1)')
+def scenario(segments: tuple, loops: int):
+    """
+    Run a multi-phase temperature profile in the driver
+
+    Each SEGMENT is [FROM..]TO[~NOISE]/DURATION[@MS]: a linear ramp to TO
+    Celsius over DURATION (ms/s/m/h suffix, default s), starting from FROM
+    or from where the previous segment ended, with +-NOISE Celsius of
+    noise and an optional sampling period of its own. The profile is
+    uploaded once and walked by the sampling timer, so segment changes
+    land exactly on time. Without segments, shows the current position.
+
+    Examples:
+        sudo simtemp scenario 80/30s 80~1.5/60s 40..40/30s -l 0
+        sudo simtemp scenario 25..95/10m@100     # Slow ramp, 100 ms period
+        simtemp scenario                         # Position of the scenario
+    """
+    from simtemp_device import ScenarioSegment
+
+    check_device_availability()
+    device = SimTempDevice()
+
+    if not segments:
+        try:
+            print_info(f"Scenario: {device.get_scenario()} (mode: {device.get_mode()})")
+        except Exception as e:
+            print_error(f"Cannot read scenario: {e}")
+            sys.exit(1)
+        return
+
+    try:
+        parsed = [ScenarioSegment.parse(spec) for spec in segments]
+    except ValueError as e:
+        print_error(str(e))
+        sys.exit(1)
+
+    try:
+        device.open(writable=True)
+        device.set_scenario(parsed, loops)
+    except Exception as e:
+        print_error(f"Cannot load scenario: {e}")
+        sys.exit(1)
+    finally:
+        device.close()
+
+    span_s = sum(segment.duration_ms for segment in parsed) / 1000
+    print_success(f"Scenario loaded: {len(parsed)} segments, {span_s:g} s per pass, "
+                  f"{'endless' if not loops else f'{loops} passes'}")
+
+
+# History command
+@cli.command()
+@click.option('--kb', 'budget_kb', type=click.IntRange(0, 64 * 1024), metavar='KIB',
+              help='Set the history budget and start over, 0 disables it')
+@click.option('--dump', is_flag=True, help='Print every retained sample')
+@click.option('--aggregates', 'window', type=click.IntRange(1, 1000000), metavar='N',
+              help='Print min/max/mean every N retained samples')
+@click.option('-o', '--output', type=click.Path(dir_okay=False),
+              help='Write the retained samples as a raw capture (for simtemp replay)')
+def history(budget_kb: Optional[int], dump: bool, window: Optional[int], output: Optional[str]):
+    """
+    Configure or read back the compact sample history
+
+    The driver keeps a delta-encoded copy of the instance's samples (a few
+    bytes each instead of 16) within a per-instance budget, and decodes it
+    on request. Without options, shows what the history holds.
+
+    Examples:
+        sudo simtemp history --kb 2048            # ~10 min at 1 kHz
+        simtemp history --aggregates 1000         # One line per second
+        simtemp history -o last.bin               # Save for replay
+    """
+    from simtemp_device import SAMPLE_FORMAT
+
+    check_device_availability()
+    device = SimTempDevice()
+
+    try:
+        if budget_kb is not None:
+            device.set_history_kb(budget_kb)
+            print_success(f"History budget set to {budget_kb} KiB")
+
+        info = device.get_history()
+        samples, used = int(info["samples"]), int(info["bytes"])
+        click.echo(colorize("\n🗄  Sample history:", Colors.INFO, bold=True))
+        click.echo(f"  budget {info['budget_kb']} KiB, blocks {info['blocks']}, "
+                   f"{samples} samples over {int(info['span_ms']) / 1000:.1f} s")
+        if samples:
+            click.echo(f"  {used / samples:.2f} bytes per sample ({16 * samples / max(used, 1):.1f}x "
+                       f"smaller than the ring's records)")
+
+        if not (dump or window or output):
+            return
+
+        device.open()
+        view = "aggregates" if window and not output else "raw"
+        cursor, out = 0, open(output, "wb") if output else None
+        try:
+            while True:
+                records, cursor, _, _ = device.read_history(cursor, view, window or 0)
+                if not records:
+                    break
+                for rec in records:
+                    if out:
+                        out.write(struct.pack(SAMPLE_FORMAT, rec.timestamp_ns, rec.temp_mC, rec.flags))
+                    elif view == "aggregates":
+                        first_ns, last_ns, count, low, high, mean = rec
+                        click.echo(f"  {first_ns / 1e9:.3f}  {count} samples over "
+                                   f"{(last_ns - first_ns) / 1e9:.2f}s: min {mC_to_celsius(low):.2f} "
+                                   f"max {mC_to_celsius(high):.2f} mean {mC_to_celsius(mean):.2f}°C")
+                    else:
+                        click.echo(f"  {rec}")
+        finally:
+            if out:
+                out.close()
+                print_success(f"Wrote {output}")
+    except Exception as e:
+        print_error(f"History failed: {e}")
+        sys.exit(1)
+    finally:
+        device.close()
+
+
+def _parse_quantity(text: str, units: dict) -> float:
+    """'90s', '15m', '1d', '500M'... (a bare number has unit 1)"""
+    text = text.strip()
+    scale = units.get(text[-1:].lower())
+    if scale is not None:
+        text = text[:-1]
+    return float(text) * (scale or 1)
+
+
+_AGE_UNITS = {"s": 1, "m": 60, "h": 3600, "d": 86400}
+_SIZE_UNITS = {"k": 1 << 10, "m": 1 << 20, "g": 1 << 30}
+
+
+def _parse_budgets(specs: tuple) -> dict:
+    """--budget TIER=AGE[,SIZE] options into a retention policy"""
+    from simtemp_archive import Budget, TIERS
+
+    policy = {}
+    for spec in specs:
+        tier, _, limits = spec.partition("=")
+        if tier not in TIERS:
+            raise click.BadParameter(f"unknown tier {tier!r} (use {', '.join(TIERS)})",
+                                     param_hint="--budget")
+        age, _, size = limits.partition(",")
+        try:
+            policy[tier] = Budget(_parse_quantity(age, _AGE_UNITS) if age else None,
+                                  int(_parse_quantity(size, _SIZE_UNITS)) if size else None)
+        except ValueError:
+            raise click.BadParameter(f"cannot parse {spec!r}", param_hint="--budget")
+    return policy
+
+
+_budget_option = click.option('--budget', multiple=True, metavar='TIER=AGE[,SIZE]',
+                              help='Retention of a tier (raw, events, 1s, 1m), e.g. raw=1d or 1s=7d,2G')
+
+
+# Archive commands
+@cli.group()
+def archive():
+    """
+    Record samples into an archive with rollup tiers and compact it
+
+    Raw segments are kept at full rate for a day by default, then only
+    their per-second rollups and the samples around threshold crossings
+    are kept; after a week the rollups become per-minute.
+    """
+
+
+@archive.command('record')
+@click.argument('directory', type=click.Path(file_okay=False))
+@click.option('--segment', type=int, default=3600, metavar='S',
+              help='Raw segment length in seconds, a multiple of 60 (default: 3600)')
+@click.option('--compact-every', type=float, default=60.0, metavar='S',
+              help='Compact in the background every S seconds, 0 = never (default: 60)')
+@_budget_option
+@click.option('-d', '--duration', type=float, help='Seconds to record (default: until ^C)')
+def archive_record(directory: str, segment: int, compact_every: float, budget: tuple,
+                   duration: Optional[float]):
+    """
+    Record the device into an archive directory
+
+    Examples:
+        simtemp archive record /var/lib/simtemp
+        simtemp archive record ./arch --segment 600 --budget raw=2h
+    """
+    import threading
+    from simtemp_archive import Archive, Recorder
+
+    check_device_availability()
+
+    store = Archive(directory, _parse_budgets(budget))
+    stop = threading.Event()
+
+    def compactor():
+        # Own Archive: the listing cache is not shared across threads
+        background = Archive(directory, _parse_budgets(budget))
+        while not stop.wait(compact_every):
+            try:
+                background.compact()
+            except OSError as e:
+                print_warning(f"Compaction failed: {e}")
+
+    worker = None
+    if compact_every > 0:
+        worker = threading.Thread(target=compactor, name="simtemp-compact", daemon=True)
+        worker.start()
+
+    recorded = 0
+    end = time.monotonic() + duration if duration else None
+    try:
+        with SimTempDevice() as device, Recorder(store, segment) as recorder:
+            print_info(f"Recording into {directory} (^C to stop)")
+            while not interrupted and (end is None or time.monotonic() < end):
+                block = device.read_block(1024)
+                recorder.add_block(block)
+                recorded += len(block)
+    except KeyboardInterrupt:
+        pass
+    except (OSError, ValueError) as e:
+        print_error(f"Recording failed: {e}")
+        sys.exit(1)
+    finally:
+        stop.set()
+        if worker:
+            worker.join()
+
+    print_success(f"Recorded {recorded} samples")
+
+
+@archive.command('compact')
+@click.argument('directory', type=click.Path(exists=True, file_okay=False))
+@_budget_option
+@click.option('--event-window', type=float, default=5.0, metavar='S',
+              help='Full-rate seconds kept around each threshold crossing (default: 5)')
+@click.option('--watch', type=float, metavar='S', help='Keep compacting every S seconds')
+def archive_compact(directory: str, budget: tuple, event_window: float, watch: Optional[float]):
+    """
+    Apply the retention budgets to an archive
+
+    Examples:
+        simtemp archive compact /var/lib/simtemp
+        simtemp archive compact ./arch --budget raw=1h --budget 1m=,1G --watch 60
+    """
+    from simtemp_archive import Archive, TIERS
+
+    store = Archive(directory, _parse_budgets(budget), event_window)
+    try:
+        while True:
+            done = store.compact()
+            if any(done.values()) or not watch:
+                click.echo("  " + "  ".join(f"{tier}: {done[tier]} retired, "
+                                            f"{store.tier_bytes(tier) / 1e6:.1f} MB"
+                                            for tier in TIERS))
+            if not watch or interrupted:
+                break
+            time.sleep(watch)
+    except KeyboardInterrupt:
+        pass
+    except OSError as e:
+        print_error(f"Compaction failed: {e}")
+        sys.exit(1)
+
+
+@archive.command('query')
+@click.argument('directory', type=click.Path(exists=True, file_okay=False))
+@click.option('--since', default='1h', metavar='AGE', help='Start, this long ago (default: 1h)')
+@click.option('--until', 'until_', default='0s', metavar='AGE', help='End, this long ago (default: now)')
+@click.option('--step', default='1m', metavar='AGE', help='Bucket size (default: 1m)')
+def archive_query(directory: str, since: str, until_: str, step: str):
+    """
+    Print min/max/mean of a time range from whichever tiers hold it
+
+    Examples:
+        simtemp archive query /var/lib/simtemp --since 1d --step 1h
+    """
+    from simtemp_archive import Archive, SECOND_NS
+    from datetime import datetime
+
+    try:
+        now = time.time_ns()
+        start = now - int(_parse_quantity(since, _AGE_UNITS) * SECOND_NS)
+        end = now - int(_parse_quantity(until_, _AGE_UNITS) * SECOND_NS)
+        step_ns = max(SECOND_NS, int(_parse_quantity(step, _AGE_UNITS) * SECOND_NS))
+    except ValueError as e:
+        raise click.BadParameter(str(e))
+
+    began = time.perf_counter()
+    rollups = Archive(directory).rollups(start, end, step_ns)
+    took_ms = (time.perf_counter() - began) * 1000
+
+    click.echo(f"  {'start':19s} {'samples':>9s} {'min':>8s} {'max':>8s} {'mean':>8s} {'events':>6s}")
+    for r in rollups:
+        stamp = datetime.fromtimestamp(r.start_ns / SECOND_NS).strftime("%Y-%m-%d %H:%M:%S")
+        click.echo(f"  {stamp:19s} {r.count:9d} {mC_to_celsius(r.min_mC):8.2f} "
+                   f"{mC_to_celsius(r.max_mC):8.2f} {mC_to_celsius(r.mean_mC):8.2f} {r.events:6d}")
+    print_info(f"{len(rollups)} buckets in {took_ms:.1f} ms")
+
+
 # Test command (CRITICAL REQUIREMENT)
 @cli.command()
 @click.option('--duration', type=int, default=10, help='Test duration in seconds (default: 10)')
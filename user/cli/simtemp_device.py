@@ -6,6 +6,8 @@ Low-level interface for /dev/simtemp character device and sysfs attributes
 
 import struct
 import os
+import fcntl
+import array
 import select
 import time
 from pathlib import Path
@@ -15,6 +17,7 @@ from dataclasses import dataclass
 
 # Device paths
 DEVICE_PATH = "/dev/simtemp"
+MUX_PATH = "/dev/simtemp-all"
 SYSFS_BASE = "/sys/class/misc/simtemp"
 
 # Binary sample structure (must match kernel definition)
@@ -26,9 +29,89 @@ SYSFS_BASE = "/sys/class/misc/simtemp"
 SAMPLE_FORMAT = "=QiI"  # Little-endian: u64, s32, u32
 SAMPLE_SIZE = struct.calcsize(SAMPLE_FORMAT)
 
+# Frame mode (sysfs payload_bytes): each record is a sample followed by
+# payload_bytes of u64 words, word i = timestamp_ns + i
+PAYLOAD_MIN = 64
+PAYLOAD_MAX = 65536
+PAYLOAD_ALIGN = 16
+
+# ioctl encoding (asm-generic/ioctl.h)
+_IOC_WRITE = 1
+_IOC_READ = 2
+
+
+def _IOC(direction: int, nr: int, size: int) -> int:
+    """Encode a SimTemp ioctl number (type 'S')"""
+    return (direction << 30) | (size << 16) | (ord("S") << 8) | nr
+
+
+# ioctl commands (must match nxp_simtemp_ioctl.h)
+SIMTEMP_IOC_SET_CURSOR = _IOC(_IOC_WRITE, 1, 4)
+SIMTEMP_IOC_SET_WATERMARK = _IOC(_IOC_WRITE, 2, 4)
+SIMTEMP_IOC_GET_STATS = _IOC(_IOC_READ | _IOC_WRITE, 3, 24)
+SIMTEMP_IOC_MUX_SUBSCRIBE = _IOC(_IOC_WRITE, 4, 16)
+SIMTEMP_IOC_MUX_UNSUBSCRIBE = _IOC(_IOC_WRITE, 5, 16)
+SIMTEMP_IOC_SET_BUSY_POLL = _IOC(_IOC_WRITE, 6, 4)
+SIMTEMP_IOC_SET_ACTUATOR = _IOC(_IOC_WRITE, 7, 8)
+SIMTEMP_IOC_OPEN_VIEW = _IOC(_IOC_WRITE, 8, 40)
+SIMTEMP_IOC_SET_SCENARIO = _IOC(_IOC_WRITE, 9, 24)
+SIMTEMP_IOC_READ_HISTORY = _IOC(_IOC_READ | _IOC_WRITE, 10, 48)
+BUSY_POLL_MAX_US = 10000
+
+# Multiplexer records (struct simtemp_tagged_sample: instance, reserved, sample)
+TAGGED_SAMPLE_FORMAT = "=II" + SAMPLE_FORMAT[1:]
+TAGGED_SAMPLE_SIZE = struct.calcsize(TAGGED_SAMPLE_FORMAT)
+MUX_SET_FORMAT = "=QII"
+MUX_ALL = 1 << 0
+
+# View fds (struct simtemp_view_req and the per-view record formats)
+VIEW_REQ_FORMAT = "=5Ii4I"
+VIEW_RAW = 0
+VIEW_FILTERED = 1
+VIEW_EVENTS = 2
+VIEW_AGGREGATES = 3
+VIEW_TYPES = {"raw": VIEW_RAW, "filtered": VIEW_FILTERED,
+              "events": VIEW_EVENTS, "aggregates": VIEW_AGGREGATES}
+VIEW_NONBLOCK = 1 << 0
+VIEW_CLOEXEC = 1 << 1
+VIEW_RECORD_FORMATS = {
+    VIEW_RAW: SAMPLE_FORMAT,
+    VIEW_FILTERED: SAMPLE_FORMAT,
+    VIEW_EVENTS: "=QiI",                # timestamp_ns, temp_mC, type
+    VIEW_AGGREGATES: "=QQIiii",         # first_ns, last_ns, count, min, max, mean
+}
+EVENT_RISING = 1
+EVENT_FALLING = 2
+EVENT_JUMP = 3
+EVENT_NAMES = {EVENT_RISING: "rising", EVENT_FALLING: "falling", EVENT_JUMP: "jump"}
+
+# Driver-wide statistics (struct simtemp_stats_header / _record / _query)
+STATS_DEBUGFS_PATH = "/sys/kernel/debug/nxp_simtemp/stats"
+STATS_HEADER_FORMAT = "=4I"
+STATS_MAGIC = 0x53545354
+STATS_RECORD_FORMAT = "=II11Q"
+STATS_RECORD_SIZE = struct.calcsize(STATS_RECORD_FORMAT)
+STATS_QUERY_FORMAT = "=QIIII"
+STATS_FIELDS = ("total_samples", "threshold_alerts", "read_count", "poll_count",
+                "reader_overruns", "injected_samples", "staging_drops",
+                "jittered_ticks", "bursts", "stalls", "held_samples")
+STATS_ACTIVE = 1 << 0
+
+# Scenarios (struct simtemp_segment / struct simtemp_scenario_req)
+SEGMENT_FORMAT = "=IIiiII"
+SCENARIO_REQ_FORMAT = "=QIIII"
+SEGMENT_FROM_PREV = 1 << 0
+SCENARIO_SEGMENTS_MAX = 256
+
+# Compact history (struct simtemp_history_req; records use the view formats)
+HISTORY_REQ_FORMAT = "=4Q4I"
+HISTORY_KB_MAX = 64 * 1024
+HISTORY_TYPES = {"raw": VIEW_RAW, "aggregates": VIEW_AGGREGATES}
+
 # Flag definitions (must match kernel)
 FLAG_NEW_SAMPLE = 1 << 0
 FLAG_THRESHOLD_CROSSED = 1 << 1
+FLAG_INJECTED = 1 << 2
 
 
 @dataclass
@@ -59,11 +142,112 @@ class TemperatureSample:
             flags_str.append("NEW")
         if self.flags & FLAG_THRESHOLD_CROSSED:
             flags_str.append("THRESHOLD")
+        if self.flags & FLAG_INJECTED:
+            flags_str.append("INJECTED")
 
         return (f"[{self.timestamp_sec:.3f}s] {self.temp_celsius:6.2f}°C "
                 f"({self.temp_mC:6d} mC) flags=[{','.join(flags_str) if flags_str else 'NONE'}]")
 
 
+@dataclass
+class ScenarioSegment:
+    """
+    One phase of a scenario: a linear ramp to end_mC over duration_ms
+    (start_mC None = from where the previous phase ended)
+    """
+    duration_ms: int
+    end_mC: int
+    start_mC: Optional[int] = None
+    noise_mC: int = 0
+    sampling_ms: int = 0
+
+    _UNITS = {"ms": 1, "s": 1000, "m": 60000, "h": 3600000}
+
+    @classmethod
+    def parse(cls, spec: str) -> "ScenarioSegment":
+        """
+        Parse "[FROM..]TO[~NOISE]/DURATION[@PERIOD]", temperatures in
+        Celsius, DURATION with an ms/s/m/h suffix (default s), PERIOD the
+        sampling period in ms. "80/30s" ramps to 80 C over 30 s,
+        "80~1.5/60s" holds there with +-1.5 C of noise, "40..40/30s"
+        jumps to 40 C and stays 30 s.
+        """
+        try:
+            temps, timing = spec.split("/", 1)
+            period = 0
+            if "@" in timing:
+                timing, period_spec = timing.split("@", 1)
+                period = int(period_spec.removesuffix("ms"))
+
+            unit = next((u for u in ("ms", "s", "m", "h") if timing.endswith(u)), "")
+            duration = round(float(timing[:len(timing) - len(unit)]) * cls._UNITS[unit or "s"])
+
+            noise = 0.0
+            if "~" in temps:
+                temps, noise_spec = temps.split("~", 1)
+                noise = float(noise_spec)
+
+            start = None
+            if ".." in temps:
+                start_spec, temps = temps.split("..", 1)
+                start = celsius_to_mC(float(start_spec))
+
+            return cls(duration, celsius_to_mC(float(temps)), start, celsius_to_mC(noise), period)
+        except ValueError:
+            raise ValueError(f"Invalid segment '{spec}' (use [FROM..]TO[~NOISE]/DURATION[@MS])")
+
+    def pack(self) -> bytes:
+        flags = SEGMENT_FROM_PREV if self.start_mC is None else 0
+        return struct.pack(SEGMENT_FORMAT, self.duration_ms, self.sampling_ms,
+                           self.start_mC or 0, self.end_mC, self.noise_mC, flags)
+
+
+class SampleBlock:
+    """
+    A batch of raw samples returned by one read()
+
+    Columns are exposed as zero-copy strided memoryviews over the packed
+    records (16-byte samples, or frames of record_size bytes), so a block
+    is decoded without per-sample Python work.
+    """
+
+    def __init__(self, data: bytes, record_size: int = SAMPLE_SIZE):
+        if len(data) % record_size:
+            raise IOError(f"Partial read: {len(data)} bytes is not a multiple of {record_size}")
+        self.data = data
+        self.record_size = record_size
+        view = memoryview(data)
+        self.timestamps_ns = view.cast("Q")[0::record_size // 8]
+        self.temps_mC = view.cast("i")[2::record_size // 4]
+        self.flags = view.cast("I")[3::record_size // 4]
+
+    def __len__(self) -> int:
+        return len(self.data) // self.record_size
+
+    def __iter__(self):
+        """Iterate as TemperatureSample objects (decodes per sample)"""
+        if self.record_size == SAMPLE_SIZE:
+            for timestamp_ns, temp_mC, flags in struct.iter_unpack(SAMPLE_FORMAT, self.data):
+                yield TemperatureSample(timestamp_ns, temp_mC, flags)
+        else:
+            for i in range(len(self)):
+                yield self[i]
+
+    def payload(self, index: int) -> memoryview:
+        """Payload of frame `index`, zero-copy (empty for plain samples)"""
+        start = index * self.record_size + SAMPLE_SIZE
+        return memoryview(self.data)[start:start + self.record_size - SAMPLE_SIZE]
+
+    def __getitem__(self, index: int) -> TemperatureSample:
+        return TemperatureSample(self.timestamps_ns[index], self.temps_mC[index],
+                                 self.flags[index])
+
+    def threshold_samples(self) -> list:
+        """Samples in this block that carry the threshold-crossed flag"""
+        return [self[i] for i, flags in enumerate(self.flags.tolist())
+                if flags & FLAG_THRESHOLD_CROSSED]
+
+
 class SimTempDevice:
     """Interface to NXP SimTemp character device and sysfs"""
 
@@ -71,28 +255,60 @@ class SimTempDevice:
         self.device_path = device_path
         self.sysfs_base = Path(sysfs_base)
         self._fd: Optional[int] = None
+        self.record_size = SAMPLE_SIZE
+
+    @classmethod
+    def instance(cls, index: int) -> "SimTempDevice":
+        """Device for instance N (/dev/simtempN; instance 0 is /dev/simtemp)"""
+        name = f"simtemp{index}" if index else "simtemp"
+        return cls(f"/dev/{name}", f"/sys/class/misc/{name}")
+
+    @staticmethod
+    def instance_indices() -> list:
+        """Sorted instance numbers of all probed devices"""
+        indices = []
+        for path in Path("/sys/class/misc").glob("simtemp*"):
+            suffix = path.name[len("simtemp"):]
+            if suffix == "":
+                indices.append(0)
+            elif suffix.isdigit():
+                indices.append(int(suffix))
+        return sorted(indices)
 
     def __enter__(self):
-        self.open()
+        if self._fd is None:
+            self.open()
         return self
 
     def __exit__(self, exc_type, exc_val, exc_tb):
         self.close()
 
-    def open(self, non_blocking: bool = False) -> None:
-        """Open the character device"""
+    def open(self, non_blocking: bool = False, writable: bool = False, sync: bool = False) -> None:
+        """
+        Open the character device (writable=True allows sample injection;
+        sync=True opens it O_DSYNC so each write() is published before it
+        returns instead of waiting for a batch or the next tick)
+        """
         if self._fd is not None:
             raise RuntimeError("Device already open")
 
         if not os.path.exists(self.device_path):
             raise FileNotFoundError(f"Device not found: {self.device_path}")
 
-        flags = os.O_RDONLY
+        flags = os.O_RDWR if writable else os.O_RDONLY
         if non_blocking:
             flags |= os.O_NONBLOCK
+        if sync:
+            flags |= os.O_DSYNC
 
         self._fd = os.open(self.device_path, flags)
 
+        # Fixed while the device is open (the driver refuses changes then)
+        try:
+            self.record_size = SAMPLE_SIZE + self.get_payload_bytes()
+        except (OSError, ValueError):
+            self.record_size = SAMPLE_SIZE
+
     def close(self) -> None:
         """Close the character device"""
         if self._fd is not None:
@@ -100,12 +316,12 @@ class SimTempDevice:
             self._fd = None
 
     def read_sample(self) -> TemperatureSample:
-        """Read one temperature sample from the device"""
+        """Read one temperature sample (the header of one frame in frame mode)"""
         if self._fd is None:
             raise RuntimeError("Device not open")
 
         try:
-            data = os.read(self._fd, SAMPLE_SIZE)
+            data = os.read(self._fd, self.record_size)
         except BlockingIOError:
             raise TimeoutError("No data available (non-blocking mode)")
         except OSError as e:
@@ -113,12 +329,183 @@ class SimTempDevice:
                 raise KeyboardInterrupt("Read interrupted by signal")
             raise
 
-        if len(data) != SAMPLE_SIZE:
-            raise IOError(f"Partial read: expected {SAMPLE_SIZE} bytes, got {len(data)}")
+        if len(data) != self.record_size:
+            raise IOError(f"Partial read: expected {self.record_size} bytes, got {len(data)}")
 
-        timestamp_ns, temp_mC, flags = struct.unpack(SAMPLE_FORMAT, data)
+        timestamp_ns, temp_mC, flags = struct.unpack_from(SAMPLE_FORMAT, data)
         return TemperatureSample(timestamp_ns, temp_mC, flags)
 
+    def read_block(self, max_samples: int = 256) -> SampleBlock:
+        """Read up to max_samples samples (or frames) with a single read() call"""
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        try:
+            data = os.read(self._fd, max_samples * self.record_size)
+        except BlockingIOError:
+            raise TimeoutError("No data available (non-blocking mode)")
+        except OSError as e:
+            if e.errno == 4:  # EINTR - interrupted by signal
+                raise KeyboardInterrupt("Read interrupted by signal")
+            raise
+
+        return SampleBlock(data, self.record_size)
+
+    def fileno(self) -> int:
+        """File descriptor of the open device (for select/poll/asyncio)"""
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+        return self._fd
+
+    def inject_samples(self, samples) -> int:
+        """
+        Inject samples into the device (device must be opened writable)
+
+        Args:
+            samples: Iterable of (temp_mC, timestamp_ns, flags) tuples;
+                     timestamp_ns 0 means "stamp at injection time"
+
+        Returns:
+            Number of samples accepted by the driver
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        data = b"".join(struct.pack(SAMPLE_FORMAT, ts, temp, flags)
+                        for temp, ts, flags in samples)
+        if not data:
+            return 0
+
+        return os.write(self._fd, data) // SAMPLE_SIZE
+
+    def set_watermark(self, records: int) -> None:
+        """
+        Set how many unread samples this open file needs before poll()
+        reports data and a blocking read() wakes up (1 to ring size)
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_SET_WATERMARK, struct.pack("=I", records))
+
+    def set_busy_poll(self, budget_us: int) -> None:
+        """
+        Set how long a blocking read() may spin for data before sleeping
+        (microseconds, 0 disables; the driver caps it at half the observed
+        sample interval)
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_SET_BUSY_POLL, struct.pack("=I", budget_us))
+
+    def set_actuator(self, heat_mW: int, cooling: int) -> None:
+        """
+        Set the plant's heat load (mW) and cooling command (0-1000) with one
+        ioctl (device must be opened writable); see simtemp_plant.ActuatorPage
+        for the syscall-free path
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_SET_ACTUATOR, struct.pack("=iI", heat_mW, cooling))
+
+    def open_view(self, view: str, non_blocking: bool = False, depth: int = 0,
+                  decimate: int = 0, filter_shift: int = 0, threshold_mC: int = 0,
+                  hysteresis_mC: int = 0, jump_mC: int = 0, window: int = 0) -> "SimTempView":
+        """
+        Open a dedicated stream fd for one view of this instance
+
+        Args:
+            view: "raw", "filtered", "events" or "aggregates"
+            depth: Records in the view's ring (power of 2, 0 = 1024)
+            decimate: raw/filtered: every Nth sample
+            filter_shift: filtered: low-pass weight 1/2^shift (1-8)
+            threshold_mC, hysteresis_mC, jump_mC: events
+            window: aggregates: samples per record
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+        if view not in VIEW_TYPES:
+            raise ValueError(f"View must be one of {list(VIEW_TYPES)}, got {view}")
+
+        flags = VIEW_CLOEXEC | (VIEW_NONBLOCK if non_blocking else 0)
+        req = bytearray(struct.pack(VIEW_REQ_FORMAT, VIEW_TYPES[view], flags, depth, decimate,
+                                    filter_shift, threshold_mC, hysteresis_mC, jump_mC,
+                                    window, 0))
+        return SimTempView(fcntl.ioctl(self._fd, SIMTEMP_IOC_OPEN_VIEW, req, True),
+                           VIEW_TYPES[view])
+
+    def set_scenario(self, segments, loops: int = 1) -> None:
+        """
+        Upload a scenario (list of ScenarioSegment) and switch to scenario
+        mode; it starts at the next tick and runs `loops` passes (0 = forever).
+        The device must be opened writable
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+        if not 1 <= len(segments) <= SCENARIO_SEGMENTS_MAX:
+            raise ValueError(f"A scenario has 1-{SCENARIO_SEGMENTS_MAX} segments")
+
+        data = array.array("B", b"".join(segment.pack() for segment in segments))
+        req = struct.pack(SCENARIO_REQ_FORMAT, data.buffer_info()[0], len(segments), loops, 0, 0)
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_SET_SCENARIO, req)
+
+    def get_scenario(self) -> str:
+        """Position of the loaded scenario ("none" if there is none)"""
+        return self._read_sysfs("scenario")
+
+    def read_history(self, cursor: int = 0, view: str = "raw", window: int = 0,
+                     capacity: int = 4096) -> tuple:
+        """
+        Decode up to capacity records of the compact history from cursor
+        (0 = the oldest retained sample)
+
+        Args:
+            view: "raw" (TemperatureSample) or "aggregates" (tuples as
+                  SimTempView.read_records() returns them, window samples each)
+
+        Returns:
+            (records, next cursor, oldest retained, next sequence number);
+            records is empty once the cursor caught up
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+        if view not in HISTORY_TYPES:
+            raise ValueError(f"History view must be one of {list(HISTORY_TYPES)}, got {view}")
+
+        record_format = VIEW_RECORD_FORMATS[HISTORY_TYPES[view]]
+        records = array.array("B", bytes(capacity * struct.calcsize(record_format)))
+        req = bytearray(struct.pack(HISTORY_REQ_FORMAT, records.buffer_info()[0], cursor, 0, 0,
+                                    HISTORY_TYPES[view], capacity, window, 0))
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_READ_HISTORY, req)
+        _, cursor, oldest, next_seq, _, _, _, count = struct.unpack(HISTORY_REQ_FORMAT, req)
+
+        data = records.tobytes()[:count * struct.calcsize(record_format)]
+        decoded = struct.iter_unpack(record_format, data)
+        if view == "raw":
+            return [TemperatureSample(*record) for record in decoded], cursor, oldest, next_seq
+        return list(decoded), cursor, oldest, next_seq
+
+    def fdinfo(self) -> Dict[str, str]:
+        """
+        Per-file counters of this open file, from /proc/self/fdinfo
+
+        Returns:
+            Dictionary keyed without the 'simtemp-' prefix, e.g. 'lag',
+            'dropped', 'samples-read', 'watermark'
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        info = {}
+        with open(f"/proc/self/fdinfo/{self._fd}") as f:
+            for line in f:
+                key, _, value = line.partition(":")
+                if key.startswith("simtemp-"):
+                    info[key[len("simtemp-"):]] = value.strip()
+        return info
+
     def poll(self, timeout_ms: int = 1000) -> bool:
         """
         Poll the device for available data
@@ -207,12 +594,60 @@ class SimTempDevice:
         return self._read_sysfs("mode")
 
     def set_mode(self, mode: str) -> None:
-        """Set temperature generation mode (normal, noisy, ramp)"""
-        valid_modes = ["normal", "noisy", "ramp"]
+        """Set temperature generation mode (normal, noisy, ramp, plant, replay, scenario)"""
+        valid_modes = ["normal", "noisy", "ramp", "plant", "replay", "scenario"]
         if mode not in valid_modes:
             raise ValueError(f"Mode must be one of {valid_modes}, got {mode}")
         self._write_sysfs("mode", mode)
 
+    def get_shaping(self) -> Dict[str, int]:
+        """Get delivery shaping (jitter_us, burst, stall_ms, stall_permille, seed)"""
+        return {key: int(value) for key, _, value in
+                (item.partition("=") for item in self._read_sysfs("shaping").split())}
+
+    def set_shaping(self, spec: str = "off", **settings) -> None:
+        """
+        Set delivery shaping, e.g. set_shaping(jitter_us=500, seed=42) or
+        set_shaping("burst=8 stall_ms=200 stall_permille=5"); "off" disables.
+        Settings not given keep their value; every write reseeds the PRNG.
+        """
+        if settings:
+            spec = " ".join(f"{key}={value}" for key, value in settings.items())
+        self._write_sysfs("shaping", spec)
+
+    def get_payload_bytes(self) -> int:
+        """Get the frame payload size in bytes (0 = plain 16-byte samples)"""
+        return int(self._read_sysfs("payload_bytes"))
+
+    def set_payload_bytes(self, value: int) -> None:
+        """
+        Set the frame payload size (0, or PAYLOAD_MIN-PAYLOAD_MAX in steps of
+        PAYLOAD_ALIGN). Fails with EBUSY while the device is open anywhere.
+        """
+        if value and (value < PAYLOAD_MIN or value > PAYLOAD_MAX or value % PAYLOAD_ALIGN):
+            raise ValueError(f"Payload must be 0 or {PAYLOAD_MIN}-{PAYLOAD_MAX} bytes "
+                             f"in steps of {PAYLOAD_ALIGN}, got {value}")
+        self._write_sysfs("payload_bytes", str(value))
+
+    def get_history_kb(self) -> int:
+        """Get the compact history budget in KiB (0 = disabled)"""
+        return int(self._read_sysfs("history_kb"))
+
+    def set_history_kb(self, value: int) -> None:
+        """Set the compact history budget (0-HISTORY_KB_MAX KiB); clears the history"""
+        if not 0 <= value <= HISTORY_KB_MAX:
+            raise ValueError(f"History budget must be 0-{HISTORY_KB_MAX} KiB, got {value}")
+        self._write_sysfs("history_kb", str(value))
+
+    def get_history(self) -> Dict[str, str]:
+        """What the compact history holds (budget_kb, blocks, samples, bytes, span_ms)"""
+        history = {}
+        for line in self._read_sysfs("history").split('\n'):
+            if ':' in line:
+                key, value = line.split(':', 1)
+                history[key.strip()] = value.strip()
+        return history
+
     def get_stats(self) -> Dict[str, int]:
         """Get module statistics"""
         stats_text = self._read_sysfs("stats")
@@ -223,6 +658,34 @@ class SimTempDevice:
                 stats[key.strip()] = int(value.strip())
         return stats
 
+    def get_all_stats(self, capacity: int = 4096) -> Dict[int, Dict[str, int]]:
+        """
+        Counters of every instance in one ioctl (device must be open)
+
+        Returns:
+            Dictionary instance number -> counters (same keys as get_stats(),
+            plus 'active' while the instance has sample buffers)
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        records = array.array("B", bytes(capacity * STATS_RECORD_SIZE))
+        query = bytearray(struct.pack(STATS_QUERY_FORMAT,
+                                      records.buffer_info()[0], capacity, 0, 0, 0))
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_GET_STATS, query)
+        _, _, count, _, _ = struct.unpack(STATS_QUERY_FORMAT, query)
+
+        return _parse_stats_records(records.tobytes(), count)
+
+    def get_memory(self) -> Dict[str, int]:
+        """Get memory held by this instance (bytes; buffers is 0 when idle)"""
+        memory = {}
+        for line in self._read_sysfs("memory").split('\n'):
+            if ':' in line:
+                key, value = line.split(':', 1)
+                memory[key.strip()] = int(value.strip())
+        return memory
+
     def get_config(self) -> Dict[str, any]:
         """Get current configuration"""
         return {
@@ -243,6 +706,184 @@ class SimTempDevice:
         return Path(SYSFS_BASE).exists()
 
 
+class SimTempMux:
+    """
+    /dev/simtemp-all: samples of several instances through one descriptor
+
+    Every open file has its own subscription set; records carry the
+    instance number they came from.
+    """
+
+    def __init__(self, device_path: str = MUX_PATH):
+        self.device_path = device_path
+        self._fd = None
+
+    def __enter__(self):
+        self.open()
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def open(self, non_blocking: bool = False) -> None:
+        """Open the multiplexer (starts with no subscriptions)"""
+        if self._fd is not None:
+            raise RuntimeError("Device already open")
+
+        flags = os.O_RDONLY
+        if non_blocking:
+            flags |= os.O_NONBLOCK
+
+        self._fd = os.open(self.device_path, flags)
+
+    def close(self) -> None:
+        """Close the multiplexer, dropping every subscription"""
+        if self._fd is not None:
+            os.close(self._fd)
+            self._fd = None
+
+    def fileno(self) -> int:
+        """File descriptor of the open multiplexer (for select/poll/asyncio)"""
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+        return self._fd
+
+    def _update(self, cmd: int, instances) -> int:
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        if instances is None:
+            arg = bytearray(struct.pack(MUX_SET_FORMAT, 0, 0, MUX_ALL))
+        else:
+            ids = array.array("I", instances)
+            if not ids:
+                return 0
+            arg = bytearray(struct.pack(MUX_SET_FORMAT, ids.buffer_info()[0], len(ids), 0))
+
+        # A mutable buffer makes fcntl.ioctl() return the ioctl's result
+        return fcntl.ioctl(self._fd, cmd, arg, True)
+
+    def subscribe(self, instances=None) -> int:
+        """
+        Subscribe to instances (iterable of numbers, None = all current ones)
+        Returns the number of new subscriptions
+        """
+        return self._update(SIMTEMP_IOC_MUX_SUBSCRIBE, instances)
+
+    def unsubscribe(self, instances=None) -> int:
+        """
+        Unsubscribe from instances (iterable of numbers, None = all)
+        Returns the number of subscriptions removed
+        """
+        return self._update(SIMTEMP_IOC_MUX_UNSUBSCRIBE, instances)
+
+    def set_watermark(self, records: int) -> None:
+        """Set how many queued records poll()/read() wait for (1 to 4096)"""
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        fcntl.ioctl(self._fd, SIMTEMP_IOC_SET_WATERMARK, struct.pack("=I", records))
+
+    def read_batch(self, max_samples: int = 256) -> list:
+        """
+        Read up to max_samples records with a single read() call
+
+        Returns:
+            List of (instance, TemperatureSample) tuples in arrival order
+        """
+        if self._fd is None:
+            raise RuntimeError("Device not open")
+
+        try:
+            data = os.read(self._fd, max_samples * TAGGED_SAMPLE_SIZE)
+        except BlockingIOError:
+            raise TimeoutError("No data available (non-blocking mode)")
+
+        return [(instance, TemperatureSample(ts, temp, flags))
+                for instance, _, ts, temp, flags
+                in struct.iter_unpack(TAGGED_SAMPLE_FORMAT, data)]
+
+
+class SimTempView:
+    """
+    One view fd returned by SimTempDevice.open_view()
+
+    Has its own ring, cursor, watermark and poll(); it only becomes
+    readable when its view produces a record.
+    """
+
+    def __init__(self, fd: int, view_type: int):
+        self._fd = fd
+        self.view_type = view_type
+        self.record_format = VIEW_RECORD_FORMATS[view_type]
+        self.record_size = struct.calcsize(self.record_format)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def close(self) -> None:
+        """Close the view; the driver stops computing it"""
+        if self._fd is not None:
+            os.close(self._fd)
+            self._fd = None
+
+    def fileno(self) -> int:
+        """File descriptor of the view (for select/poll/epoll/asyncio)"""
+        if self._fd is None:
+            raise RuntimeError("View closed")
+        return self._fd
+
+    def set_watermark(self, records: int) -> None:
+        """Set how many queued records poll()/read() wait for"""
+        fcntl.ioctl(self.fileno(), SIMTEMP_IOC_SET_WATERMARK, struct.pack("=I", records))
+
+    def read_records(self, max_records: int = 256) -> list:
+        """
+        Read up to max_records records with a single read() call
+
+        Returns:
+            TemperatureSample objects (raw, filtered), or tuples
+            (timestamp_ns, temp_mC, type) for events and
+            (first_ns, last_ns, count, min_mC, max_mC, mean_mC) for aggregates
+        """
+        try:
+            data = os.read(self.fileno(), max_records * self.record_size)
+        except BlockingIOError:
+            raise TimeoutError("No data available (non-blocking mode)")
+
+        records = struct.iter_unpack(self.record_format, data)
+        if self.view_type in (VIEW_RAW, VIEW_FILTERED):
+            return [TemperatureSample(*record) for record in records]
+        return list(records)
+
+
+def _parse_stats_records(data: bytes, count: int) -> Dict[int, Dict[str, int]]:
+    """Decode packed struct simtemp_stats_record entries"""
+    stats = {}
+    for instance, flags, *counters in struct.iter_unpack(
+            STATS_RECORD_FORMAT, data[:count * STATS_RECORD_SIZE]):
+        entry = dict(zip(STATS_FIELDS, counters))
+        entry["active"] = int(bool(flags & STATS_ACTIVE))
+        stats[instance] = entry
+    return stats
+
+
+def read_debugfs_stats(path: str = STATS_DEBUGFS_PATH) -> Dict[int, Dict[str, int]]:
+    """Counters of every instance from the debugfs stats file (one read)"""
+    with open(path, "rb", buffering=0) as f:
+        data = f.read(struct.calcsize(STATS_HEADER_FORMAT) + 4096 * STATS_RECORD_SIZE)
+
+    header_size = struct.calcsize(STATS_HEADER_FORMAT)
+    magic, version, record_size, count = struct.unpack_from(STATS_HEADER_FORMAT, data)
+    if magic != STATS_MAGIC or record_size != STATS_RECORD_SIZE:
+        raise ValueError(f"Unexpected stats format (magic {magic:#x}, version {version})")
+
+    return _parse_stats_records(data[header_size:], count)
+
+
 def celsius_to_mC(celsius: float) -> int:
     """Convert Celsius to milli-Celsius"""
     return int(celsius * 1000)
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+NXP SimTemp Actuator Interface
+Closed-loop control of the driver's thermal plant ("plant" mode)
+
+The driver exposes one struct simtemp_control page per instance, mapped
+shared and writable at SIMTEMP_CTRL_MMAP_OFFSET. A controller writes the
+heat load and cooling command with plain stores and bumps `seq`; the next
+sampling tick consumes them and reports the `seq` it applied. No syscall
+is needed per command.
+
+Both need the device opened writable (as root).
+
+Example:
+    device = SimTempDevice()
+    device.open(writable=True)
+    with device, ActuatorPage(device) as actuator:
+        device.set_mode("plant")
+        actuator.set(heat_mW=5000, cooling=0)
+        sample = device.read_sample()
+        actuator.set(heat_mW=5000, cooling=800)   # fan to 80 %
+"""
+
+import mmap
+import struct
+
+from simtemp_device import SimTempDevice
+
+# struct simtemp_control (must match nxp_simtemp_ioctl.h)
+CTRL_FORMAT = "=IIiIIIQ"
+CTRL_MAGIC = 0x53544354
+CTRL_VERSION = 1
+CTRL_MMAP_OFFSET = 0x40000000
+CTRL_HEAT_OFFSET = 8
+CTRL_COOLING_OFFSET = 12
+CTRL_SEQ_OFFSET = 16
+CTRL_APPLIED_SEQ_OFFSET = 20
+CTRL_APPLIED_NS_OFFSET = 24
+
+COOLING_MAX = 1000
+HEAT_MW_MAX = 10000
+
+
+class ActuatorPage:
+    """Shared, writable mapping of an instance's actuator page"""
+
+    def __init__(self, device: SimTempDevice):
+        self.device = device
+        self._map = None
+        self._seq = 0
+
+    def __enter__(self):
+        self.open()
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def open(self) -> None:
+        """Map the actuator page (the device must be open writable)"""
+        self._map = mmap.mmap(self.device.fileno(), mmap.PAGESIZE, mmap.MAP_SHARED,
+                              mmap.PROT_READ | mmap.PROT_WRITE, offset=CTRL_MMAP_OFFSET)
+
+        magic, version = struct.unpack_from("=II", self._map)
+        if magic != CTRL_MAGIC or version != CTRL_VERSION:
+            self.close()
+            raise ValueError(f"Unexpected control page (magic {magic:#x}, version {version})")
+
+        self._seq = struct.unpack_from("=I", self._map, CTRL_SEQ_OFFSET)[0]
+
+    def close(self) -> None:
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+
+    def set(self, heat_mW: int, cooling: int) -> int:
+        """
+        Write new commands; the driver applies them on its next tick
+
+        Args:
+            heat_mW: Heat load (-10000 to 10000 mW; negative pumps heat out)
+            cooling: Fan command (0 to 1000)
+
+        Returns:
+            Sequence number of this command (compare with applied_seq)
+        """
+        heat_mW = max(-HEAT_MW_MAX, min(HEAT_MW_MAX, int(heat_mW)))
+        cooling = max(0, min(COOLING_MAX, int(cooling)))
+
+        # Commands first, then seq: the driver reads them in reverse order
+        struct.pack_into("=iI", self._map, CTRL_HEAT_OFFSET, heat_mW, cooling)
+        self._seq = (self._seq + 1) & 0xFFFFFFFF
+        struct.pack_into("=I", self._map, CTRL_SEQ_OFFSET, self._seq)
+        return self._seq
+
+    @property
+    def applied_seq(self) -> int:
+        """Sequence number consumed by the driver's last tick"""
+        return struct.unpack_from("=I", self._map, CTRL_APPLIED_SEQ_OFFSET)[0]
+
+    @property
+    def applied_ns(self) -> int:
+        """Timestamp of the tick that consumed applied_seq"""
+        return struct.unpack_from("=Q", self._map, CTRL_APPLIED_NS_OFFSET)[0]
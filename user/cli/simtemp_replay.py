@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""
+NXP SimTemp Capture Replay
+Paced playback of recorded samples through write() injection
+
+A capture is what read() returns on /dev/simtemp: struct simtemp_sample
+records back to back (e.g. `dd if=/dev/simtemp of=capture.bin`), or
+frames in frame mode, of which only the sample headers are replayed.
+
+Samples are written at their original spacing divided by `speed`.
+Every sample has an absolute CLOCK_MONOTONIC deadline computed from the
+start of the run, so errors never accumulate. A timerfd armed with
+TFD_TIMER_ABSTIME sleeps until shortly before the deadline and a busy
+wait on the clock finishes the last `spin_us`, hiding the scheduler's
+wakeup latency. The device is opened O_DSYNC, so each write() is
+visible to readers before it returns. Samples whose deadline has already
+passed when the writer gets there go out in one write(). Lateness is
+measured when write() returns, i.e. when readers can see the sample.
+
+Example:
+    capture = Capture.load("incident.bin")
+    device = SimTempDevice()
+    device.open(writable=True, sync=True)
+    stats = Replayer(device, capture, speed=10).run(loops=3)
+    print(stats.percentile_us(99))
+"""
+
+import ctypes
+import os
+import struct
+import time
+from array import array
+from dataclasses import dataclass, field
+
+from simtemp_device import SimTempDevice, SAMPLE_FORMAT, SAMPLE_SIZE
+
+# Busy-wait this long before each deadline (covers timer wakeup latency)
+SPIN_US = 200
+
+# Most late samples sent in one write() when catching up
+MAX_COALESCE = 256
+
+# Timing errors are histogrammed in 1 us buckets up to this bound
+HISTOGRAM_US = 100000
+
+# <sys/timerfd.h>
+CLOCK_MONOTONIC = 1
+TFD_CLOEXEC = 0o2000000
+TFD_TIMER_ABSTIME = 1
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+class _Itimerspec(ctypes.Structure):
+    _fields_ = [("it_interval", _Timespec), ("it_value", _Timespec)]
+
+
+class DeadlineTimer:
+    """
+    Absolute-deadline sleeper on CLOCK_MONOTONIC (the clock of
+    time.monotonic_ns() and of the driver's timestamps)
+    """
+
+    def __init__(self, spin_us: int = SPIN_US):
+        self.spin_ns = spin_us * 1000
+        self._libc = ctypes.CDLL(None, use_errno=True)
+        self._fd = self._libc.timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)
+        if self._fd < 0:
+            err = ctypes.get_errno()
+            raise OSError(err, os.strerror(err))
+        self._spec = _Itimerspec()
+
+    def close(self) -> None:
+        if self._fd >= 0:
+            os.close(self._fd)
+            self._fd = -1
+
+    def wait_until(self, deadline_ns: int) -> int:
+        """Return at deadline_ns (never before); returns the clock then"""
+        wake_ns = deadline_ns - self.spin_ns
+        if wake_ns > time.monotonic_ns():
+            self._spec.it_value.tv_sec, self._spec.it_value.tv_nsec = divmod(wake_ns, 1000000000)
+            if self._libc.timerfd_settime(self._fd, TFD_TIMER_ABSTIME,
+                                          ctypes.byref(self._spec), None) < 0:
+                err = ctypes.get_errno()
+                raise OSError(err, os.strerror(err))
+            os.read(self._fd, 8)
+
+        now = time.monotonic_ns()
+        while now < deadline_ns:
+            now = time.monotonic_ns()
+        return now
+
+
+@dataclass
+class Capture:
+    """Recorded samples as (offset_ns from the first sample, packed record)"""
+
+    offsets_ns: list
+    records: list
+    period_ns: int
+
+    @classmethod
+    def load(cls, path: str, record_size: int = SAMPLE_SIZE, restamp: bool = True) -> "Capture":
+        """
+        Read a capture file
+
+        Args:
+            path: Raw read() output of the device
+            record_size: SAMPLE_SIZE, or the frame size of a frame-mode capture
+            restamp: Zero the timestamps so the driver stamps each sample
+                     when it is injected (the original spacing is kept
+                     by the pacing either way)
+        """
+        with open(path, "rb") as f:
+            data = f.read()
+
+        count = len(data) // record_size
+        if not count:
+            raise ValueError(f"{path}: no complete {record_size}-byte records")
+
+        offsets, records = [], []
+        first_ns = last_ns = None
+        for i in range(count):
+            ts, temp, flags = struct.unpack_from(SAMPLE_FORMAT, data, i * record_size)
+            if first_ns is None:
+                first_ns = last_ns = ts
+            # Out-of-order timestamps are played back to back
+            last_ns = max(last_ns, ts)
+            offsets.append(last_ns - first_ns)
+            records.append(struct.pack(SAMPLE_FORMAT, 0 if restamp else ts, temp, flags))
+
+        # Gap between the last sample and the first of the next loop
+        period = offsets[-1] // (count - 1) if count > 1 else 1000000
+        return cls(offsets, records, max(1, period))
+
+    def __len__(self) -> int:
+        return len(self.records)
+
+    @property
+    def span_ns(self) -> int:
+        """Duration of one pass, including the gap before the next one"""
+        return self.offsets_ns[-1] + self.period_ns
+
+
+@dataclass
+class ReplayStats:
+    """
+    Timing of a replay: lateness of each sample against its deadline,
+    taken when its write() returned, so it covers the wakeup and the
+    write() itself (with O_DSYNC, publishing to readers)
+    """
+
+    samples: int = 0
+    writes: int = 0
+    loops: int = 0
+    max_ns: int = 0
+    histogram: array = field(default_factory=lambda: array("Q", bytes(8 * (HISTOGRAM_US + 1))))
+
+    def add(self, error_ns: int) -> None:
+        self.samples += 1
+        if error_ns > self.max_ns:
+            self.max_ns = error_ns
+        self.histogram[min(error_ns // 1000, HISTOGRAM_US)] += 1
+
+    def percentile_us(self, pct: float) -> int:
+        """Timing error (us) not exceeded by pct percent of the samples"""
+        if not self.samples:
+            return 0
+        rank = min(self.samples - 1, int(self.samples * pct / 100))
+        seen = 0
+        for us, count in enumerate(self.histogram):
+            seen += count
+            if seen > rank:
+                return us
+        return HISTOGRAM_US
+
+
+class Replayer:
+    """Writes a capture into an open device at its recorded pace"""
+
+    def __init__(self, device: SimTempDevice, capture: Capture,
+                 speed: float = 1.0, spin_us: int = SPIN_US):
+        self.device = device
+        self.capture = capture
+        self.speed = speed
+        self.spin_us = spin_us
+
+    def run(self, loops: int = 1, should_stop=None, on_loop=None) -> ReplayStats:
+        """
+        Play the capture `loops` times (0 = until should_stop() is true)
+
+        The device must be open writable, preferably with sync=True;
+        on_loop(stats) is called after every pass.
+        """
+        fd = self.device.fileno()
+        records = self.capture.records
+        deadlines = [int(offset / self.speed) for offset in self.capture.offsets_ns]
+        span = int(self.capture.span_ns / self.speed)
+        count = len(records)
+        stats = ReplayStats()
+        timer = DeadlineTimer(self.spin_us)
+
+        try:
+            start = time.monotonic_ns() + 1000000
+            while not loops or stats.loops < loops:
+                base = start + stats.loops * span
+                i = 0
+                while i < count:
+                    if should_stop and should_stop():
+                        return stats
+
+                    deadline = base + deadlines[i]
+                    now = timer.wait_until(deadline)
+
+                    # Everything already due goes out with this sample
+                    end = i + 1
+                    while (end < count and end - i < MAX_COALESCE and
+                           base + deadlines[end] <= now):
+                        end += 1
+
+                    os.write(fd, b"".join(records[i:end]))
+
+                    # Visible to readers once write() returns (O_DSYNC)
+                    done = time.monotonic_ns()
+                    stats.writes += 1
+                    for j in range(i, end):
+                        stats.add(done - (base + deadlines[j]))
+                    i = end
+
+                stats.loops += 1
+                if on_loop:
+                    on_loop(stats)
+        finally:
+            timer.close()
+
+        return stats
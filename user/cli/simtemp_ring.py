@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+NXP SimTemp mmap Ring Interface
+Zero-copy numpy view over the driver's sample ring
+
+The driver maps its ring read-only: a header page (struct
+simtemp_ring_header) followed by `size` packed records of `record_size`
+bytes (16-byte samples, or frames carrying a payload). The
+header's `head` is the sequence number of the next record to be written,
+and record seq lives at index seq % size. This module exposes unread
+records as numpy structured-array views straight onto the mapping, with
+no per-sample copy or decode.
+
+Example:
+    with SimTempDevice() as device, SampleRing(device) as ring:
+        while True:
+            ring.wait(timeout_ms=1000)
+            view, seq = ring.peek()
+            mean = view["temp_mC"].mean()      # vectorized, in place
+            lost = ring.commit(seq, len(view))  # > 0 if overwritten meanwhile
+"""
+
+import fcntl
+import mmap
+import select
+import struct
+from typing import Tuple
+
+import numpy as np
+
+from simtemp_device import SimTempDevice, SIMTEMP_IOC_SET_CURSOR
+
+# struct simtemp_ring_header (must match nxp_simtemp_ioctl.h)
+RING_HEADER_FORMAT = "=6I"
+RING_HEADER_SIZE = struct.calcsize(RING_HEADER_FORMAT)
+RING_HEAD_OFFSET = 20
+RING_MAGIC = 0x53545252
+RING_VERSION = 1
+
+# struct simtemp_sample as a numpy record (packed, native byte order)
+SAMPLE_DTYPE = np.dtype([
+    ("timestamp_ns", "=u8"),
+    ("temp_mC", "=i4"),
+    ("flags", "=u4"),
+])
+
+_SEQ_MASK = 0xFFFFFFFF
+
+
+def frame_dtype(payload_bytes: int) -> np.dtype:
+    """
+    Record dtype for a payload size: SAMPLE_DTYPE for plain samples,
+    otherwise the sample fields plus a `payload` array of u64 words
+    """
+    if not payload_bytes:
+        return SAMPLE_DTYPE
+    return np.dtype(SAMPLE_DTYPE.descr + [("payload", "=u8", (payload_bytes // 8,))])
+
+
+def _seq_delta(a: int, b: int) -> int:
+    """Signed distance a - b between two free-running 32-bit sequence numbers"""
+    return ((a - b + (1 << 31)) & _SEQ_MASK) - (1 << 31)
+
+
+class SampleRing:
+    """Read-only mapping of a device's sample ring with a private cursor"""
+
+    def __init__(self, device: SimTempDevice):
+        """
+        Map the ring of an open device
+
+        The cursor starts at the current head, so only new records are seen.
+        """
+        self.device = device
+        fd = device.fileno()
+
+        # Map the header page first to learn the ring geometry
+        header = mmap.mmap(fd, mmap.PAGESIZE, mmap.MAP_SHARED, mmap.PROT_READ)
+        try:
+            (magic, version, record_size,
+             data_offset, size, _) = struct.unpack_from(RING_HEADER_FORMAT, header)
+        finally:
+            header.close()
+
+        if magic != RING_MAGIC or version != RING_VERSION:
+            raise IOError(f"Unsupported ring layout (magic={magic:#x}, version={version})")
+        if record_size < SAMPLE_DTYPE.itemsize or record_size % 8:
+            raise IOError(f"Unsupported record size {record_size}")
+
+        self.size = size
+        self.record_size = record_size
+        self.dtype = frame_dtype(record_size - SAMPLE_DTYPE.itemsize)
+        self._map = mmap.mmap(fd, data_offset + size * record_size,
+                              mmap.MAP_SHARED, mmap.PROT_READ)
+        self._head = np.frombuffer(self._map, dtype=np.uint32, count=1,
+                                   offset=RING_HEAD_OFFSET)
+        self.records = np.frombuffer(self._map, dtype=self.dtype, count=size,
+                                     offset=data_offset)
+
+        self.cursor = self.head
+        self.dropped = 0
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def close(self) -> None:
+        """Unmap the ring (views handed out become invalid)"""
+        if self._map is not None:
+            # Release numpy's buffer exports before unmapping
+            self._head = None
+            self.records = None
+            self._map.close()
+            self._map = None
+
+    @property
+    def head(self) -> int:
+        """Sequence number of the next record the driver will write"""
+        return int(self._head[0])
+
+    def pending(self) -> int:
+        """Records between the cursor and head (may exceed size if overrun)"""
+        return (self.head - self.cursor) & _SEQ_MASK
+
+    def peek(self) -> Tuple[np.ndarray, int]:
+        """
+        View of unread records, without copying
+
+        Returns (view, seq): a structured-array view of the oldest unread
+        records up to head or the wrap point, whichever comes first, and
+        the sequence number of view[0]. A cursor that fell more than one
+        ring behind first skips to the oldest record still present; the
+        skipped records are added to self.dropped.
+        """
+        head = self.head
+        lag = (head - self.cursor) & _SEQ_MASK
+        if lag > self.size:
+            self.dropped += lag - self.size
+            self.cursor = (head - self.size) & _SEQ_MASK
+            lag = self.size
+
+        start = self.cursor % self.size
+        count = min(lag, self.size - start)
+        return self.records[start:start + count], self.cursor
+
+    def commit(self, seq: int, count: int) -> int:
+        """
+        Mark `count` records starting at `seq` as consumed
+
+        Returns how many of them the driver may have overwritten while
+        they were being processed (0 means the view was stable).
+        """
+        oldest_valid = (self.head - self.size) & _SEQ_MASK
+        overwritten = min(count, max(0, _seq_delta(oldest_valid, seq)))
+        self.dropped += overwritten
+        self.cursor = (seq + count) & _SEQ_MASK
+        return overwritten
+
+    def sync_cursor(self) -> None:
+        """Tell the driver what was consumed so poll() only reports new data"""
+        fcntl.ioctl(self.device.fileno(), SIMTEMP_IOC_SET_CURSOR,
+                    struct.pack("=I", self.cursor))
+
+    def wait(self, timeout_ms: int = 1000) -> bool:
+        """Sleep until the driver has records past the cursor"""
+        if self.pending():
+            return True
+        self.sync_cursor()
+
+        # POLLIN only: POLLPRI stays raised while above threshold
+        poller = select.poll()
+        poller.register(self.device.fileno(), select.POLLIN)
+        return bool(poller.poll(timeout_ms))
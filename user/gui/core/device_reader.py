@@ -17,6 +17,7 @@ sys.path.insert(0, str(Path(__file__).parent.parent.parent / "cli"))
 try:
     from simtemp_device import (
         SimTempDevice,
+        SampleBlock,
         TemperatureSample,
         celsius_to_mC,
         mC_to_celsius,
@@ -32,9 +33,15 @@ class DeviceReader:
     Thread-safe device reader for GUI applications
 
     Runs a background thread that continuously reads from /dev/simtemp
-    and provides samples via a queue for the GUI to consume.
+    and provides samples via a queue for the GUI to consume. Every read()
+    drains up to READ_BATCH samples into one SampleBlock, so the thread's
+    cost grows with wakeups rather than with the device rate.
     """
 
+    # Samples per read() and SampleBlocks buffered for the GUI
+    READ_BATCH = 256
+    QUEUE_BLOCKS = 100
+
     def __init__(self, callback: Optional[Callable[[TemperatureSample], None]] = None):
         """
         Initialize device reader
@@ -44,7 +51,7 @@ class DeviceReader:
         """
         self.device = SimTempDevice()
         self.callback = callback
-        self.sample_queue = queue.Queue(maxsize=100)
+        self.sample_queue = queue.Queue(maxsize=self.QUEUE_BLOCKS)
 
         # Threading
         self._read_thread: Optional[threading.Thread] = None
@@ -116,32 +123,35 @@ class DeviceReader:
             try:
                 # Poll for new data with timeout
                 if self.device.poll(timeout_ms=100):
-                    sample = self.device.read_sample()
+                    block = self.device.read_block(self.READ_BATCH)
+                    if not len(block):
+                        continue
 
                     # Update statistics
-                    self.samples_read += 1
-                    self.last_sample = sample
+                    self.samples_read += len(block)
+                    self.last_sample = block[len(block) - 1]
                     self.last_error = None
                     self.error_count = 0
 
                     # Add to queue (non-blocking)
                     try:
-                        self.sample_queue.put_nowait(sample)
+                        self.sample_queue.put_nowait(block)
                     except queue.Full:
                         # Queue full, discard oldest
                         try:
                             self.sample_queue.get_nowait()
-                            self.sample_queue.put_nowait(sample)
+                            self.sample_queue.put_nowait(block)
                         except queue.Empty:
                             pass
 
                     # Call callback if provided
                     if self.callback:
-                        try:
-                            self.callback(sample)
-                        except Exception as e:
-                            # Don't let callback errors crash the reader
-                            pass
+                        for sample in block:
+                            try:
+                                self.callback(sample)
+                            except Exception as e:
+                                # Don't let callback errors crash the reader
+                                pass
 
             except TimeoutError:
                 # No data available, this is normal with non-blocking
@@ -154,30 +164,34 @@ class DeviceReader:
                 if self.error_count > 10:
                     time.sleep(0.5)
 
-    def get_sample(self, timeout: float = 0.0) -> Optional[TemperatureSample]:
+    def get_block(self, timeout: float = 0.0) -> Optional[SampleBlock]:
         """
-        Get next sample from queue
+        Get next SampleBlock from queue
 
         Args:
-            timeout: Maximum time to wait for sample (0 = non-blocking)
+            timeout: Maximum time to wait for a block (0 = non-blocking)
 
         Returns:
-            TemperatureSample or None if no sample available
+            SampleBlock or None if no block available
         """
         try:
             return self.sample_queue.get(timeout=timeout)
         except queue.Empty:
             return None
 
-    def get_all_samples(self) -> list[TemperatureSample]:
-        """Get all available samples from queue"""
-        samples = []
+    def get_all_blocks(self) -> list[SampleBlock]:
+        """Get all available SampleBlocks from queue, oldest first"""
+        blocks = []
         while True:
-            sample = self.get_sample(timeout=0.0)
-            if sample is None:
+            block = self.get_block(timeout=0.0)
+            if block is None:
                 break
-            samples.append(sample)
-        return samples
+            blocks.append(block)
+        return blocks
+
+    def get_all_samples(self) -> list[TemperatureSample]:
+        """Get all available samples from queue (decodes every sample)"""
+        return [sample for block in self.get_all_blocks() for sample in block]
 
     # Sysfs configuration methods (thread-safe)
 
@@ -240,6 +254,19 @@ class DeviceReader:
             self.last_error = f"Failed to read stats: {e}"
             return None
 
+    def get_counters(self) -> Optional[dict]:
+        """
+        Get module statistics with one ioctl (binary, no sysfs parsing)
+        Falls back to the sysfs stats attribute on older modules
+        """
+        try:
+            stats = self.device.get_all_stats(capacity=1)
+            if 0 in stats:
+                return stats[0]
+        except OSError:
+            pass
+        return self.get_stats()
+
     def get_config(self) -> Optional[dict]:
         """Get current configuration"""
         try:
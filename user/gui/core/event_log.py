@@ -0,0 +1,115 @@
+"""
+Event Log Backend
+Buffers and coalesces GUI events between frames
+"""
+
+import time
+from collections import deque
+from dataclasses import dataclass
+from datetime import datetime
+from typing import Optional
+
+
+@dataclass
+class LogEntry:
+    """One line of the event log, possibly standing for repeated events"""
+
+    timestamp: str
+    message: str
+    event_type: str
+    key: object
+    first_time: float
+    last_time: float
+    count: int = 1
+
+    @property
+    def text(self) -> str:
+        """Message with the repeat count, e.g. 'Alert ×37 in last 2 s'"""
+        if self.count == 1:
+            return self.message
+        span = max(1, round(self.last_time - self.first_time))
+        return f"{self.message} ×{self.count} in last {span} s"
+
+
+class EventLog:
+    """
+    Bounded event history with repeat coalescing
+
+    add() only touches Python objects: an event whose key matches an entry
+    opened less than COALESCE_S ago bumps that entry's count instead of
+    adding a line. The widget drains changes with take_changes() at most
+    once per frame. History is a deque, so trimming is O(1).
+    """
+
+    # Repeats within this many seconds of the first occurrence share a line
+    COALESCE_S = 2.0
+
+    # Entries kept for paging
+    HISTORY = 1000
+
+    def __init__(self, history: int = HISTORY, coalesce_s: float = COALESCE_S):
+        self.entries = deque(maxlen=history)
+        self.coalesce_s = coalesce_s
+        self._open = {}  # key -> newest entry for that key
+        self._changed = False
+        self.total_events = 0
+        self.total_entries = 0
+
+    def add(self, message: str, event_type: str = "normal", key: Optional[object] = None) -> None:
+        """
+        Record an event
+
+        Args:
+            message: Text shown in the log (the newest one wins when coalesced)
+            event_type: Tag name (normal, info, warning, error)
+            key: Events with equal keys are coalesced; defaults to the
+                 message and type
+        """
+        now = time.monotonic()
+        if key is None:
+            key = (message, event_type)
+
+        self.total_events += 1
+        self._changed = True
+
+        entry = self._open.get(key)
+        if entry is not None and now - entry.first_time < self.coalesce_s:
+            entry.count += 1
+            entry.last_time = now
+            entry.message = message
+            return
+
+        entry = LogEntry(
+            timestamp=datetime.now().strftime("[%Y-%m-%d %H:%M:%S]"),
+            message=message,
+            event_type=event_type,
+            key=key,
+            first_time=now,
+            last_time=now,
+        )
+        self.entries.append(entry)
+        self.total_entries += 1
+        self._open[key] = entry
+
+        # Forget coalescing state of entries that fell out of the window
+        if len(self._open) > 64:
+            self._open = {k: e for k, e in self._open.items()
+                          if now - e.first_time < self.coalesce_s}
+
+    def take_changes(self) -> bool:
+        """True if events were added since the last call"""
+        changed = self._changed
+        self._changed = False
+        return changed
+
+    def page(self, lines: int, offset: int = 0) -> list:
+        """
+        Entries of one page, oldest first
+
+        Args:
+            lines: Page size
+            offset: Entries skipped from the newest end (0 = live page)
+        """
+        end = max(0, len(self.entries) - offset)
+        start = max(0, end - lines)
+        return [self.entries[i] for i in range(start, end)]
@@ -0,0 +1,83 @@
+"""
+Running Statistics
+O(1) per-sample aggregates over a fixed window of recent samples
+"""
+
+from array import array
+
+
+class RunningStats:
+    """
+    Average over the last `window` samples plus all-time min/max
+
+    Samples are kept in milli-Celsius integers in a preallocated ring, so
+    the running sum stays exact and adding a sample never allocates or
+    rescans the window.
+    """
+
+    def __init__(self, window: int = 1000):
+        self.window = window
+        self._ring = array("i", bytes(4 * window))
+        self._next = 0
+        self._count = 0
+        self._sum_mC = 0
+        self.min_mC = None
+        self.max_mC = None
+
+    def add_many(self, temps_mC: list) -> None:
+        """Add a batch of samples (list of milli-Celsius ints, oldest first)"""
+        if not temps_mC:
+            return
+
+        low, high = min(temps_mC), max(temps_mC)
+        if self.min_mC is None or low < self.min_mC:
+            self.min_mC = low
+        if self.max_mC is None or high > self.max_mC:
+            self.max_mC = high
+
+        window = self.window
+        if len(temps_mC) >= window:
+            # The batch replaces the whole window
+            self._ring = array("i", temps_mC[-window:])
+            self._next = 0
+            self._count = window
+            self._sum_mC = sum(self._ring)
+            return
+
+        ring = self._ring
+        pos = self._next
+        count = self._count
+        total = self._sum_mC
+
+        for temp in temps_mC:
+            if count == window:
+                total -= ring[pos]
+            else:
+                count += 1
+            ring[pos] = temp
+            total += temp
+            pos += 1
+            if pos == window:
+                pos = 0
+
+        self._next = pos
+        self._count = count
+        self._sum_mC = total
+
+    def __len__(self) -> int:
+        return self._count
+
+    @property
+    def average_celsius(self):
+        """Average of the window in °C (None before the first sample)"""
+        if not self._count:
+            return None
+        return self._sum_mC / self._count / 1000.0
+
+    @property
+    def min_celsius(self):
+        return None if self.min_mC is None else self.min_mC / 1000.0
+
+    @property
+    def max_celsius(self):
+        return None if self.max_mC is None else self.max_mC / 1000.0
@@ -12,21 +12,28 @@ from widgets.panels.event_log import EventLogPanel
 from widgets.panels.status_bar import StatusBar
 from core.device_reader import DeviceReader
 from core.config import Config
+from core.running_stats import RunningStats
 from tkinter import messagebox
 
 
 class SimTempMonitor:
     """Main application class"""
 
+    # GUI refresh period (50 ms = 20 FPS) and kernel counter refresh period
+    FRAME_MS = 50
+    COUNTERS_MS = 1000
+
+    # Samples in the running average
+    AVERAGE_WINDOW = 1000
+
     def __init__(self, root):
         self.root = root
         self.config = Config()
         self.device_reader = DeviceReader()
 
-        # Statistics tracking
-        self.max_recorded = 25.0
-        self.min_recorded = 25.0
-        self.temp_history = []
+        # Statistics tracking (O(1) per sample)
+        self.running_stats = RunningStats(self.AVERAGE_WINDOW)
+        self.kernel_samples = 0
 
         self._setup_window()
         self._setup_styles()
@@ -137,49 +144,75 @@ class SimTempMonitor:
             return
 
         self.event_log.add_event("Connected to /dev/simtemp", "info")
+        self._refresh_counters()
         self._update_temperature()
 
     def _update_temperature(self):
-        """Update temperature readings and GUI"""
-        # Get all available samples from device
-        samples = self.device_reader.get_all_samples()
-
-        # Process each sample
-        for sample in samples:
-            temp = sample.temp_celsius
-
-            # Update statistics
-            self.temp_history.append(temp)
-            if len(self.temp_history) > 1000:
-                self.temp_history.pop(0)
-            self.max_recorded = max(self.max_recorded, temp)
-            self.min_recorded = min(self.min_recorded, temp)
-
-            # Update live data
-            self.live_data_panel.update_temperature(temp)
+        """
+        Update temperature readings and GUI, once per frame
+
+        Everything that arrived since the last frame is handled as one batch:
+        the running statistics take the raw milli-Celsius columns and the
+        panels are updated once, so the per-frame cost stays flat as the
+        device rate rises.
+        """
+        blocks = self.device_reader.get_all_blocks()
+
+        temps_mC = []
+        timestamps_ns = []
+        for block in blocks:
+            temps_mC.extend(block.temps_mC.tolist())
+            timestamps_ns.extend(block.timestamps_ns.tolist())
+
+        if temps_mC:
+            self.running_stats.add_many(temps_mC)
+
+            # Only the newest points reach the plot
+            tail = -LiveDataPanel.HISTORY_POINTS
+            self.live_data_panel.update_temperatures(
+                [temp / 1000.0 for temp in temps_mC[tail:]], timestamps_ns[tail:]
+            )
 
             # Check threshold (from sample flags)
-            if sample.is_threshold_crossed:
-                self.event_log.add_event(
-                    f"⚠️ THRESHOLD ALERT: Temperature {temp:.1f}°C exceeded threshold!", "error"
-                )
+            for block in blocks:
+                for sample in block.threshold_samples():
+                    self.event_log.add_event(
+                        f"⚠️ THRESHOLD ALERT: Temperature {sample.temp_celsius:.1f}°C "
+                        "exceeded threshold!",
+                        "error",
+                        key="threshold",
+                    )
 
-        # Update status bar with real kernel stats
-        stats = self.device_reader.get_stats()
-        if stats:
-            avg_temp = (
-                sum(self.temp_history) / len(self.temp_history) if self.temp_history else 25.0
-            )
-            self.status_bar.update_stats(
-                max_temp=self.max_recorded,
-                min_temp=self.min_recorded,
-                avg_temp=avg_temp,
-                status=f"Monitoring ({stats.get('total_samples', 0)} samples)",
-            )
+            self._update_status_bar()
 
         # Check for errors
         if self.device_reader.last_error:
             self.event_log.add_event(f"Device error: {self.device_reader.last_error}", "error")
 
-        # Schedule next update (GUI refresh rate: 50ms = 20 FPS)
-        self.root.after(50, self._update_temperature)
+        # Buffered and coalesced events reach the widget once per frame
+        self.event_log.flush()
+
+        # Schedule next update
+        self.root.after(self.FRAME_MS, self._update_temperature)
+
+    def _refresh_counters(self):
+        """Refresh kernel counters (one ioctl) on a slower cadence than frames"""
+        stats = self.device_reader.get_counters()
+        if stats:
+            self.kernel_samples = stats.get("total_samples", 0)
+            self._update_status_bar()
+
+        self.root.after(self.COUNTERS_MS, self._refresh_counters)
+
+    def _update_status_bar(self):
+        """Update status bar from the running statistics"""
+        stats = self.running_stats
+        if not len(stats):
+            return
+
+        self.status_bar.update_stats(
+            max_temp=stats.max_celsius,
+            min_temp=stats.min_celsius,
+            avg_temp=stats.average_celsius,
+            status=f"Monitoring ({self.kernel_samples} samples)",
+        )
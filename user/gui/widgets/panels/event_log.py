@@ -4,13 +4,27 @@ Displays system events with timestamps
 """
 
 import tkinter as tk
-from datetime import datetime
+
+from core.event_log import EventLog
 
 
 class EventLogPanel:
-    """Panel for displaying system events"""
+    """
+    Panel for displaying system events
+
+    Events are buffered and coalesced by an EventLog backend; the text
+    widget is rewritten at most once per flush() (once per frame), with a
+    single insert for the whole visible page.
+    """
+
+    # Lines shown per page
+    PAGE_LINES = 100
 
     def __init__(self, parent):
+        self.log = EventLog()
+        self.offset = 0  # Entries hidden at the newest end (0 = follow live)
+        self._entries_seen = 0
+
         # Main frame
         self.frame = tk.Frame(parent, bg="#0a0a15", height=180)
         self.frame.pack(fill="x", padx=30, pady=(15, 0))
@@ -21,11 +35,29 @@ class EventLogPanel:
 
     def _create_widgets(self):
         """Create event log widgets"""
-        # Title
+        # Title with paging controls
+        header = tk.Frame(self.frame, bg="#0a0a15")
+        header.pack(fill="x", pady=(15, 12), padx=20)
+
         title = tk.Label(
-            self.frame, text="Event Log", fg="white", bg="#0a0a15", font=("Arial", 12, "bold")
+            header, text="Event Log", fg="white", bg="#0a0a15", font=("Arial", 12, "bold")
         )
-        title.pack(pady=(15, 12), padx=20, anchor="w")
+        title.pack(side="left")
+
+        for text, step in (("Newer ▶", -self.PAGE_LINES), ("◀ Older", self.PAGE_LINES)):
+            button = tk.Button(
+                header,
+                text=text,
+                command=lambda step=step: self.scroll_pages(step),
+                fg="#888888",
+                bg="#0a0a15",
+                activebackground="#1a1a25",
+                activeforeground="white",
+                relief="flat",
+                borderwidth=0,
+                font=("Arial", 9),
+            )
+            button.pack(side="right", padx=(8, 0))
 
         # Create scrollable text widget
         text_frame = tk.Frame(self.frame, bg="#050510")
@@ -70,20 +102,48 @@ class EventLogPanel:
         """Add initial events to the log"""
         self.add_event("System initialized. Monitoring started.", "info")
 
-    def add_event(self, message, event_type="normal"):
-        """Add an event to the log"""
-        timestamp = datetime.now().strftime("[%Y-%m-%d %H:%M:%S]")
-
-        # Insert timestamp
-        self.log_text.insert("end", f"{timestamp} ", "timestamp")
-
-        # Insert message with appropriate tag
-        self.log_text.insert("end", f"{message}\n", event_type)
-
-        # Auto-scroll to bottom
-        self.log_text.see("end")
-
-        # Keep only last 100 lines
-        lines = int(self.log_text.index("end-1c").split(".")[0])
-        if lines > 100:
-            self.log_text.delete("1.0", "2.0")
+    def add_event(self, message, event_type="normal", key=None):
+        """
+        Add an event to the log (shown at the next flush())
+
+        Events with the same key (default: same message and type) within
+        EventLog.COALESCE_S share one line with a repeat count.
+        """
+        self.log.add(message, event_type, key)
+
+    def scroll_pages(self, step):
+        """Page through the history (positive = older); 0 offset follows live"""
+        newest_offset = max(0, len(self.log.entries) - self.PAGE_LINES)
+        self.offset = max(0, min(self.offset + step, newest_offset))
+        self._render()
+
+    def flush(self):
+        """Write buffered events to the widget (call once per frame)"""
+        if not self.log.take_changes():
+            return
+
+        added = self.log.total_entries - self._entries_seen
+        self._entries_seen = self.log.total_entries
+
+        if self.offset:
+            # Paged back: keep the same page on screen as new entries arrive
+            self.offset = min(self.offset + added,
+                              max(0, len(self.log.entries) - self.PAGE_LINES))
+            return
+
+        self._render()
+
+    def _render(self):
+        """Rewrite the visible page with a single insert"""
+        chunks = []
+        for entry in self.log.page(self.PAGE_LINES, self.offset):
+            chunks += [f"{entry.timestamp} ", "timestamp", f"{entry.text}\n", entry.event_type]
+
+        self.log_text.delete("1.0", "end")
+        if chunks:
+            self.log_text.insert("end", *chunks)
+
+        if self.offset:
+            self.log_text.see("1.0")
+        else:
+            self.log_text.see("end")
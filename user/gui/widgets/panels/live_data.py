@@ -11,10 +11,13 @@ import time
 class LiveDataPanel:
     """Panel for displaying live temperature data"""
 
+    # Points kept on the plot
+    HISTORY_POINTS = 100
+
     def __init__(self, parent):
-        self.temperature_history = deque(maxlen=100)
-        self.time_history = deque(maxlen=100)
-        self.start_time = time.time()
+        self.temperature_history = deque(maxlen=self.HISTORY_POINTS)
+        self.time_history = deque(maxlen=self.HISTORY_POINTS)
+        self.start_ns = None
 
         # Main frame (very dark)
         self.frame = tk.Frame(parent, bg="#0a0a15")
@@ -104,9 +107,29 @@ class LiveDataPanel:
         x_label.pack(pady=(5, 0))
 
     def update_temperature(self, temperature):
-        """Update temperature display and graph"""
-        # Record time
-        current_time = time.time() - self.start_time
+        """Update temperature display and graph with a single reading"""
+        self.update_temperatures([temperature], [time.monotonic_ns()])
+
+    def update_temperatures(self, temperatures, timestamps_ns):
+        """
+        Update temperature display and graph with one frame's batch
+
+        The labels and the graph are redrawn once per call however many
+        samples arrive, and only the newest HISTORY_POINTS are kept.
+
+        Args:
+            temperatures: Readings in °C, oldest first
+            timestamps_ns: Matching CLOCK_MONOTONIC sample timestamps
+        """
+        if not temperatures:
+            return
+
+        if self.start_ns is None:
+            self.start_ns = timestamps_ns[0]
+
+        temperatures = temperatures[-self.HISTORY_POINTS:]
+        timestamps_ns = timestamps_ns[-self.HISTORY_POINTS:]
+        temperature = temperatures[-1]
 
         # Update main display
         self.temp_display.config(text=f"{temperature:.1f}°C")
@@ -129,8 +152,8 @@ class LiveDataPanel:
         self.temp_display.config(fg=color)
 
         # Add to history
-        self.temperature_history.append(temperature)
-        self.time_history.append(current_time)
+        self.temperature_history.extend(temperatures)
+        self.time_history.extend((ts - self.start_ns) / 1e9 for ts in timestamps_ns)
 
         # Redraw graph
         self._draw_graph()